@@ -0,0 +1,180 @@
+#include "AllocationTracker.hpp"
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32)
+    #include <Windows.h>
+#elif __has_include(<execinfo.h>)
+    #include <execinfo.h>
+    #include <unistd.h>
+    #define TETRIS_HAS_EXECINFO 1
+#endif
+
+namespace {
+    void PrintStackTrace() {
+        void* frames[AllocationTracker::TrackerConfig::MAX_STACK_FRAMES];
+#if defined(_WIN32)
+        const USHORT count = CaptureStackBackTrace(
+            1, AllocationTracker::TrackerConfig::MAX_STACK_FRAMES, frames, nullptr);
+        for (USHORT i = 0; i < count; ++i) {
+            std::fprintf(stderr, "    #%u %p\n", static_cast<unsigned>(i), frames[i]);
+        }
+#elif defined(TETRIS_HAS_EXECINFO)
+        // backtrace_symbols_fd writes straight to the fd without allocating
+        const int count = backtrace(frames, AllocationTracker::TrackerConfig::MAX_STACK_FRAMES);
+        std::fflush(stderr);
+        backtrace_symbols_fd(frames + 1, count - 1, STDERR_FILENO);
+#else
+        (void)frames;
+        std::fprintf(stderr, "    (stack traces are not available on this platform)\n");
+#endif
+    }
+
+    const char* ScopeName(uint16_t scope, AllocationTracker::MarkerNameFn names) {
+        if (scope == AllocationTracker::TrackerConfig::UNSCOPED) return "<unscoped>";
+        return names ? names(scope) : nullptr;
+    }
+}
+
+void AllocationTracker::ReportViolation(size_t bytes) {
+    auto& state = Get();
+    auto& thread = GetSteadyStateThread();
+    thread.reporting = true;
+
+    const uint16_t scope = CurrentScope();
+    const char* name = ScopeName(scope, state.m_markerNames.load(std::memory_order_relaxed));
+    std::fprintf(stderr, "Steady-state heap allocation: %zu bytes in %s (marker %u), frame %llu\n",
+                 bytes, name ? name : "<unnamed>", static_cast<unsigned>(scope),
+                 static_cast<unsigned long long>(state.m_steadyFrame.load(std::memory_order_relaxed)));
+    PrintStackTrace();
+    std::fflush(stderr);
+
+    thread.reporting = false;
+    if (state.m_policy.load(std::memory_order_relaxed) == SteadyStatePolicy::Abort) {
+        std::abort();
+    }
+}
+
+uint64_t AllocationTracker::WriteSteadyStateReport(FILE* out) {
+    auto& state = Get();
+    auto& thread = GetSteadyStateThread();
+    thread.reporting = true;
+
+    const uint64_t frames = state.m_steadyFrame.load(std::memory_order_relaxed);
+    const uint32_t warmup = state.m_warmupFrames.load(std::memory_order_relaxed);
+    const MarkerNameFn names = state.m_markerNames.load(std::memory_order_relaxed);
+    std::fprintf(out, "Steady-state allocation report: %llu frames checked after %u warm-up frames\n",
+                 static_cast<unsigned long long>(frames > warmup ? frames - warmup : 0), warmup);
+
+    uint64_t totalCount = 0;
+    uint64_t totalBytes = 0;
+    for (size_t id = 0; id <= TrackerConfig::MAX_MARKERS; ++id) {
+        const uint32_t count = state.m_violations[id].count.load(std::memory_order_relaxed);
+        if (count == 0) continue;
+        const uint64_t bytes = state.m_violations[id].bytes.load(std::memory_order_relaxed);
+
+        const char* name = ScopeName(static_cast<uint16_t>(id), names);
+        if (name) {
+            std::fprintf(out, "  %-40s %8u allocs %12llu bytes\n",
+                         name, count, static_cast<unsigned long long>(bytes));
+        } else {
+            std::fprintf(out, "  marker %-33zu %8u allocs %12llu bytes\n",
+                         id, count, static_cast<unsigned long long>(bytes));
+        }
+        totalCount += count;
+        totalBytes += bytes;
+    }
+
+    std::fprintf(out, "%s: %llu allocations, %llu bytes in steady state\n",
+                 totalCount == 0 ? "PASS" : "FAIL",
+                 static_cast<unsigned long long>(totalCount),
+                 static_cast<unsigned long long>(totalBytes));
+
+    thread.reporting = false;
+    return totalCount;
+}
+
+#if TETRIS_TRACK_ALLOCATIONS
+
+namespace {
+    void* TrackedAlloc(std::size_t size) {
+        AllocationTracker::Record(AllocationTracker::Source::Heap, size);
+        if (AllocationTracker::RecordSteadyStateViolation(size)) {
+            AllocationTracker::ReportViolation(size);
+        }
+        return std::malloc(size ? size : 1);
+    }
+
+    void* TrackedAlignedAlloc(std::size_t size, std::align_val_t alignment) {
+        AllocationTracker::Record(AllocationTracker::Source::Heap, size);
+        if (AllocationTracker::RecordSteadyStateViolation(size)) {
+            AllocationTracker::ReportViolation(size);
+        }
+        const std::size_t align = static_cast<std::size_t>(alignment);
+#if defined(_WIN32)
+        return _aligned_malloc(size ? size : 1, align);
+#else
+        // aligned_alloc requires the size to be a multiple of the alignment
+        const std::size_t rounded = ((size ? size : 1) + align - 1) & ~(align - 1);
+        return std::aligned_alloc(align, rounded);
+#endif
+    }
+
+    void TrackedFree(void* ptr) noexcept {
+        if (!ptr) return;
+        AllocationTracker::RecordFree();
+        std::free(ptr);
+    }
+
+    void TrackedAlignedFree(void* ptr) noexcept {
+        if (!ptr) return;
+        AllocationTracker::RecordFree();
+#if defined(_WIN32)
+        _aligned_free(ptr);
+#else
+        std::free(ptr);
+#endif
+    }
+}
+
+void* operator new(std::size_t size) {
+    if (void* ptr = TrackedAlloc(size)) return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    if (void* ptr = TrackedAlloc(size)) return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return TrackedAlloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return TrackedAlloc(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    if (void* ptr = TrackedAlignedAlloc(size, alignment)) return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    if (void* ptr = TrackedAlignedAlloc(size, alignment)) return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr) noexcept { TrackedFree(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { TrackedFree(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { TrackedFree(ptr); }
+
+void operator delete(void* ptr, std::align_val_t) noexcept { TrackedAlignedFree(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { TrackedAlignedFree(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { TrackedAlignedFree(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { TrackedAlignedFree(ptr); }
+
+#endif // TETRIS_TRACK_ALLOCATIONS
@@ -0,0 +1,254 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+
+// Global operator new/delete are replaced in AllocationTracker.cpp whenever
+// tracking is on. Defaults to the same builds that keep profiler markers.
+#ifndef TETRIS_TRACK_ALLOCATIONS
+    #if defined(ENABLE_PROFILING) || !defined(NDEBUG)
+        #define TETRIS_TRACK_ALLOCATIONS 1
+    #else
+        #define TETRIS_TRACK_ALLOCATIONS 0
+    #endif
+#endif
+
+// Attributes allocations to the innermost open profiler scope on the
+// allocating thread. Everything here is lock-free and allocation-free so it
+// can be called from inside operator new.
+class AllocationTracker {
+public:
+    enum class Source : uint8_t {
+        Heap,
+        FramePool,
+        PersistentPool,
+        UploadPool,
+        COUNT
+    };
+
+    // What to do about a heap allocation inside a SteadyStateScope once the
+    // warm-up frames have passed
+    enum class SteadyStatePolicy : uint8_t {
+        Off,
+        Report,     // count it for WriteSteadyStateReport
+        StackTrace, // also print the allocating call stack to stderr
+        Abort       // print the call stack and abort the run
+    };
+
+    struct TrackerConfig {
+        static constexpr size_t MAX_MARKERS = 1024; // matches ProfilerSystem
+        static constexpr size_t MAX_SCOPE_DEPTH = 64;
+        static constexpr uint16_t UNSCOPED = MAX_MARKERS; // extra slot
+        static constexpr size_t SOURCE_COUNT = static_cast<size_t>(Source::COUNT);
+        static constexpr uint32_t DEFAULT_WARMUP_FRAMES = 120; // ~2s at 60fps
+        static constexpr int MAX_STACK_FRAMES = 32;
+    };
+
+    using MarkerNameFn = const char* (*)(uint16_t markerId);
+
+    struct AllocationCounters {
+        uint32_t count;
+        uint64_t bytes;
+    };
+
+    struct AllocationSnapshot {
+        std::array<AllocationCounters, TrackerConfig::SOURCE_COUNT> bySource;
+        uint32_t heapFrees;
+
+        uint32_t TotalCount() const {
+            uint32_t total = 0;
+            for (const auto& counters : bySource) total += counters.count;
+            return total;
+        }
+
+        const AllocationCounters& Get(Source source) const {
+            return bySource[static_cast<size_t>(source)];
+        }
+    };
+
+    static void Record(Source source, size_t bytes) {
+        auto& state = Get();
+        const size_t src = static_cast<size_t>(source);
+        const uint16_t scope = CurrentScope();
+
+        state.m_markers[scope][src].count.fetch_add(1, std::memory_order_relaxed);
+        state.m_markers[scope][src].bytes.fetch_add(bytes, std::memory_order_relaxed);
+        state.m_frame[src].count.fetch_add(1, std::memory_order_relaxed);
+        state.m_frame[src].bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    // Counts a heap allocation against the steady-state check. Returns true
+    // when the policy asks for more than counting (see ReportViolation).
+    static bool RecordSteadyStateViolation(size_t bytes) {
+        auto& state = Get();
+        const auto policy = state.m_policy.load(std::memory_order_relaxed);
+        if (policy == SteadyStatePolicy::Off) return false;
+
+        const auto& thread = GetSteadyStateThread();
+        if (thread.depth == 0 || thread.reporting) return false;
+        if (state.m_steadyFrame.load(std::memory_order_relaxed) <
+            state.m_warmupFrames.load(std::memory_order_relaxed)) return false;
+
+        auto& counters = state.m_violations[CurrentScope()];
+        counters.count.fetch_add(1, std::memory_order_relaxed);
+        counters.bytes.fetch_add(bytes, std::memory_order_relaxed);
+        return policy != SteadyStatePolicy::Report;
+    }
+
+    // Prints the violating allocation and its call stack, then aborts if the
+    // policy says so. Defined in AllocationTracker.cpp.
+    static void ReportViolation(size_t bytes);
+
+    static void RecordFree() {
+        Get().m_frameHeapFrees.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static void PushScope(uint16_t markerId) {
+        auto& stack = GetScopeStack();
+        if (stack.depth < TrackerConfig::MAX_SCOPE_DEPTH) {
+            stack.ids[stack.depth] = markerId < TrackerConfig::MAX_MARKERS
+                ? markerId : TrackerConfig::UNSCOPED;
+        }
+        stack.depth++;
+    }
+
+    static void PopScope() {
+        auto& stack = GetScopeStack();
+        if (stack.depth > 0) stack.depth--;
+    }
+
+    // Returns this frame's totals and starts a new frame
+    static AllocationSnapshot EndFrame() {
+        auto& state = Get();
+        AllocationSnapshot snapshot = {};
+        for (size_t src = 0; src < TrackerConfig::SOURCE_COUNT; ++src) {
+            snapshot.bySource[src] = Exchange(state.m_frame[src]);
+        }
+        snapshot.heapFrees = state.m_frameHeapFrees.exchange(0, std::memory_order_relaxed);
+        return snapshot;
+    }
+
+    // Returns and resets the counters accumulated by one marker since the
+    // last call. Pass TrackerConfig::UNSCOPED for allocations outside scopes.
+    static AllocationSnapshot ConsumeMarker(uint16_t markerId) {
+        auto& state = Get();
+        AllocationSnapshot snapshot = {};
+        if (markerId > TrackerConfig::UNSCOPED) return snapshot;
+
+        for (size_t src = 0; src < TrackerConfig::SOURCE_COUNT; ++src) {
+            snapshot.bySource[src] = Exchange(state.m_markers[markerId][src]);
+        }
+        return snapshot;
+    }
+
+    // Marks code that must not touch the heap once the game is warmed up,
+    // e.g. Game::Update and Game::Render. Scopes nest per thread.
+    class SteadyStateScope {
+    public:
+        SteadyStateScope() { GetSteadyStateThread().depth++; }
+        ~SteadyStateScope() { GetSteadyStateThread().depth--; }
+
+        SteadyStateScope(const SteadyStateScope&) = delete;
+        SteadyStateScope& operator=(const SteadyStateScope&) = delete;
+    };
+
+    static void EnableSteadyStateCheck(SteadyStatePolicy policy,
+                                       uint32_t warmupFrames = TrackerConfig::DEFAULT_WARMUP_FRAMES) {
+        auto& state = Get();
+        state.m_warmupFrames.store(warmupFrames, std::memory_order_relaxed);
+        state.m_steadyFrame.store(0, std::memory_order_relaxed);
+        for (auto& counters : state.m_violations) Exchange(counters);
+        state.m_policy.store(policy, std::memory_order_relaxed);
+    }
+
+    // "report", "trace" or "abort", e.g. from the TETRIS_ZERO_ALLOC
+    // environment variable; anything else turns the check off
+    static SteadyStatePolicy ParsePolicy(const char* value) {
+        if (!value) return SteadyStatePolicy::Off;
+        const std::string_view name(value);
+        if (name == "report") return SteadyStatePolicy::Report;
+        if (name == "trace") return SteadyStatePolicy::StackTrace;
+        if (name == "abort") return SteadyStatePolicy::Abort;
+        return SteadyStatePolicy::Off;
+    }
+
+    static SteadyStatePolicy GetSteadyStatePolicy() {
+        return Get().m_policy.load(std::memory_order_relaxed);
+    }
+
+    // Advances the warm-up counter; call once per game loop iteration
+    static void AdvanceSteadyStateFrame() {
+        Get().m_steadyFrame.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Lets reports print marker names instead of slots (set by ProfilerSystem)
+    static void SetMarkerNameResolver(MarkerNameFn resolver) {
+        Get().m_markerNames.store(resolver, std::memory_order_relaxed);
+    }
+
+    // Writes the per-marker violation budget and returns the total number of
+    // violating allocations, so a soak run can turn it into an exit code.
+    // Defined in AllocationTracker.cpp.
+    static uint64_t WriteSteadyStateReport(FILE* out);
+
+private:
+    struct AtomicCounters {
+        std::atomic<uint32_t> count{0};
+        std::atomic<uint64_t> bytes{0};
+    };
+
+    struct ScopeStack {
+        std::array<uint16_t, TrackerConfig::MAX_SCOPE_DEPTH> ids;
+        size_t depth;
+    };
+
+    struct SteadyStateThread {
+        uint32_t depth;
+        bool reporting; // allocations made while reporting are not violations
+    };
+
+    std::array<std::array<AtomicCounters, TrackerConfig::SOURCE_COUNT>,
+               TrackerConfig::MAX_MARKERS + 1> m_markers;
+    std::array<AtomicCounters, TrackerConfig::SOURCE_COUNT> m_frame;
+    std::atomic<uint32_t> m_frameHeapFrees{0};
+
+    std::atomic<SteadyStatePolicy> m_policy{SteadyStatePolicy::Off};
+    std::atomic<uint32_t> m_warmupFrames{TrackerConfig::DEFAULT_WARMUP_FRAMES};
+    std::atomic<uint64_t> m_steadyFrame{0};
+    std::array<AtomicCounters, TrackerConfig::MAX_MARKERS + 1> m_violations;
+    std::atomic<MarkerNameFn> m_markerNames{nullptr};
+
+    // Constant-initialized so operator new can run before main()
+    static AllocationTracker& Get() {
+        static constinit AllocationTracker tracker;
+        return tracker;
+    }
+
+    static ScopeStack& GetScopeStack() {
+        static constinit thread_local ScopeStack stack = {};
+        return stack;
+    }
+
+    static SteadyStateThread& GetSteadyStateThread() {
+        static constinit thread_local SteadyStateThread thread = {};
+        return thread;
+    }
+
+    static uint16_t CurrentScope() {
+        const auto& stack = GetScopeStack();
+        if (stack.depth == 0) return TrackerConfig::UNSCOPED;
+        size_t top = std::min(stack.depth, TrackerConfig::MAX_SCOPE_DEPTH) - 1;
+        return stack.ids[top];
+    }
+
+    static AllocationCounters Exchange(AtomicCounters& counters) {
+        return {
+            counters.count.exchange(0, std::memory_order_relaxed),
+            counters.bytes.exchange(0, std::memory_order_relaxed)
+        };
+    }
+};
@@ -0,0 +1,275 @@
+#pragma once
+#include "GridMesher.hpp"
+#include "RenderBackend.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+
+// The locked blocks as individual cube faces, keeping only the faces that
+// touch an empty cell or the outside of the well. Unlike GridMesher it never
+// rebuilds: a lock refreshes the locked cells and their neighbours, and a
+// clear re-labels layer slices, so only the vertices that changed are sent
+// to a persistent Default vertex buffer.
+//
+// The buffer is split into one fixed slice per layer holding that layer's
+// faces packed from the start, in layer-local coordinates (y in
+// [-0.5, 0.5]). Each layer is drawn with a translation to its height, so a
+// slice that slides down after a clear keeps its vertices untouched.
+class BoardFaceMesh {
+public:
+    static constexpr int W = GameState::GRID_WIDTH;
+    static constexpr int H = GameState::GRID_HEIGHT;
+    static constexpr int D = GameState::GRID_DEPTH;
+
+    struct FaceMeshConfig {
+        static constexpr uint32_t MAX_SLICE_QUADS = 6 * W * D;
+        static constexpr uint32_t MAX_QUADS = MAX_SLICE_QUADS * H;
+        static constexpr uint32_t VERTEX_BUFFER_BYTES = MAX_QUADS * 4 * sizeof(GridMesher::Vertex);
+    };
+
+    using Vertex = GridMesher::Vertex;
+
+    struct Cell {
+        int x, y, z;
+    };
+
+    // Where layer y's faces are in the vertex buffer
+    struct LayerRange {
+        uint32_t firstQuad;
+        uint32_t quadCount;
+    };
+
+    BoardFaceMesh() { Reset(); }
+
+    void Reset() {
+        m_colors = {};
+        for (int y = 0; y < H; ++y) {
+            m_sliceOfLayer[y] = static_cast<uint8_t>(y);
+            EmptySlice(m_slices[y]);
+        }
+    }
+
+    // Meshes a whole board from scratch; the next Upload sends every face
+    void Rebuild(const GameState::ColorGridType& colors) {
+        Reset();
+        m_colors = colors;
+        for (int x = 0; x < W; ++x) {
+            for (int y = 0; y < H; ++y) {
+                for (int z = 0; z < D; ++z) RefreshCell(x, y, z);
+            }
+        }
+    }
+
+    // Takes the new colour of each cell in `cells` (a locked piece, at most
+    // four) and refreshes those cells and their neighbours
+    void UpdateCells(const GameState::ColorGridType& colors, std::span<const Cell> cells) {
+        for (const Cell& cell : cells) {
+            if (!GameState::IsValidPosition(cell.x, cell.y, cell.z)) continue;
+            uint8_t& color = m_colors[cell.x][cell.y][cell.z];
+            if (color == colors[cell.x][cell.y][cell.z]) continue;
+            // Faces carry their colour, so a recoloured cell starts over
+            RemoveCellFaces(cell.x, cell.y, cell.z);
+            color = colors[cell.x][cell.y][cell.z];
+        }
+
+        static constexpr int NEIGHBOURS[7][3] = {{0, 0, 0}, {-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}};
+        for (const Cell& cell : cells) {
+            for (const auto& n : NEIGHBOURS) {
+                const int x = cell.x + n[0], y = cell.y + n[1], z = cell.z + n[2];
+                if (GameState::IsValidPosition(x, y, z)) RefreshCell(x, y, z);
+            }
+        }
+    }
+
+    // Mirrors GameState::ClearFullLayers on the mesh: full layers are
+    // removed and the slices above are relabelled one layer lower each,
+    // then only the layers that gained a new neighbour are refreshed.
+    // Returns the number of layers cleared.
+    int ClearFullLayers() {
+        std::array<int, H> sourceOfLayer{}; // old layer index, or -1 for a new empty layer
+        std::array<uint8_t, H> sliceOfLayer{};
+        int kept = 0;
+        for (int y = 0; y < H; ++y) {
+            if (IsLayerFull(y)) continue;
+            sourceOfLayer[kept] = y;
+            sliceOfLayer[kept++] = m_sliceOfLayer[y];
+        }
+        const int cleared = H - kept;
+        if (cleared == 0) return 0;
+
+        // Cleared slices are emptied and reused for the new top layers
+        for (int y = 0, top = kept; y < H; ++y) {
+            if (!IsLayerFull(y)) continue;
+            EmptySlice(m_slices[m_sliceOfLayer[y]]);
+            sourceOfLayer[top] = -1;
+            sliceOfLayer[top++] = m_sliceOfLayer[y];
+        }
+
+        for (int y = 0; y < H; ++y) {
+            for (int x = 0; x < W; ++x) {
+                for (int z = 0; z < D; ++z) {
+                    m_colors[x][y][z] = sourceOfLayer[y] < 0 ? 0 : m_colors[x][sourceOfLayer[y]][z];
+                }
+            }
+        }
+        m_sliceOfLayer = sliceOfLayer;
+
+        // A layer whose neighbour below changed needs its bottom faces and
+        // that neighbour's top faces re-checked
+        for (int y = 0; y < kept; ++y) {
+            const int below = y == 0 ? -1 : sourceOfLayer[y - 1];
+            if (below == sourceOfLayer[y] - 1) continue;
+            RefreshLayer(y);
+            if (y > 0) RefreshLayer(y - 1);
+        }
+        if (kept > 0) RefreshLayer(kept - 1); // the layer now under empty space
+        return cleared;
+    }
+
+    // Sends the dirty part of each slice to `vertexBuffer`, a Default
+    // buffer of FaceMeshConfig::VERTEX_BUFFER_BYTES; returns bytes sent
+    uint32_t Upload(RenderBackend& backend, BufferHandle vertexBuffer) {
+        uint32_t bytes = 0;
+        for (uint32_t s = 0; s < H; ++s) {
+            Slice& slice = m_slices[s];
+            if (slice.dirtyBegin >= slice.dirtyEnd) continue;
+            const auto data = std::as_bytes(std::span(slice.vertices).subspan(
+                slice.dirtyBegin * 4, (slice.dirtyEnd - slice.dirtyBegin) * 4));
+            const uint32_t offset = (s * FaceMeshConfig::MAX_SLICE_QUADS + slice.dirtyBegin) * 4 * sizeof(Vertex);
+            backend.UpdateBuffer(vertexBuffer, data, offset);
+            bytes += static_cast<uint32_t>(data.size());
+            slice.dirtyBegin = FaceMeshConfig::MAX_SLICE_QUADS;
+            slice.dirtyEnd = 0;
+        }
+        return bytes;
+    }
+
+    LayerRange GetLayerRange(int y) const {
+        const uint8_t slice = m_sliceOfLayer[y];
+        return {slice * FaceMeshConfig::MAX_SLICE_QUADS, m_slices[slice].count};
+    }
+
+    uint32_t GetQuadCount() const {
+        uint32_t total = 0;
+        for (const Slice& slice : m_slices) total += slice.count;
+        return total;
+    }
+
+    // Layer y's faces as written to the buffer
+    std::span<const Vertex> GetLayerVertices(int y) const {
+        const Slice& slice = m_slices[m_sliceOfLayer[y]];
+        return std::span(slice.vertices).first(slice.count * 4);
+    }
+
+private:
+    static constexpr uint8_t NO_QUAD = 0xff;
+    static_assert(FaceMeshConfig::MAX_SLICE_QUADS < NO_QUAD, "quad indices within a slice must fit a byte");
+
+    struct Slice {
+        std::array<Vertex, FaceMeshConfig::MAX_SLICE_QUADS * 4> vertices;
+        std::array<uint8_t, W * D * 6> quadOfFace; // (x * D + z) * 6 + face -> quad, or NO_QUAD
+        std::array<uint8_t, FaceMeshConfig::MAX_SLICE_QUADS> faceOfQuad;
+        uint32_t count;
+        uint32_t dirtyBegin, dirtyEnd; // quads not yet uploaded
+    };
+
+    GameState::ColorGridType m_colors{};
+    std::array<uint8_t, H> m_sliceOfLayer{};
+    std::array<Slice, H> m_slices;
+
+    static void EmptySlice(Slice& slice) {
+        slice.quadOfFace.fill(NO_QUAD);
+        slice.count = 0;
+        slice.dirtyBegin = FaceMeshConfig::MAX_SLICE_QUADS;
+        slice.dirtyEnd = 0;
+    }
+
+    static void MarkDirty(Slice& slice, uint32_t quad) {
+        slice.dirtyBegin = std::min(slice.dirtyBegin, quad);
+        slice.dirtyEnd = std::max(slice.dirtyEnd, quad + 1);
+    }
+
+    bool Occupied(int x, int y, int z) const {
+        if (y < 0) return true; // the floor hides bottom faces
+        if (!GameState::IsValidPosition(x, y, z)) return false;
+        return m_colors[x][y][z] != 0;
+    }
+
+    bool IsLayerFull(int y) const {
+        for (int x = 0; x < W; ++x) {
+            for (int z = 0; z < D; ++z) {
+                if (m_colors[x][y][z] == 0) return false;
+            }
+        }
+        return true;
+    }
+
+    void RefreshLayer(int y) {
+        for (int x = 0; x < W; ++x) {
+            for (int z = 0; z < D; ++z) RefreshCell(x, y, z);
+        }
+    }
+
+    // Adds the faces of (x, y, z) that became exposed and removes the ones
+    // that became hidden; faces that stay are left alone
+    void RefreshCell(int x, int y, int z) {
+        static constexpr int NORMALS[6][3] = {{-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}};
+        Slice& slice = m_slices[m_sliceOfLayer[y]];
+        const uint8_t color = m_colors[x][y][z];
+        for (uint8_t face = 0; face < 6; ++face) {
+            const uint32_t key = (x * D + z) * 6 + face;
+            const bool exposed = color != 0 &&
+                                 !Occupied(x + NORMALS[face][0], y + NORMALS[face][1], z + NORMALS[face][2]);
+            const bool present = slice.quadOfFace[key] != NO_QUAD;
+            if (exposed && !present) {
+                AddFace(slice, key, x, z, face, color);
+            } else if (!exposed && present) {
+                RemoveFace(slice, key);
+            }
+        }
+    }
+
+    void RemoveCellFaces(int x, int y, int z) {
+        Slice& slice = m_slices[m_sliceOfLayer[y]];
+        for (uint32_t face = 0; face < 6; ++face) {
+            const uint32_t key = (x * D + z) * 6 + face;
+            if (slice.quadOfFace[key] != NO_QUAD) RemoveFace(slice, key);
+        }
+    }
+
+    static void AddFace(Slice& slice, uint32_t key, int x, int z, uint8_t face, uint8_t color) {
+        // GridMesher::WriteVertices' corner order for a one-cell quad
+        static constexpr uint8_t CORNERS[6][4] = {
+            {4, 6, 2, 0}, {1, 3, 7, 5}, {4, 0, 1, 5}, {2, 6, 7, 3}, {0, 2, 3, 1}, {4, 5, 7, 6}
+        };
+
+        const uint32_t quad = slice.count++;
+        slice.quadOfFace[key] = static_cast<uint8_t>(quad);
+        slice.faceOfQuad[quad] = static_cast<uint8_t>(key);
+
+        const float minX = x - W / 2.0f - 0.5f;
+        const float minZ = z - D / 2.0f - 0.5f;
+        const XMFLOAT4& rgba = GameState::PIECE_COLORS[(color - 1) % GameState::PIECE_COLORS.size()];
+        for (int k = 0; k < 4; ++k) {
+            const uint8_t corner = CORNERS[face][k];
+            slice.vertices[quad * 4 + k] = {
+                XMFLOAT3(minX + (corner & 1), ((corner >> 1) & 1) - 0.5f, minZ + ((corner >> 2) & 1)), rgba};
+        }
+        MarkDirty(slice, quad);
+    }
+
+    // Keeps the slice packed by moving its last quad into the hole
+    static void RemoveFace(Slice& slice, uint32_t key) {
+        const uint32_t quad = slice.quadOfFace[key];
+        const uint32_t last = --slice.count;
+        slice.quadOfFace[key] = NO_QUAD;
+        if (quad == last) return;
+
+        const uint8_t movedKey = slice.faceOfQuad[last];
+        std::copy_n(&slice.vertices[last * 4], 4, &slice.vertices[quad * 4]);
+        slice.faceOfQuad[quad] = movedKey;
+        slice.quadOfFace[movedKey] = static_cast<uint8_t>(quad);
+        MarkDirty(slice, quad);
+    }
+};
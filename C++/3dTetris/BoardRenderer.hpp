@@ -0,0 +1,244 @@
+#pragma once
+#include "FrustumCuller.hpp"
+#include "GameState.hpp"
+#include "RenderPipeline.hpp"
+#include <algorithm>
+#include <array>
+#include <span>
+#include <vector>
+
+// Draws the well's cubes (locked blocks, falling piece, its ghost and the
+// held piece) as instances of one cube mesh through RenderPipeline, so a
+// frame costs a few instanced draws and a single instance upload instead of
+// a constant-buffer update and draw per cube.
+//
+// Locked blocks are kept in one static pipeline range per layer. A layer's
+// instances are rebuilt and uploaded only after GameState reports it
+// dirty, so a frame in which nothing locks or clears sends just the pieces.
+//
+// Cubes outside the camera's frustum are dropped before they reach the
+// pipeline (locked layers as a whole); GetCullStats reports how many.
+//
+// The shader reads the instance stream at RenderPipeline::INSTANCE_SLOT and
+// the camera from constant buffer 0 (VS_Instanced and PS_Block in
+// Shaders.hlsl).
+class BoardRenderer {
+public:
+    struct BoardRendererConfig {
+        static constexpr uint32_t MAX_CUBES = 3 * 4; // per frame: the falling, ghost and held pieces
+        static constexpr float GHOST_ALPHA = 0.3f;
+        static constexpr uint32_t LAYER_CELLS = GameState::GRID_WIDTH * GameState::GRID_DEPTH;
+    };
+    static_assert(GameState::GRID_HEIGHT * BoardRendererConfig::LAYER_CELLS <= RenderPipeline::MAX_STATIC_INSTANCES,
+                  "every layer gets a static range");
+
+    enum class Style : uint8_t {
+        Solid, // opaque, writes depth
+        Ghost  // translucent, drawn after every solid cube
+    };
+
+    // View and projection, transposed for HLSL
+    struct Camera {
+        XMFLOAT4X4 view;
+        XMFLOAT4X4 projection;
+    };
+
+    BoardRenderer(RenderBackend& backend, uint32_t shader) : m_backend(backend), m_pipeline(backend) {
+        // Unit cube around the origin; white, so the instance colour is the
+        // block colour
+        struct Vertex { XMFLOAT3 position; XMFLOAT4 color; };
+        static constexpr XMFLOAT4 WHITE = {1.0f, 1.0f, 1.0f, 1.0f};
+        static constexpr Vertex CUBE[8] = {
+            {{-0.5f, -0.5f, -0.5f}, WHITE}, {{-0.5f, 0.5f, -0.5f}, WHITE}, {{0.5f, 0.5f, -0.5f}, WHITE}, {{0.5f, -0.5f, -0.5f}, WHITE},
+            {{-0.5f, -0.5f, 0.5f}, WHITE}, {{-0.5f, 0.5f, 0.5f}, WHITE}, {{0.5f, 0.5f, 0.5f}, WHITE}, {{0.5f, -0.5f, 0.5f}, WHITE}
+        };
+        static constexpr uint16_t INDICES[36] = {
+            0,1,2, 0,2,3,  4,6,5, 4,7,6,  4,5,1, 4,1,0,
+            3,2,6, 3,6,7,  1,5,6, 1,6,2,  4,0,3, 4,3,7
+        };
+        m_cubeVertices = backend.CreateBuffer({BufferKind::Vertex, BufferUsage::Immutable, sizeof(CUBE), sizeof(Vertex)},
+                                              std::as_bytes(std::span(CUBE)));
+        m_cubeIndices = backend.CreateBuffer({BufferKind::Index, BufferUsage::Immutable, sizeof(INDICES), sizeof(uint16_t)},
+                                             std::as_bytes(std::span(INDICES)));
+        m_cube = m_pipeline.AddMesh({m_cubeVertices, m_cubeIndices, sizeof(Vertex), 36});
+
+        // The ghost pipeline is created second so its commands sort, and
+        // blend, after the solid ones
+        m_solidPipeline = backend.CreatePipeline({shader, BlendMode::Opaque, DepthMode::TestWrite});
+        m_ghostPipeline = backend.CreatePipeline({shader, BlendMode::Alpha, DepthMode::TestOnly});
+        m_materials[size_t(Style::Solid)] = m_pipeline.AddMaterial({m_solidPipeline, static_cast<uint16_t>(shader)});
+        m_materials[size_t(Style::Ghost)] = m_pipeline.AddMaterial({m_ghostPipeline, static_cast<uint16_t>(shader)});
+
+        m_camera = backend.CreateBuffer({BufferKind::Constant, BufferUsage::Default, sizeof(Camera), 0});
+        for (auto& instances : m_instances) instances.reserve(BoardRendererConfig::MAX_CUBES);
+        for (uint32_t& range : m_layerRanges) {
+            range = m_pipeline.AddStaticRange(m_cube, m_materials[size_t(Style::Solid)], BoardRendererConfig::LAYER_CELLS);
+        }
+
+        // Every layer's bounds share their x, z centre and extents
+        const XMFLOAT3 center = CellCenter((GameState::GRID_WIDTH - 1) / 2.0f, 0.0f, (GameState::GRID_DEPTH - 1) / 2.0f);
+        for (int y = 0; y < GameState::GRID_HEIGHT; y++) {
+            m_layerBounds.x[y] = center.x;
+            m_layerBounds.y[y] = float(y);
+            m_layerBounds.z[y] = center.z;
+        }
+    }
+
+    ~BoardRenderer() {
+        m_backend.DestroyBuffer(m_cubeVertices);
+        m_backend.DestroyBuffer(m_cubeIndices);
+        m_backend.DestroyBuffer(m_camera);
+        m_backend.DestroyPipeline(m_solidPipeline);
+        m_backend.DestroyPipeline(m_ghostPipeline);
+    }
+
+    BoardRenderer(const BoardRenderer&) = delete;
+    BoardRenderer& operator=(const BoardRenderer&) = delete;
+
+    void SetCamera(const Camera& camera) {
+        m_backend.UpdateBufferFrom(m_camera, camera);
+        m_culler.SetTransposedViewProjection(camera.view, camera.projection);
+    }
+
+    void BeginFrame() {
+        for (auto& instances : m_instances) instances.clear();
+        m_gridStats = {};
+        m_blockStats = {};
+        m_gridUploadBytes = 0;
+        m_pipeline.BeginFrame();
+    }
+
+    // Every locked cell, in its piece's colour. Only the layers `state`
+    // changed since the last call are rebuilt and uploaded; a generation
+    // that went backwards (a state replaced by a fresh one) rebuilds all.
+    void SubmitGrid(const GameState& state) {
+        const bool current = m_gridBuilt && state.gridGeneration >= m_gridGeneration;
+        const uint32_t dirty = current ? state.DirtyLayersSince(m_gridGeneration) : GameState::ALL_LAYERS;
+        m_gridGeneration = state.gridGeneration;
+        m_gridBuilt = true;
+        for (int y = 0; y < GameState::GRID_HEIGHT; y++) {
+            if (dirty & (1u << y)) RebuildLayer(state.colors, y);
+        }
+
+        m_culler.CullBoxes(m_layerBounds.x, m_layerBounds.y, m_layerBounds.z, LAYER_HALF_EXTENTS,
+                           GameState::GRID_HEIGHT, m_layerBounds.visible);
+        for (int y = 0; y < GameState::GRID_HEIGHT; y++) {
+            m_gridStats.tested += m_layerCounts[y];
+            if (!FrustumCuller::IsVisible(m_layerBounds.visible, y)) continue;
+            m_gridStats.visible += m_layerCounts[y];
+            m_pipeline.SubmitStatic(m_layerRanges[y]);
+        }
+    }
+
+    // A piece's blocks at `position` in grid cells
+    void SubmitBlocks(std::span<const XMFLOAT3> blocks, const XMFLOAT3& position, XMFLOAT4 color, Style style) {
+        if (style == Style::Ghost) color.w = BoardRendererConfig::GHOST_ALPHA;
+        auto& instances = m_instances[size_t(style)];
+        for (size_t first = 0; first < blocks.size(); first += 8) {
+            const auto count = static_cast<uint32_t>(std::min<size_t>(8, blocks.size() - first));
+            alignas(32) float x[8] = {}, y[8] = {}, z[8] = {};
+            for (uint32_t i = 0; i < count; i++) {
+                const XMFLOAT3& block = blocks[first + i];
+                const XMFLOAT3 center = CellCenter(position.x + block.x, position.y + block.y, position.z + block.z);
+                x[i] = center.x;
+                y[i] = center.y;
+                z[i] = center.z;
+            }
+            uint8_t visible;
+            m_blockStats.tested += count;
+            m_blockStats.visible += m_culler.CullBoxes(x, y, z, CUBE_HALF_EXTENTS, count, &visible);
+            for (uint32_t i = 0; i < count; i++) {
+                if (FrustumCuller::IsVisible(&visible, i)) instances.push_back(MakeInstance({x[i], y[i], z[i]}, color));
+            }
+        }
+    }
+
+    // Frustum of the last SetCamera, for other renderers to cull against
+    const FrustumCuller& GetFrustum() const { return m_culler; }
+
+    // Cubes tested against the frustum since BeginFrame, and how many of
+    // them were kept
+    FrustumCuller::CullStats GetCullStats() const {
+        return {m_gridStats.tested + m_blockStats.tested, m_gridStats.visible + m_blockStats.visible};
+    }
+
+    // Instance bytes SubmitGrid uploaded since BeginFrame; zero unless the
+    // board changed
+    uint32_t GetGridUploadBytes() const { return m_gridUploadBytes; }
+
+    // Draws everything submitted since BeginFrame into the backend's
+    // current frame; `jobs` spreads the instance upload
+    void EndFrame(JobSystem* jobs = nullptr) {
+        m_backend.SetConstantBuffer(0, m_camera);
+        for (size_t style = 0; style < m_instances.size(); style++) {
+            if (!m_instances[style].empty()) m_pipeline.Submit(m_cube, m_materials[style], m_instances[style]);
+        }
+        m_pipeline.EndFrame(jobs);
+    }
+
+private:
+    static constexpr XMFLOAT3 CUBE_HALF_EXTENTS = {0.5f, 0.5f, 0.5f};
+    static constexpr XMFLOAT3 LAYER_HALF_EXTENTS = {GameState::GRID_WIDTH / 2.0f, 0.5f, GameState::GRID_DEPTH / 2.0f};
+    static constexpr uint32_t PADDED_LAYERS = (GameState::GRID_HEIGHT + 7) & ~7u;
+
+    // Bounds of each layer, laid out for FrustumCuller
+    struct LayerBounds {
+        alignas(32) float x[PADDED_LAYERS];
+        alignas(32) float y[PADDED_LAYERS];
+        alignas(32) float z[PADDED_LAYERS];
+        uint8_t visible[PADDED_LAYERS / 8];
+    };
+
+    RenderBackend& m_backend;
+    RenderPipeline m_pipeline;
+    BufferHandle m_cubeVertices;
+    BufferHandle m_cubeIndices;
+    BufferHandle m_camera;
+    PipelineHandle m_solidPipeline;
+    PipelineHandle m_ghostPipeline;
+    uint32_t m_cube = 0;
+    std::array<uint32_t, 2> m_materials{};
+    std::array<std::vector<RenderPipeline::InstanceData>, 2> m_instances; // by Style
+    FrustumCuller m_culler;
+    FrustumCuller::CullStats m_gridStats{};
+    FrustumCuller::CullStats m_blockStats{};
+
+    // The locked blocks as the pipeline holds them
+    std::array<uint32_t, GameState::GRID_HEIGHT> m_layerRanges{};  // static range of each layer
+    std::array<uint32_t, GameState::GRID_HEIGHT> m_layerCounts{};  // cubes in each layer
+    std::array<RenderPipeline::InstanceData, BoardRendererConfig::LAYER_CELLS> m_layerScratch;
+    LayerBounds m_layerBounds{};
+    uint64_t m_gridGeneration = 0; // GameState::gridGeneration the ranges match
+    bool m_gridBuilt = false;
+    uint32_t m_gridUploadBytes = 0;
+
+    void RebuildLayer(const GameState::ColorGridType& colors, int y) {
+        uint32_t count = 0;
+        for (int x = 0; x < GameState::GRID_WIDTH; x++) {
+            for (int z = 0; z < GameState::GRID_DEPTH; z++) {
+                const uint8_t color = colors[x][y][z];
+                if (color == 0) continue;
+                m_layerScratch[count++] = MakeInstance(CellCenter(float(x), float(y), float(z)),
+                    GameState::PIECE_COLORS[(color - 1) % GameState::PIECE_COLORS.size()]);
+            }
+        }
+        m_layerCounts[y] = count;
+        m_gridUploadBytes += m_pipeline.UpdateStaticRange(m_layerRanges[y], std::span(m_layerScratch).first(count));
+    }
+
+    // Cell (x, y, z) is centred on (x - width / 2, y, z - depth / 2)
+    static XMFLOAT3 CellCenter(float x, float y, float z) {
+        return {x - GameState::GRID_WIDTH / 2.0f, y, z - GameState::GRID_DEPTH / 2.0f};
+    }
+
+    static RenderPipeline::InstanceData MakeInstance(const XMFLOAT3& center, const XMFLOAT4& color) {
+        RenderPipeline::InstanceData instance;
+        instance.world = XMFLOAT4X4(1, 0, 0, 0,
+                                    0, 1, 0, 0,
+                                    0, 0, 1, 0,
+                                    center.x, center.y, center.z, 1);
+        instance.color = color;
+        instance.userData = XMFLOAT4(0, 0, 0, 0);
+        return instance;
+    }
+};
@@ -0,0 +1,133 @@
+#pragma once
+#include <atomic>
+#include "VirtualArena.hpp"
+
+// Lock-free bump allocator for scratch memory shared between threads during
+// a frame. Allocation is a CAS on the head offset; pages are committed on
+// demand by whichever thread crosses the committed boundary (committing is
+// idempotent, so racing threads are harmless). Reset() is not thread-safe
+// and belongs at the frame boundary, when no worker is allocating.
+class ConcurrentArena : public std::pmr::memory_resource {
+public:
+    using ArenaConfig = VirtualArena::ArenaConfig;
+    using ArenaDesc = VirtualArena::ArenaDesc;
+    using ArenaStats = VirtualArena::ArenaStats;
+
+    explicit ConcurrentArena(const ArenaDesc& desc) : m_desc(desc) {
+        m_reserved = VirtualMemory::AlignUp(desc.reserveSize, ArenaConfig::COMMIT_GRANULARITY);
+        m_base = VirtualMemory::Reserve(m_reserved);
+        if (!m_base) m_reserved = 0;
+        EnsureCommitted(desc.minCommit);
+    }
+
+    ~ConcurrentArena() override {
+        if (m_base) VirtualMemory::Release(m_base, m_reserved);
+    }
+
+    ConcurrentArena(const ConcurrentArena&) = delete;
+    ConcurrentArena& operator=(const ConcurrentArena&) = delete;
+
+    void Reset() {
+        const size_t used = m_head.exchange(0, std::memory_order_relaxed);
+        m_recentHighWater = std::max(m_recentHighWater, used);
+        m_highWater = std::max(m_highWater, used);
+
+        const size_t committed = m_committed.load(std::memory_order_relaxed);
+        if (m_recentHighWater * ArenaConfig::DECOMMIT_RATIO >= committed) {
+            m_lowUseFrames = 0;
+            m_recentHighWater = 0;
+        } else if (++m_lowUseFrames >= ArenaConfig::DECOMMIT_FRAMES) {
+            size_t keep = VirtualMemory::AlignUp(
+                std::max(m_recentHighWater + m_recentHighWater / 2, m_desc.minCommit),
+                ArenaConfig::COMMIT_GRANULARITY);
+            if (keep < committed) {
+                VirtualMemory::Decommit(m_base + keep, committed - keep);
+                m_committed.store(keep, std::memory_order_relaxed);
+            }
+            m_lowUseFrames = 0;
+            m_recentHighWater = 0;
+        }
+    }
+
+    const char* GetName() const { return m_desc.name; }
+    size_t Used() const { return m_head.load(std::memory_order_relaxed); }
+
+    ArenaStats GetStats() const {
+        const size_t used = Used();
+        return {
+            used,
+            m_committed.load(std::memory_order_relaxed),
+            m_reserved,
+            std::max(m_highWater, used),
+            std::max(m_recentHighWater, used),
+            m_overflowCount.load(std::memory_order_relaxed),
+            m_overflowBytes.load(std::memory_order_relaxed)
+        };
+    }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        size_t offset, end;
+        do {
+            offset = VirtualMemory::AlignUp(head, alignment);
+            end = offset + bytes;
+            if (end > m_reserved) {
+                ReportOverflow(bytes);
+                throw std::bad_alloc();
+            }
+        } while (!m_head.compare_exchange_weak(head, end, std::memory_order_relaxed));
+
+        if (!EnsureCommitted(end)) {
+            ReportOverflow(bytes);
+            throw std::bad_alloc();
+        }
+        return m_base + offset;
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {
+        // Memory is reclaimed by Reset()
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+private:
+    ArenaDesc m_desc;
+    std::byte* m_base = nullptr;
+    size_t m_reserved = 0;
+    std::atomic<size_t> m_head{0};
+    std::atomic<size_t> m_committed{0};
+    std::atomic<uint32_t> m_overflowCount{0};
+    std::atomic<size_t> m_overflowBytes{0};
+
+    // Only touched by Reset() on the owning thread
+    size_t m_highWater = 0;
+    size_t m_recentHighWater = 0;
+    uint32_t m_lowUseFrames = 0;
+
+    bool EnsureCommitted(size_t end) {
+        size_t committed = m_committed.load(std::memory_order_acquire);
+        if (end <= committed) return true;
+        if (!m_base) return false;
+
+        const size_t target = std::min(
+            VirtualMemory::AlignUp(end, ArenaConfig::COMMIT_GRANULARITY), m_reserved);
+        if (!VirtualMemory::Commit(m_base + committed, target - committed)) return false;
+
+        // Publish the larger boundary; a racing thread may already have
+        while (committed < target &&
+               !m_committed.compare_exchange_weak(committed, target, std::memory_order_release)) {
+        }
+        return true;
+    }
+
+    void ReportOverflow(size_t bytes) {
+        m_overflowCount.fetch_add(1, std::memory_order_relaxed);
+        size_t largest = m_overflowBytes.load(std::memory_order_relaxed);
+        while (largest < bytes &&
+               !m_overflowBytes.compare_exchange_weak(largest, bytes, std::memory_order_relaxed)) {
+        }
+    }
+};
@@ -0,0 +1,321 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <array>
+#include <vector>
+#include "RenderBackend.hpp"
+#include "ResourceCache.hpp"
+#include "ShaderSystem.h"
+
+using Microsoft::WRL::ComPtr;
+
+// RenderBackend on a D3D11 immediate context. Pipelines resolve to blend,
+// depth and rasterizer states plus a shader program registered under the id
+// PipelineDesc::shader names.
+//
+// Driver objects are never created per frame: state objects, pipelines and
+// the depth target come from caches keyed by their descriptor, so equal
+// descriptors share one object and only a resize creates new targets.
+class D3D11RenderBackend final : public RenderBackend {
+public:
+    // Describes a transient depth target; padding-free so it hashes by bytes
+    struct TargetDesc {
+        UINT width;
+        UINT height;
+        DXGI_FORMAT format;
+        UINT sampleCount;
+    };
+
+    D3D11RenderBackend(ID3D11Device* device, ID3D11DeviceContext* context, IDXGISwapChain* swapChain,
+                       ID3D11RenderTargetView* renderTarget, uint32_t width, uint32_t height)
+        : m_device(device), m_context(context), m_swapChain(swapChain), m_renderTarget(renderTarget) {
+        m_depthStencil = AcquireDepthTarget({width, height, DXGI_FORMAT_D24_UNORM_S8_UINT, 1});
+    }
+
+    // Makes `program` (owned by ShaderSystem) available as PipelineDesc::shader
+    void RegisterShader(uint32_t shader, const ShaderSystem::ShaderResources* program) {
+        if (shader >= m_shaders.size()) m_shaders.resize(shader + 1, nullptr);
+        m_shaders[shader] = program;
+    }
+
+    // Takes the back buffer view of a resized swap chain; depth targets of
+    // any other size are released and the frame's one recreated
+    void Resize(ID3D11RenderTargetView* renderTarget, uint32_t width, uint32_t height) {
+        m_renderTarget = renderTarget;
+        m_context->OMSetRenderTargets(0, nullptr, nullptr);
+        m_targets.EvictIf([&](const TargetDesc& desc) { return desc.width != width || desc.height != height; });
+        m_depthStencil = AcquireDepthTarget({width, height, DXGI_FORMAT_D24_UNORM_S8_UINT, 1});
+    }
+
+    // A depth buffer for `desc`, created the first time it is asked for and
+    // kept until a resize; nullptr if the device refuses it
+    ID3D11DepthStencilView* AcquireDepthTarget(const TargetDesc& desc) {
+        DepthTarget* target = m_targets.Acquire(desc, [&](const TargetDesc& d, DepthTarget& out) {
+            D3D11_TEXTURE2D_DESC textureDesc = {};
+            textureDesc.Width = d.width;
+            textureDesc.Height = d.height;
+            textureDesc.MipLevels = 1;
+            textureDesc.ArraySize = 1;
+            textureDesc.Format = d.format;
+            textureDesc.SampleDesc.Count = d.sampleCount;
+            textureDesc.Usage = D3D11_USAGE_DEFAULT;
+            textureDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+            return SUCCEEDED(m_device->CreateTexture2D(&textureDesc, nullptr, &out.texture)) &&
+                   SUCCEEDED(m_device->CreateDepthStencilView(out.texture.Get(), nullptr, &out.view));
+        });
+        return target ? target->view.Get() : nullptr;
+    }
+
+    BufferHandle CreateBuffer(const BufferDesc& desc, std::span<const std::byte> initialData = {}) override {
+        D3D11_BUFFER_DESC bufferDesc = {};
+        bufferDesc.ByteWidth = desc.byteWidth;
+        bufferDesc.StructureByteStride = desc.stride;
+        switch (desc.kind) {
+            case BufferKind::Vertex:   bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER; break;
+            case BufferKind::Index:    bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER; break;
+            case BufferKind::Constant: bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER; break;
+        }
+        switch (desc.usage) {
+            case BufferUsage::Immutable: bufferDesc.Usage = D3D11_USAGE_IMMUTABLE; break;
+            case BufferUsage::Default:   bufferDesc.Usage = D3D11_USAGE_DEFAULT; break;
+            case BufferUsage::Dynamic:
+                bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+                bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+                break;
+        }
+
+        D3D11_SUBRESOURCE_DATA data = {};
+        data.pSysMem = initialData.data();
+        ComPtr<ID3D11Buffer> buffer;
+        if (FAILED(m_device->CreateBuffer(&bufferDesc, initialData.empty() ? nullptr : &data, &buffer))) {
+            return BufferHandle::Invalid;
+        }
+
+        uint32_t index;
+        if (!m_freeBuffers.empty()) {
+            index = m_freeBuffers.back();
+            m_freeBuffers.pop_back();
+            m_buffers[index] = buffer;
+        } else {
+            index = static_cast<uint32_t>(m_buffers.size());
+            m_buffers.push_back(buffer);
+        }
+        return static_cast<BufferHandle>(index + 1);
+    }
+
+    void DestroyBuffer(BufferHandle handle) override {
+        if (Get(handle)) {
+            m_buffers[static_cast<uint32_t>(handle) - 1].Reset();
+            m_freeBuffers.push_back(static_cast<uint32_t>(handle) - 1);
+        }
+    }
+
+    // An equal descriptor gets the handle it was given before
+    PipelineHandle CreatePipeline(const PipelineDesc& desc) override {
+        PipelineHandle* handle = m_pipelineCache.Acquire(desc, [&](const PipelineDesc& d, PipelineHandle& out) {
+            Pipeline pipeline;
+            pipeline.blend = AcquireBlendState(d.blend);
+            pipeline.depth = AcquireDepthState(d.depth);
+            pipeline.rasterizer = AcquireRasterizerState();
+            pipeline.topology = d.topology;
+            pipeline.shader = d.shader;
+            m_pipelines.push_back(pipeline);
+            out = static_cast<PipelineHandle>(m_pipelines.size());
+            return true;
+        });
+        return *handle;
+    }
+
+    void DestroyPipeline(PipelineHandle) override {
+        // Pipelines are shared between equal descriptors and own no device
+        // objects; the cached states outlive them
+    }
+
+    std::span<std::byte> Map(BufferHandle handle, MapMode mode) override {
+        ID3D11Buffer* buffer = Get(handle);
+        if (!buffer) return {};
+
+        D3D11_MAPPED_SUBRESOURCE mapped;
+        const D3D11_MAP type = mode == MapMode::WriteDiscard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+        if (FAILED(m_context->Map(buffer, 0, type, 0, &mapped))) return {};
+
+        D3D11_BUFFER_DESC desc;
+        buffer->GetDesc(&desc);
+        return {static_cast<std::byte*>(mapped.pData), desc.ByteWidth};
+    }
+
+    void Unmap(BufferHandle handle) override {
+        if (ID3D11Buffer* buffer = Get(handle)) m_context->Unmap(buffer, 0);
+    }
+
+    void UpdateBuffer(BufferHandle handle, std::span<const std::byte> data, uint32_t offset = 0) override {
+        ID3D11Buffer* buffer = Get(handle);
+        if (!buffer) return;
+
+        // Constant buffers can only be replaced whole
+        D3D11_BUFFER_DESC desc;
+        buffer->GetDesc(&desc);
+        if (desc.BindFlags & D3D11_BIND_CONSTANT_BUFFER) {
+            m_context->UpdateSubresource(buffer, 0, nullptr, data.data(), 0, 0);
+        } else {
+            const D3D11_BOX box = {offset, 0, 0, offset + static_cast<UINT>(data.size()), 1, 1};
+            m_context->UpdateSubresource(buffer, 0, &box, data.data(), 0, 0);
+        }
+    }
+
+    void BeginFrame(const ClearDesc& clear) override {
+        m_context->OMSetRenderTargets(1, &m_renderTarget, m_depthStencil);
+        m_context->ClearRenderTargetView(m_renderTarget, clear.color.data());
+        if (m_depthStencil) {
+            m_context->ClearDepthStencilView(m_depthStencil, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, clear.depth, 0);
+        }
+        m_pipeline = PipelineHandle::Invalid;
+    }
+
+    void EndFrame() override { m_swapChain->Present(1, 0); }
+
+    void SetPipeline(PipelineHandle handle) override {
+        const auto index = static_cast<uint32_t>(handle);
+        if (handle == m_pipeline || index == 0 || index > m_pipelines.size()) return;
+        m_pipeline = handle;
+
+        const Pipeline& pipeline = m_pipelines[index - 1];
+        static constexpr std::array<D3D11_PRIMITIVE_TOPOLOGY, 4> TOPOLOGIES = {
+            D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP,
+            D3D11_PRIMITIVE_TOPOLOGY_LINELIST, D3D11_PRIMITIVE_TOPOLOGY_POINTLIST
+        };
+        constexpr float BLEND_FACTOR[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        m_context->OMSetBlendState(pipeline.blend, BLEND_FACTOR, 0xFFFFFFFF);
+        m_context->OMSetDepthStencilState(pipeline.depth, 0);
+        m_context->RSSetState(pipeline.rasterizer);
+        m_context->IASetPrimitiveTopology(TOPOLOGIES[static_cast<size_t>(pipeline.topology)]);
+
+        const ShaderSystem::ShaderResources* program =
+            pipeline.shader < m_shaders.size() ? m_shaders[pipeline.shader] : nullptr;
+        if (!program) return;
+        m_context->IASetInputLayout(program->inputLayout.Get());
+        m_context->VSSetShader(program->vertexShader.Get(), nullptr, 0);
+        m_context->GSSetShader(program->geometryShader.Get(), nullptr, 0);
+        m_context->PSSetShader(program->pixelShader.Get(), nullptr, 0);
+    }
+
+    void SetVertexBuffer(uint32_t slot, BufferHandle handle, uint32_t stride, uint32_t offset = 0) override {
+        ID3D11Buffer* buffer = Get(handle);
+        const UINT strides[] = {stride};
+        const UINT offsets[] = {offset};
+        m_context->IASetVertexBuffers(slot, 1, &buffer, strides, offsets);
+    }
+
+    void SetIndexBuffer(BufferHandle handle, IndexFormat format) override {
+        m_context->IASetIndexBuffer(Get(handle),
+                                    format == IndexFormat::UInt16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, 0);
+    }
+
+    void SetConstantBuffer(uint32_t slot, BufferHandle handle) override {
+        ID3D11Buffer* buffer = Get(handle);
+        m_context->VSSetConstantBuffers(slot, 1, &buffer);
+        m_context->GSSetConstantBuffers(slot, 1, &buffer);
+        m_context->PSSetConstantBuffers(slot, 1, &buffer);
+    }
+
+    void Draw(uint32_t vertexCount, uint32_t firstVertex = 0) override {
+        m_context->Draw(vertexCount, firstVertex);
+    }
+
+    void DrawInstanced(uint32_t vertexCount, uint32_t instanceCount,
+                       uint32_t firstVertex = 0, uint32_t firstInstance = 0) override {
+        m_context->DrawInstanced(vertexCount, instanceCount, firstVertex, firstInstance);
+    }
+
+    void DrawIndexed(uint32_t indexCount, uint32_t firstIndex = 0, int32_t baseVertex = 0) override {
+        m_context->DrawIndexed(indexCount, firstIndex, baseVertex);
+    }
+
+    void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex = 0,
+                              int32_t baseVertex = 0, uint32_t firstInstance = 0) override {
+        m_context->DrawIndexedInstanced(indexCount, instanceCount, firstIndex, baseVertex, firstInstance);
+    }
+
+private:
+    // States resolved once at CreatePipeline; the caches own them
+    struct Pipeline {
+        ID3D11BlendState* blend = nullptr;
+        ID3D11DepthStencilState* depth = nullptr;
+        ID3D11RasterizerState* rasterizer = nullptr;
+        Topology topology = Topology::TriangleList;
+        uint32_t shader = 0;
+    };
+
+    struct DepthTarget {
+        ComPtr<ID3D11Texture2D> texture;
+        ComPtr<ID3D11DepthStencilView> view;
+    };
+
+    ID3D11Device* m_device;
+    ID3D11DeviceContext* m_context;
+    IDXGISwapChain* m_swapChain;
+    ID3D11RenderTargetView* m_renderTarget;
+    ID3D11DepthStencilView* m_depthStencil = nullptr; // owned by m_targets
+
+    std::vector<ComPtr<ID3D11Buffer>> m_buffers;
+    std::vector<uint32_t> m_freeBuffers;
+    std::vector<Pipeline> m_pipelines;
+    std::vector<const ShaderSystem::ShaderResources*> m_shaders;
+    PipelineHandle m_pipeline = PipelineHandle::Invalid;
+
+    ResourceCache<PipelineDesc, PipelineHandle, PipelineDescTraits> m_pipelineCache;
+    ResourceCache<D3D11_BLEND_DESC, ComPtr<ID3D11BlendState>> m_blendStates;
+    ResourceCache<D3D11_DEPTH_STENCIL_DESC, ComPtr<ID3D11DepthStencilState>> m_depthStates;
+    ResourceCache<D3D11_RASTERIZER_DESC, ComPtr<ID3D11RasterizerState>> m_rasterizerStates;
+    ResourceCache<TargetDesc, DepthTarget> m_targets;
+
+    ID3D11Buffer* Get(BufferHandle handle) const {
+        const auto index = static_cast<uint32_t>(handle);
+        if (index == 0 || index > m_buffers.size()) return nullptr;
+        return m_buffers[index - 1].Get();
+    }
+
+    ID3D11BlendState* AcquireBlendState(BlendMode mode) {
+        D3D11_BLEND_DESC desc;
+        ZeroMemory(&desc, sizeof(desc));
+        auto& target = desc.RenderTarget[0];
+        target.BlendEnable = mode != BlendMode::Opaque;
+        target.SrcBlend = D3D11_BLEND_SRC_ALPHA;
+        target.DestBlend = mode == BlendMode::Additive ? D3D11_BLEND_ONE : D3D11_BLEND_INV_SRC_ALPHA;
+        target.BlendOp = D3D11_BLEND_OP_ADD;
+        target.SrcBlendAlpha = D3D11_BLEND_ONE;
+        target.DestBlendAlpha = D3D11_BLEND_ZERO;
+        target.BlendOpAlpha = D3D11_BLEND_OP_ADD;
+        target.RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+        ComPtr<ID3D11BlendState>* state = m_blendStates.Acquire(desc, [&](const D3D11_BLEND_DESC& d, auto& out) {
+            return SUCCEEDED(m_device->CreateBlendState(&d, &out));
+        });
+        return state ? state->Get() : nullptr;
+    }
+
+    ID3D11DepthStencilState* AcquireDepthState(DepthMode mode) {
+        D3D11_DEPTH_STENCIL_DESC desc;
+        ZeroMemory(&desc, sizeof(desc));
+        desc.DepthEnable = mode != DepthMode::Disabled;
+        desc.DepthWriteMask = mode == DepthMode::TestWrite ? D3D11_DEPTH_WRITE_MASK_ALL : D3D11_DEPTH_WRITE_MASK_ZERO;
+        desc.DepthFunc = D3D11_COMPARISON_LESS;
+        ComPtr<ID3D11DepthStencilState>* state =
+            m_depthStates.Acquire(desc, [&](const D3D11_DEPTH_STENCIL_DESC& d, auto& out) {
+                return SUCCEEDED(m_device->CreateDepthStencilState(&d, &out));
+            });
+        return state ? state->Get() : nullptr;
+    }
+
+    ID3D11RasterizerState* AcquireRasterizerState() {
+        D3D11_RASTERIZER_DESC desc;
+        ZeroMemory(&desc, sizeof(desc));
+        desc.FillMode = D3D11_FILL_SOLID;
+        desc.CullMode = D3D11_CULL_BACK;
+        desc.DepthClipEnable = true;
+        ComPtr<ID3D11RasterizerState>* state =
+            m_rasterizerStates.Acquire(desc, [&](const D3D11_RASTERIZER_DESC& d, auto& out) {
+                return SUCCEEDED(m_device->CreateRasterizerState(&d, &out));
+            });
+        return state ? state->Get() : nullptr;
+    }
+};
@@ -3,10 +3,22 @@
 #include <vector>
 #include <memory>
 #include <array>
-#include <string>
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+#include "PoolAllocator.hpp"
+#include "RenderBackend.hpp"
 
 class DebugRenderer {
 public:
+    struct DebugConfig {
+        static constexpr size_t MAX_LINES = 10000;
+        static constexpr size_t MAX_TEXT = 1000;
+        static constexpr size_t MAX_TEXT_LENGTH = 160; // longer strings are truncated
+        static constexpr float DEFAULT_DURATION = 0.0f;  // 0 = single frame
+        static constexpr float DEFAULT_TEXT_SCALE = 1.0f;
+    };
+
     struct DebugVertex {
         XMFLOAT3 position;
         XMFLOAT4 color;
@@ -20,31 +32,42 @@ public:
         bool depthTested;
     };
 
+    // Text is stored inline so per-frame overlay text never touches the heap
     struct DebugText {
-        std::string text;
+        std::array<char, DebugConfig::MAX_TEXT_LENGTH> text;
         XMFLOAT2 position;
         XMFLOAT4 color;
         float scale;
         float duration;
     };
 
-    struct DebugConfig {
-        static constexpr size_t MAX_LINES = 10000;
-        static constexpr size_t MAX_TEXT = 1000;
-        static constexpr float DEFAULT_DURATION = 0.0f;  // 0 = single frame
-        static constexpr float DEFAULT_TEXT_SCALE = 1.0f;
+    // Screen size text is laid out in
+    struct Viewport {
+        float width;
+        float height;
     };
 
-    DebugRenderer(ID3D11Device* device) : m_device(device) {
-        CreateResources();
+    // `lineShader` is the program id the backend knows the line shaders by
+    DebugRenderer(RenderBackend& backend, uint32_t lineShader) : m_backend(backend) {
+        CreateResources(lineShader);
+    }
+
+    ~DebugRenderer() {
+        m_backend.DestroyBuffer(m_lineVB);
+        m_backend.DestroyBuffer(m_cameraCB);
+        m_backend.DestroyPipeline(m_linePipelines[0]);
+        m_backend.DestroyPipeline(m_linePipelines[1]);
     }
 
+    DebugRenderer(const DebugRenderer&) = delete;
+    DebugRenderer& operator=(const DebugRenderer&) = delete;
+
     // Line drawing functions
     void DrawLine(const XMFLOAT3& start, const XMFLOAT3& end, 
                  const XMFLOAT4& color = {1,1,1,1},
                  float duration = DebugConfig::DEFAULT_DURATION,
                  bool depthTested = true) {
-        m_lines.push_back({start, end, color, duration, depthTested});
+        m_lines.Emplace(DebugLine{start, end, color, duration, depthTested});
     }
 
     void DrawBox(const XMFLOAT3& min, const XMFLOAT3& max,
@@ -102,14 +125,18 @@ public:
     }
 
     // Text drawing functions
-    void DrawText(const std::string& text, const XMFLOAT2& position,
+    void DrawText(std::string_view text, const XMFLOAT2& position,
                  const XMFLOAT4& color = {1,1,1,1},
                  float scale = DebugConfig::DEFAULT_TEXT_SCALE,
                  float duration = DebugConfig::DEFAULT_DURATION) {
-        m_texts.push_back({text, position, color, scale, duration});
+        DebugText item{{}, position, color, scale, duration};
+        const size_t length = std::min(text.size(), item.text.size() - 1);
+        std::memcpy(item.text.data(), text.data(), length);
+        item.text[length] = '\0';
+        m_texts.Emplace(item);
     }
 
-    void DrawText3D(const std::string& text, const XMFLOAT3& position,
+    void DrawText3D(std::string_view text, const XMFLOAT3& position,
                    const XMFLOAT4& color = {1,1,1,1},
                    float scale = DebugConfig::DEFAULT_TEXT_SCALE,
                    float duration = DebugConfig::DEFAULT_DURATION) {
@@ -122,8 +149,8 @@ public:
 
         if (projected.w > 0) {
             XMFLOAT2 screenPos = {
-                (projected.x / projected.w + 1.0f) * m_viewport.Width * 0.5f,
-                (-projected.y / projected.w + 1.0f) * m_viewport.Height * 0.5f
+                (projected.x / projected.w + 1.0f) * m_viewport.width * 0.5f,
+                (-projected.y / projected.w + 1.0f) * m_viewport.height * 0.5f
             };
             DrawText(text, screenPos, color, scale, duration);
         }
@@ -131,87 +158,132 @@ public:
 
     // Update and render
     void Update(float deltaTime) {
-        // Update lifetimes and remove expired items
-        for (auto it = m_lines.begin(); it != m_lines.end();) {
-            if (it->duration > 0) {
-                it->duration -= deltaTime;
-                if (it->duration <= 0) {
-                    it = m_lines.erase(it);
-                    continue;
-                }
-            }
-            ++it;
-        }
-
-        for (auto it = m_texts.begin(); it != m_texts.end();) {
-            if (it->duration > 0) {
-                it->duration -= deltaTime;
-                if (it->duration <= 0) {
-                    it = m_texts.erase(it);
-                    continue;
-                }
-            }
-            ++it;
-        }
+        // Update lifetimes and remove expired items. Single-frame items
+        // (duration 0) were drawn by the last Render and go now.
+        RemoveExpired(m_lines, deltaTime);
+        RemoveExpired(m_texts, deltaTime);
     }
 
-    void Render(ID3D11DeviceContext* context,
-               const XMMATRIX& view,
+    void Render(const XMMATRIX& view,
                const XMMATRIX& projection,
-               const D3D11_VIEWPORT& viewport) {
+               const Viewport& viewport) {
         m_viewProjection = XMMatrixMultiply(view, projection);
         m_viewport = viewport;
 
         // Render lines
-        if (!m_lines.empty()) {
-            RenderLines(context, true);  // Depth tested lines
-            RenderLines(context, false); // Overlay lines
+        if (!m_lines.Empty()) {
+            RenderLines();
         }
 
         // Render text
-        if (!m_texts.empty()) {
-            RenderText(context);
+        if (!m_texts.Empty()) {
+            RenderText();
         }
     }
 
 private:
-    ID3D11Device* m_device;
-    ComPtr<ID3D11Buffer> m_lineVB;
-    ComPtr<ID3D11VertexShader> m_lineVS;
-    ComPtr<ID3D11PixelShader> m_linePS;
-    ComPtr<ID3D11InputLayout> m_lineLayout;
+    RenderBackend& m_backend;
+    BufferHandle m_lineVB = BufferHandle::Invalid;
+    BufferHandle m_cameraCB = BufferHandle::Invalid;
+    std::array<PipelineHandle, 2> m_linePipelines = {}; // overlay, depth tested
 
     ComPtr<ID2D1RenderTarget> m_textRT;
     ComPtr<IDWriteTextFormat> m_textFormat;
     ComPtr<ID2D1SolidColorBrush> m_textBrush;
 
-    std::vector<DebugLine> m_lines;
-    std::vector<DebugText> m_texts;
+    SlotMap<DebugLine> m_lines{"DebugLines", DebugConfig::MAX_LINES};
+    SlotMap<DebugText> m_texts{"DebugTexts", DebugConfig::MAX_TEXT};
 
     XMMATRIX m_viewProjection;
-    D3D11_VIEWPORT m_viewport;
+    Viewport m_viewport = {};
 
-    void CreateResources() {
+    template<typename Item>
+    static void RemoveExpired(SlotMap<Item>& items, float deltaTime) {
+        auto values = items.Values();
+        for (uint32_t i = 0; i < items.Size();) {
+            values[i].duration -= deltaTime;
+            if (values[i].duration <= 0) {
+                items.RemoveAt(i); // last item moves into i
+                continue;
+            }
+            ++i;
+        }
+    }
+
+    void CreateResources(uint32_t lineShader) {
         // Create line rendering resources
-        CreateLineResources();
-        
+        CreateLineResources(lineShader);
+
         // Create text rendering resources
         CreateTextResources();
     }
 
-    void CreateLineResources() {
-        // Implementation for creating line shaders and buffers
+    void CreateLineResources(uint32_t lineShader) {
+        BufferDesc vertexDesc;
+        vertexDesc.kind = BufferKind::Vertex;
+        vertexDesc.usage = BufferUsage::Dynamic;
+        vertexDesc.stride = sizeof(DebugVertex);
+        vertexDesc.byteWidth = static_cast<uint32_t>(sizeof(DebugVertex) * 2 * DebugConfig::MAX_LINES);
+        m_lineVB = m_backend.CreateBuffer(vertexDesc);
+
+        BufferDesc cameraDesc;
+        cameraDesc.kind = BufferKind::Constant;
+        cameraDesc.usage = BufferUsage::Default;
+        cameraDesc.byteWidth = sizeof(XMFLOAT4X4);
+        m_cameraCB = m_backend.CreateBuffer(cameraDesc);
+
+        PipelineDesc pipelineDesc;
+        pipelineDesc.shader = lineShader;
+        pipelineDesc.blend = BlendMode::Alpha;
+        pipelineDesc.topology = Topology::LineList;
+        pipelineDesc.depth = DepthMode::Disabled;
+        m_linePipelines[0] = m_backend.CreatePipeline(pipelineDesc);
+        pipelineDesc.depth = DepthMode::TestOnly;
+        m_linePipelines[1] = m_backend.CreatePipeline(pipelineDesc);
     }
 
     void CreateTextResources() {
         // Implementation for creating Direct2D/DirectWrite resources
     }
 
-    void RenderLines(ID3D11DeviceContext* context, bool depthTested) {
-        // Implementation for line rendering
+    void RenderLines() {
+        const std::span<DebugVertex> vertices = m_backend.MapAs<DebugVertex>(m_lineVB, MapMode::WriteDiscard);
+        if (vertices.empty()) return;
+
+        // Depth tested lines fill the buffer from the front and overlay
+        // lines from the back, so one upload serves both draws
+        const auto lines = m_lines.Values();
+        const uint32_t capacity = static_cast<uint32_t>(vertices.size());
+        uint32_t tested = 0;
+        uint32_t overlay = capacity;
+        for (uint32_t i = 0; i < m_lines.Size() && tested + 2 <= overlay; ++i) {
+            const DebugLine& line = lines[i];
+            const uint32_t first = line.depthTested ? tested : overlay - 2;
+            vertices[first] = {line.start, line.color};
+            vertices[first + 1] = {line.end, line.color};
+            if (line.depthTested) tested += 2;
+            else overlay -= 2;
+        }
+        m_backend.Unmap(m_lineVB);
+
+        XMFLOAT4X4 viewProjection;
+        XMStoreFloat4x4(&viewProjection, XMMatrixTranspose(m_viewProjection));
+        m_backend.UpdateBufferFrom(m_cameraCB, viewProjection);
+        m_backend.SetConstantBuffer(0, m_cameraCB);
+        m_backend.SetVertexBuffer(0, m_lineVB, sizeof(DebugVertex));
+
+        if (tested > 0) {
+            m_backend.SetPipeline(m_linePipelines[1]);
+            m_backend.Draw(tested);
+        }
+        if (overlay < capacity) {
+            m_backend.SetPipeline(m_linePipelines[0]);
+            m_backend.Draw(capacity - overlay, overlay);
+        }
     }
 
-    void RenderText(ID3D11DeviceContext* context) {
-        // Implementation for text rendering
+    void RenderText() {
+        // Text goes through Direct2D/DirectWrite on the same back buffer
+        // after the backend's draws
     }
-};
\ No newline at end of file
+};
@@ -0,0 +1,163 @@
+#pragma once
+#include "MathTypes.hpp"
+#include "ParticleLanes.hpp"
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <span>
+
+using namespace DirectX;
+
+// The six planes of a camera's view volume and visibility tests for
+// bounding spheres and boxes, eight per ParticleLanes::F8. Inputs are
+// separate x, y, z (and radius) arrays laid out like ParticleStorage
+// columns: 32-byte aligned and readable up to `count` rounded up to eight.
+// Results are one bit per object, eight objects per byte, set when the
+// object may be visible.
+class FrustumCuller {
+public:
+    static constexpr size_t PLANE_COUNT = 6;
+
+    struct CullStats {
+        uint32_t tested;
+        uint32_t visible;
+    };
+
+    // `viewProjection` maps row vectors to D3D clip space (0 <= z <= w), as
+    // XMMatrixMultiply(view, projection) does
+    void SetViewProjection(const XMFLOAT4X4& m) {
+        // Columns of m, i.e. the rows of its transpose
+        const std::array<XMFLOAT4, 4> columns = {
+            XMFLOAT4(m._11, m._21, m._31, m._41), XMFLOAT4(m._12, m._22, m._32, m._42),
+            XMFLOAT4(m._13, m._23, m._33, m._43), XMFLOAT4(m._14, m._24, m._34, m._44)
+        };
+        SetPlanes(columns);
+    }
+
+    // Same from the transposed view and projection the shaders take, as
+    // in BoardRenderer::Camera
+    void SetTransposedViewProjection(const XMFLOAT4X4& view, const XMFLOAT4X4& projection) {
+        // (view * projection)^T = projection^T * view^T, whose rows are the
+        // columns SetViewProjection reads
+        const float (&p)[16] = reinterpret_cast<const float(&)[16]>(projection);
+        const float (&v)[16] = reinterpret_cast<const float(&)[16]>(view);
+        std::array<XMFLOAT4, 4> rows;
+        for (int r = 0; r < 4; ++r) {
+            float out[4];
+            for (int c = 0; c < 4; ++c) {
+                out[c] = p[r * 4 + 0] * v[0 * 4 + c] + p[r * 4 + 1] * v[1 * 4 + c] +
+                         p[r * 4 + 2] * v[2 * 4 + c] + p[r * 4 + 3] * v[3 * 4 + c];
+            }
+            rows[r] = XMFLOAT4(out[0], out[1], out[2], out[3]);
+        }
+        SetPlanes(rows);
+    }
+
+    // Inside or on the plane: a * x + b * y + c * z + d >= 0, (a, b, c)
+    // unit length; left, right, bottom, top, near, far
+    const std::array<XMFLOAT4, PLANE_COUNT>& GetPlanes() const { return m_planes; }
+
+    // Spheres at (x, y, z) with the given radii; returns how many are visible
+    uint32_t CullSpheres(const float* x, const float* y, const float* z, const float* radius,
+                         uint32_t count, uint8_t* visible) const {
+        using namespace ParticleLanes;
+        const LanePlanes planes = SplatPlanes();
+        uint32_t total = 0;
+        for (uint32_t i = 0; i < count; i += 8) {
+            const F8 px = Load(x + i), py = Load(y + i), pz = Load(z + i);
+            const F8 negRadius = Splat(0.0f) - Load(radius + i);
+            F8 outside = Less(planes.Distance(0, px, py, pz), negRadius);
+            for (size_t p = 1; p < PLANE_COUNT; ++p) {
+                outside = outside | Less(planes.Distance(p, px, py, pz), negRadius);
+            }
+            total += StoreVisible(MoveMask(outside), i, count, visible);
+        }
+        return total;
+    }
+
+    // Axis-aligned boxes centred on (x, y, z), all with `halfExtents`
+    uint32_t CullBoxes(const float* x, const float* y, const float* z, const XMFLOAT3& halfExtents,
+                       uint32_t count, uint8_t* visible) const {
+        using namespace ParticleLanes;
+
+        // How far the box reaches towards each plane's outside
+        const LanePlanes planes = SplatPlanes();
+        std::array<F8, PLANE_COUNT> negReach;
+        for (size_t p = 0; p < PLANE_COUNT; ++p) {
+            const XMFLOAT4& plane = m_planes[p];
+            negReach[p] = Splat(-(std::abs(plane.x) * halfExtents.x + std::abs(plane.y) * halfExtents.y +
+                                  std::abs(plane.z) * halfExtents.z));
+        }
+
+        uint32_t total = 0;
+        for (uint32_t i = 0; i < count; i += 8) {
+            const F8 px = Load(x + i), py = Load(y + i), pz = Load(z + i);
+            F8 outside = Less(planes.Distance(0, px, py, pz), negReach[0]);
+            for (size_t p = 1; p < PLANE_COUNT; ++p) {
+                outside = outside | Less(planes.Distance(p, px, py, pz), negReach[p]);
+            }
+            total += StoreVisible(MoveMask(outside), i, count, visible);
+        }
+        return total;
+    }
+
+    static bool IsVisible(const uint8_t* visible, uint32_t index) {
+        return (visible[index / 8] >> (index % 8)) & 1;
+    }
+
+private:
+    // The planes' coefficients splatted across the lanes. Kept in locals so
+    // the stores through `visible` cannot force them to be reloaded.
+    struct LanePlanes {
+        std::array<ParticleLanes::F8, PLANE_COUNT> a, b, c, d;
+
+        ParticleLanes::F8 Distance(size_t p, ParticleLanes::F8 x, ParticleLanes::F8 y, ParticleLanes::F8 z) const {
+            return x * a[p] + y * b[p] + z * c[p] + d[p];
+        }
+    };
+
+    // Everything is visible until a camera is set
+    std::array<XMFLOAT4, PLANE_COUNT> m_planes = {
+        XMFLOAT4(0, 0, 0, 1), XMFLOAT4(0, 0, 0, 1), XMFLOAT4(0, 0, 0, 1),
+        XMFLOAT4(0, 0, 0, 1), XMFLOAT4(0, 0, 0, 1), XMFLOAT4(0, 0, 0, 1)
+    };
+
+    // From the columns c0..c3 of a row-vector view-projection matrix
+    void SetPlanes(const std::array<XMFLOAT4, 4>& c) {
+        auto combine = [](const XMFLOAT4& a, const XMFLOAT4& b, float sign) {
+            return XMFLOAT4(a.x + sign * b.x, a.y + sign * b.y, a.z + sign * b.z, a.w + sign * b.w);
+        };
+        m_planes = {
+            combine(c[3], c[0], 1.0f), combine(c[3], c[0], -1.0f),
+            combine(c[3], c[1], 1.0f), combine(c[3], c[1], -1.0f),
+            c[2], combine(c[3], c[2], -1.0f)
+        };
+        for (XMFLOAT4& plane : m_planes) {
+            const float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+            const float scale = length > 0.0f ? 1.0f / length : 0.0f;
+            plane = XMFLOAT4(plane.x * scale, plane.y * scale, plane.z * scale, plane.w * scale);
+        }
+    }
+
+    LanePlanes SplatPlanes() const {
+        using namespace ParticleLanes;
+        LanePlanes planes;
+        for (size_t p = 0; p < PLANE_COUNT; ++p) {
+            planes.a[p] = Splat(m_planes[p].x);
+            planes.b[p] = Splat(m_planes[p].y);
+            planes.c[p] = Splat(m_planes[p].z);
+            planes.d[p] = Splat(m_planes[p].w);
+        }
+        return planes;
+    }
+
+    // Writes the visibility byte of the group starting at `first`, with
+    // lanes past `count` cleared; returns its visible count
+    static uint32_t StoreVisible(uint32_t outside, uint32_t first, uint32_t count, uint8_t* visible) {
+        uint32_t bits = ~outside & 0xffu;
+        if (count - first < 8) bits &= (1u << (count - first)) - 1;
+        visible[first / 8] = static_cast<uint8_t>(bits);
+        return static_cast<uint32_t>(std::popcount(bits));
+    }
+};
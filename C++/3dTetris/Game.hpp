@@ -3,9 +3,13 @@
 #include "AudioSystem.h"
 #include "InputSystem.h"
 #include "VisualEffects.h"
+#include "ParticleEngine.h"
+#include "JobSystem.h"
 #include "CameraSystem.h"
 #include "HoldPieceSystem.h"
 #include "PieceMechanics.h"
+#include "ProfilerSystem.h"
+#include <cstdlib>
 #include <memory>
 
 #pragma once
@@ -13,6 +17,8 @@
 #include "Audio.h"
 #include "UI.h"
 #include "ParticleSystem.h"
+#include "D3D11RenderBackend.hpp"
+#include "BoardRenderer.hpp"
 #include <memory>
 
 // class Game {
@@ -44,7 +50,12 @@
 class Game {
 public:
     Game() : m_isPaused(false) {}
-    ~Game() = default;
+
+    ~Game() {
+        if (AllocationTracker::GetSteadyStatePolicy() != AllocationTracker::SteadyStatePolicy::Off) {
+            AllocationTracker::WriteSteadyStateReport(stderr);
+        }
+    }
 
     bool Initialize(HINSTANCE hInstance, int nCmdShow) {
         // Create window
@@ -55,13 +66,26 @@ public:
         m_timer = std::make_unique<GameTimer>();
         m_audio = std::make_unique<AudioSystem>();
         m_input = std::make_unique<InputSystem>();
-        m_visualEffects = std::make_unique<VisualEffects>();
+        m_jobs = std::make_unique<JobSystem>();
+        m_particles = std::make_unique<ParticleEngine>(m_jobs.get(), std::random_device{}());
+        m_particles->SetCollision(true);
+        m_visualEffects = std::make_unique<VisualEffects>(*m_particles);
         m_camera = std::make_unique<CameraSystem>();
         m_holdPiece = std::make_unique<HoldPieceSystem>();
 
         // Initialize graphics
         if (!InitializeDirectX())
             return false;
+        RECT clientRect;
+        GetClientRect(m_hwnd, &clientRect);
+        m_backend = std::make_unique<D3D11RenderBackend>(m_device.Get(), m_context.Get(), m_swapChain.Get(),
+                                                         m_renderTargetView.Get(),
+                                                         clientRect.right - clientRect.left,
+                                                         clientRect.bottom - clientRect.top);
+        m_boardRenderer = std::make_unique<BoardRenderer>(*m_backend, BLOCK_SHADER);
+        m_particleRenderer = std::make_unique<ParticleSystem>();
+        if (!m_particleRenderer->Initialize(*m_backend, *m_particles, PARTICLE_SHADER))
+            return false;
 
         // Initialize audio
         if (!m_audio->Initialize())
@@ -73,10 +97,17 @@ public:
         // Initialize game state
         ResetGame();
 
+        // TETRIS_ZERO_ALLOC=report|trace|abort verifies that Update and Render
+        // stop touching the heap once the warm-up frames have passed
+        AllocationTracker::EnableSteadyStateCheck(
+            AllocationTracker::ParsePolicy(std::getenv("TETRIS_ZERO_ALLOC")));
+
         return true;
     }
 
     void Update() {
+        PROFILE_SCOPE("Game.Update");
+        AllocationTracker::SteadyStateScope steadyState;
         m_timer->Tick();
         float deltaTime = m_timer->DeltaTime();
 
@@ -87,8 +118,17 @@ public:
             // Update game state
             UpdateGame(deltaTime);
 
-            // Update visual effects
+            // Update visual effects; every effect's particles share one
+            // budget that follows the measured frame time
             m_visualEffects->Update(deltaTime);
+            m_particles->SetViewPosition(m_camera->GetState().position);
+            if (m_gameState.gridGeneration != m_collisionGeneration) {
+                // The collider keeps its own occupancy masks; rebuild them
+                // only after blocks locked or layers cleared
+                m_particles->SetCollisionGrid(m_gameState.grid);
+                m_collisionGeneration = m_gameState.gridGeneration;
+            }
+            m_particles->Update(deltaTime);
 
             // Update camera with screen shake
             m_camera->ApplyScreenShake(m_visualEffects->GetShakeOffset());
@@ -96,38 +136,57 @@ public:
     }
 
     void Render() {
+        PROFILE_SCOPE("Game.Render");
+        AllocationTracker::SteadyStateScope steadyState;
+
         // Clear back buffer
-        float clearColor[4] = { 0.0f, 0.2f, 0.4f, 1.0f };
-        m_context->ClearRenderTargetView(m_renderTargetView.Get(), clearColor);
-        m_context->ClearDepthStencilView(m_depthStencilView.Get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+        m_backend->BeginFrame(ClearDesc{});
 
         // Get view and projection matrices
         XMMATRIX view = m_camera->GetViewMatrix();
         XMMATRIX projection = m_camera->GetProjectionMatrix(GetAspectRatio());
 
-        // Render game grid
-        RenderGrid(view, projection);
-
-        // Render current piece and ghost piece
-        RenderPiece(m_gameState.currentPiece, view, projection);
-        RenderGhostPiece(view, projection);
+        // Render game grid, current piece, ghost piece and held piece as
+        // cube instances: a few instanced draws and one instance upload
+        BoardRenderer::Camera camera;
+        XMStoreFloat4x4(&camera.view, XMMatrixTranspose(view));
+        XMStoreFloat4x4(&camera.projection, XMMatrixTranspose(projection));
+        m_boardRenderer->SetCamera(camera);
+        m_boardRenderer->BeginFrame();
+        m_boardRenderer->SubmitGrid(m_gameState);
+
+        const auto& piece = m_gameState.currentPiece;
+        m_boardRenderer->SubmitBlocks(piece.blocks, piece.position, piece.color, BoardRenderer::Style::Solid);
+        const GameState::PieceTemplate shape{piece.blocks, 1};
+        if (const auto ghost = PieceMechanics::GetGhostPosition(shape, m_gameState.grid, piece.position)) {
+            m_boardRenderer->SubmitBlocks(piece.blocks, *ghost, piece.color, BoardRenderer::Style::Ghost);
+        }
 
-        // Render held piece if exists
-        if (auto heldPiece = m_holdPiece->GetHeldPiece()) {
-            RenderPiece(*heldPiece, view, projection);
+        if (const auto& heldPiece = m_holdPiece->GetHeldPiece()) {
+            m_boardRenderer->SubmitBlocks(heldPiece->blocks, heldPiece->position, heldPiece->color,
+                                          BoardRenderer::Style::Solid);
         }
+        m_boardRenderer->EndFrame(m_jobs.get());
+        const auto cubes = m_boardRenderer->GetCullStats();
+        PROFILE_COUNT("Cull.Cubes.Visible", cubes.visible);
+        PROFILE_COUNT("Cull.Cubes.Culled", cubes.tested - cubes.visible);
 
-        // Render particles
-        RenderParticles(view, projection);
+        // Render particles, culled against the same frustum as the board
+        m_particleRenderer->Render(view, projection, m_boardRenderer->GetFrustum());
+        const auto particles = m_particles->GetCullStats();
+        PROFILE_COUNT("Cull.Particles.Visible", particles.visible);
+        PROFILE_COUNT("Cull.Particles.Culled", particles.tested - particles.visible);
 
         // Render UI
         RenderUI();
 
         // Present
-        m_swapChain->Present(1, 0);
+        m_backend->EndFrame();
+        AllocationTracker::AdvanceSteadyStateFrame();
     }
 
     void ProcessInput() {
+        PROFILE_SCOPE("Game.ProcessInput");
         m_input->Update(m_timer->DeltaTime());
 
         while (auto action = m_input->GetNextAction()) {
@@ -171,20 +230,27 @@ private:
     std::unique_ptr<GameTimer> m_timer;
     std::unique_ptr<AudioSystem> m_audio;
     std::unique_ptr<InputSystem> m_input;
-    std::unique_ptr<VisualEffects> m_visualEffects;
+    std::unique_ptr<JobSystem> m_jobs;
+    std::unique_ptr<ParticleEngine> m_particles;
+    std::unique_ptr<VisualEffects> m_visualEffects; // emits into m_particles
     std::unique_ptr<CameraSystem> m_camera;
     std::unique_ptr<HoldPieceSystem> m_holdPiece;
 
     // Game state
     GameState m_gameState;
     bool m_isPaused;
+    uint64_t m_collisionGeneration = ~uint64_t{0}; // GameState::gridGeneration the particle collider matches
 
     // DirectX resources
     ComPtr<ID3D11Device> m_device;
     ComPtr<ID3D11DeviceContext> m_context;
     ComPtr<IDXGISwapChain> m_swapChain;
     ComPtr<ID3D11RenderTargetView> m_renderTargetView;
-    ComPtr<ID3D11DepthStencilView> m_depthStencilView;
+    std::unique_ptr<D3D11RenderBackend> m_backend; // renderers draw through this
+    std::unique_ptr<BoardRenderer> m_boardRenderer; // every cube in the well
+    std::unique_ptr<ParticleSystem> m_particleRenderer; // uploads and draws m_particles
+    static constexpr uint32_t BLOCK_SHADER = 1;     // VS_Instanced and PS_Block as registered with m_backend
+    static constexpr uint32_t PARTICLE_SHADER = 2;  // the particle VS/GS/PS as registered with m_backend
 
     void UpdateGame(float deltaTime) {
         if (m_gameState.isGameOver)
@@ -215,7 +281,7 @@ private:
             int x = m_gameState.currentPiece.position.x + block.x;
             int y = m_gameState.currentPiece.position.y + block.y;
             int z = m_gameState.currentPiece.position.z + block.z;
-            m_gameState.grid[x][y][z] = true;
+            m_gameState.SetCell(x, y, z, static_cast<uint8_t>(m_gameState.currentPiece.type + 1));
         }
 
         // Visual and audio feedback
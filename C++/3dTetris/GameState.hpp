@@ -1,61 +1,11 @@
 #pragma once
-#include <DirectXMath.h>
+#include "MathTypes.hpp"
+#include <algorithm>
 #include <array>
-#include <vector>
+#include <cstdint>
 
 using namespace DirectX;
 
-
-struct GameState {
-    // Game stats
-    int score;
-    int level;
-    int linesCleared;
-    bool isGameOver;
-    
-    // Camera
-    float cameraPitch;
-    float cameraYaw;
-    float cameraDistance;
-    
-    // Current piece
-    struct {
-        std::vector<XMFLOAT3> blocks;
-        XMFLOAT3 position;
-        XMFLOAT4 color;
-    } currentPiece;
-    
-    // Next piece preview
-    struct {
-        std::vector<XMFLOAT3> blocks;
-        XMFLOAT4 color;
-    } nextPiece;
-    
-    // Grid state
-    static const int GRID_WIDTH = 6;
-    static const int GRID_HEIGHT = 12;
-    static const int GRID_DEPTH = 6;
-    bool grid[GRID_WIDTH][GRID_HEIGHT][GRID_DEPTH];
-    
-    // Game timing
-    float dropTimer;
-    float dropInterval;
-    
-    GameState() :
-        score(0),
-        level(0),
-        linesCleared(0),
-        isGameOver(false),
-        cameraPitch(0.0f),
-        cameraYaw(0.0f),
-        cameraDistance(15.0f),
-        dropTimer(0.0f),
-        dropInterval(1.0f)
-    {
-        memset(grid, 0, sizeof(grid));
-    }
-};
-
 class GameState {
 public:
     // Game constants
@@ -89,19 +39,19 @@ public:
 
     static constexpr std::array<PieceTemplate, 7> PIECE_TEMPLATES = {{
         // I Piece
-        {{{0,0,0}, {1,0,0}, {2,0,0}, {3,0,0}}, 2},
+        {{{{0,0,0}, {1,0,0}, {2,0,0}, {3,0,0}}}, 2},
         // L Piece
-        {{{0,0,0}, {1,0,0}, {2,0,0}, {2,1,0}}, 4},
+        {{{{0,0,0}, {1,0,0}, {2,0,0}, {2,1,0}}}, 4},
         // J Piece
-        {{{0,0,0}, {1,0,0}, {2,0,0}, {0,1,0}}, 4},
+        {{{{0,0,0}, {1,0,0}, {2,0,0}, {0,1,0}}}, 4},
         // O Piece
-        {{{0,0,0}, {1,0,0}, {0,1,0}, {1,1,0}}, 1},
+        {{{{0,0,0}, {1,0,0}, {0,1,0}, {1,1,0}}}, 1},
         // S Piece
-        {{{1,0,0}, {2,0,0}, {0,1,0}, {1,1,0}}, 2},
+        {{{{1,0,0}, {2,0,0}, {0,1,0}, {1,1,0}}}, 2},
         // T Piece
-        {{{1,0,0}, {0,1,0}, {1,1,0}, {2,1,0}}, 4},
+        {{{{1,0,0}, {0,1,0}, {1,1,0}, {2,1,0}}}, 4},
         // Z Piece
-        {{{0,0,0}, {1,0,0}, {1,1,0}, {2,1,0}}, 2}
+        {{{{0,0,0}, {1,0,0}, {1,1,0}, {2,1,0}}}, 2}
     }};
 
     // Game grid using 3D std::array
@@ -115,6 +65,26 @@ public:
     
     GridType grid{};
 
+    // Colour of each locked cell: 0 when empty, else the piece type + 1
+    using ColorGridType = std::array<
+        std::array<
+            std::array<uint8_t, GRID_DEPTH>,
+            GRID_HEIGHT
+        >,
+        GRID_WIDTH
+    >;
+
+    ColorGridType colors{};
+
+    // Bumped by every change to grid and colors made through SetCell,
+    // ClearFullLayers, Reset or MarkLayersDirty. Caches of the board (the
+    // renderer's instance data) remember the generation they were built
+    // from and ask DirtyLayersSince what to rebuild.
+    uint64_t gridGeneration{0};
+    std::array<uint64_t, GRID_HEIGHT> layerGenerations{}; // generation of each layer's last change
+    static_assert(GRID_HEIGHT <= 32, "dirty layers are reported as 32-bit masks");
+    static constexpr uint32_t ALL_LAYERS = (1ull << GRID_HEIGHT) - 1;
+
     struct {
         std::array<XMFLOAT3, 4> blocks;
         XMFLOAT3 position;
@@ -131,7 +101,7 @@ public:
     float dropInterval{INITIAL_DROP_INTERVAL};
 
     // Helper functions
-    constexpr bool IsValidPosition(int x, int y, int z) const {
+    static constexpr bool IsValidPosition(int x, int y, int z) {
         return x >= 0 && x < GRID_WIDTH &&
                y >= 0 && y < GRID_HEIGHT &&
                z >= 0 && z < GRID_DEPTH;
@@ -146,8 +116,69 @@ public:
         return LINE_CLEAR_SCORES[lines - 1] * (level + 1);
     }
 
+    // Fills or empties (color 0) a cell
+    void SetCell(int x, int y, int z, uint8_t color) {
+        grid[x][y][z] = color != 0;
+        colors[x][y][z] = color;
+        MarkLayersDirty(1u << y);
+    }
+
+    // For code that writes grid or colors directly
+    void MarkLayersDirty(uint32_t layers) {
+        ++gridGeneration;
+        for (int y = 0; y < GRID_HEIGHT; y++) {
+            if (layers & (1u << y)) layerGenerations[y] = gridGeneration;
+        }
+    }
+
+    // Bit y is set when layer y changed after gridGeneration was `generation`
+    uint32_t DirtyLayersSince(uint64_t generation) const {
+        uint32_t layers = 0;
+        for (int y = 0; y < GRID_HEIGHT; y++) {
+            if (layerGenerations[y] > generation) layers |= 1u << y;
+        }
+        return layers;
+    }
+
+    // Removes every full layer, shifting the layers above down.
+    // Returns the number of layers cleared.
+    int ClearFullLayers() {
+        int cleared = 0;
+
+        for (int y = 0; y < GRID_HEIGHT; y++) {
+            if (!IsLayerFull(y)) continue;
+
+            cleared++;
+            for (int x = 0; x < GRID_WIDTH; x++) {
+                for (int z = 0; z < GRID_DEPTH; z++) {
+                    for (int y2 = y; y2 < GRID_HEIGHT - 1; y2++) {
+                        grid[x][y2][z] = grid[x][y2 + 1][z];
+                        colors[x][y2][z] = colors[x][y2 + 1][z];
+                    }
+                    grid[x][GRID_HEIGHT - 1][z] = false;
+                    colors[x][GRID_HEIGHT - 1][z] = 0;
+                }
+            }
+            MarkLayersDirty(ALL_LAYERS & ~((1u << y) - 1)); // this layer and every one above moved
+            y--; // re-test the layer that moved down
+        }
+
+        return cleared;
+    }
+
+    bool IsLayerFull(int y) const {
+        for (int x = 0; x < GRID_WIDTH; x++) {
+            for (int z = 0; z < GRID_DEPTH; z++) {
+                if (!grid[x][y][z]) return false;
+            }
+        }
+        return true;
+    }
+
     void Reset() {
         grid = GridType{};
+        colors = ColorGridType{};
+        MarkLayersDirty(ALL_LAYERS);
         score = 0;
         level = 0;
         linesCleared = 0;
@@ -0,0 +1,240 @@
+#pragma once
+#include "GameState.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+
+// Turns the locked blocks into a few large quads instead of a cube per
+// cell: faces hidden by a neighbour are dropped, and exposed faces of the
+// same colour that share a plane are merged greedily.
+//
+// The mesh is kept per layer, in layer-local coordinates. A layer's quads
+// depend only on its own colours and on which cells above and below it are
+// occupied, so Update rebuilds just the layers whose inputs changed; after
+// a clear, the layers that slid down keep the quads they already had.
+// Side faces are merged within a layer only, which keeps layers independent.
+class GridMesher {
+public:
+    static constexpr int W = GameState::GRID_WIDTH;
+    static constexpr int H = GameState::GRID_HEIGHT;
+    static constexpr int D = GameState::GRID_DEPTH;
+
+    struct MesherConfig {
+        static constexpr uint32_t MAX_LAYER_QUADS = 6 * W * D;          // every face of every cell
+        static constexpr uint32_t MAX_QUADS = MAX_LAYER_QUADS * H;
+        static constexpr int MAX_LAYER_SHIFT = 4;                       // layers one lock can clear
+    };
+    static_assert(MesherConfig::MAX_QUADS * 4 <= 65536, "quad vertices must fit 16-bit indices");
+
+    enum Face : uint8_t { NegX, PosX, NegY, PosY, NegZ, PosZ };
+
+    // One face of the box [x, x + sizeX) x [0, 1) x [z, z + sizeZ) of cells
+    // within a layer
+    struct Quad {
+        uint8_t face;
+        uint8_t color; // GameState::colors value, 1-based
+        uint8_t x, z;
+        uint8_t sizeX, sizeZ;
+    };
+
+    // Same layout as the cube vertices in main.cpp
+    struct Vertex {
+        XMFLOAT3 position;
+        XMFLOAT4 color;
+    };
+
+    // Rebuilds the layers whose inputs changed since the last call; returns
+    // how many were rebuilt rather than reused
+    uint32_t Update(const GameState::ColorGridType& colors) {
+        uint32_t rebuilt = 0;
+        uint32_t total = 0;
+
+        // Layers only ever move down, so the source layer j >= y has not
+        // been overwritten yet when layer y takes its quads
+        for (int y = 0; y < H; ++y) {
+            int source = -1;
+            const int last = std::min(H - 1, y + MesherConfig::MAX_LAYER_SHIFT);
+            for (int j = y; j <= last && m_built; ++j) {
+                if (SameInputs(m_colors, j, colors, y)) {
+                    source = j;
+                    break;
+                }
+            }
+
+            if (source < 0) {
+                BuildLayer(colors, y);
+                ++rebuilt;
+            } else if (source != y) {
+                m_layers[y] = m_layers[source];
+            }
+            total += m_layers[y].count;
+        }
+
+        m_colors = colors;
+        m_quadCount = total;
+        m_built = true;
+        return rebuilt;
+    }
+
+    uint32_t GetQuadCount() const { return m_quadCount; }
+
+    std::span<const Quad> GetLayerQuads(int y) const {
+        return {m_layers[y].quads.data(), m_layers[y].count};
+    }
+
+    // Four vertices per quad, clockwise seen from outside, layer by layer;
+    // returns the number of quads written
+    uint32_t WriteVertices(std::span<Vertex> out) const {
+        // Corners of a unit box, indexed (x | y << 1 | z << 2), for each Face
+        static constexpr uint8_t CORNERS[6][4] = {
+            {4, 6, 2, 0}, {1, 3, 7, 5}, {4, 0, 1, 5}, {2, 6, 7, 3}, {0, 2, 3, 1}, {4, 5, 7, 6}
+        };
+
+        uint32_t written = 0;
+        for (int y = 0; y < H; ++y) {
+            for (const Quad& quad : GetLayerQuads(y)) {
+                if (size_t(written + 1) * 4 > out.size()) return written;
+
+                const float minX = quad.x - W / 2.0f - 0.5f;
+                const float minY = y - 0.5f;
+                const float minZ = quad.z - D / 2.0f - 0.5f;
+                const XMFLOAT4& color = GameState::PIECE_COLORS[(quad.color - 1) % GameState::PIECE_COLORS.size()];
+                for (int k = 0; k < 4; ++k) {
+                    const uint8_t corner = CORNERS[quad.face][k];
+                    out[written * 4 + k] = {
+                        XMFLOAT3(minX + (corner & 1) * quad.sizeX, minY + ((corner >> 1) & 1),
+                                 minZ + ((corner >> 2) & 1) * quad.sizeZ),
+                        color};
+                }
+                ++written;
+            }
+        }
+        return written;
+    }
+
+    // Index pattern for WriteVertices output, two triangles per quad
+    static void WriteQuadIndices(std::span<uint16_t> out) {
+        for (size_t quad = 0; quad < out.size() / 6; ++quad) {
+            const auto base = static_cast<uint16_t>(quad * 4);
+            const uint16_t indices[6] = {base, uint16_t(base + 1), uint16_t(base + 2),
+                                         base, uint16_t(base + 2), uint16_t(base + 3)};
+            std::copy(indices, indices + 6, out.begin() + quad * 6);
+        }
+    }
+
+private:
+    struct LayerMesh {
+        std::array<Quad, MesherConfig::MAX_LAYER_QUADS> quads;
+        uint32_t count = 0;
+    };
+
+    GameState::ColorGridType m_colors{};
+    std::array<LayerMesh, H> m_layers{};
+    uint32_t m_quadCount = 0;
+    bool m_built = false;
+
+    // Below the floor is solid, so bottom faces of the first layer are hidden
+    static bool Occupied(const GameState::ColorGridType& colors, int x, int y, int z) {
+        if (y < 0) return true;
+        if (x < 0 || x >= W || y >= H || z < 0 || z >= D) return false;
+        return colors[x][y][z] != 0;
+    }
+
+    // Whether layer `ya` of `a` would mesh exactly like layer `yb` of `b`
+    static bool SameInputs(const GameState::ColorGridType& a, int ya, const GameState::ColorGridType& b, int yb) {
+        for (int x = 0; x < W; ++x) {
+            for (int z = 0; z < D; ++z) {
+                if (a[x][ya][z] != b[x][yb][z] ||
+                    Occupied(a, x, ya - 1, z) != Occupied(b, x, yb - 1, z) ||
+                    Occupied(a, x, ya + 1, z) != Occupied(b, x, yb + 1, z)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    void BuildLayer(const GameState::ColorGridType& colors, int y) {
+        LayerMesh& layer = m_layers[y];
+        layer.count = 0;
+
+        // Top and bottom faces: rectangles over x and z
+        for (const Face face : {NegY, PosY}) {
+            const int neighbour = face == NegY ? y - 1 : y + 1;
+            std::array<std::array<uint8_t, D>, W> mask{};
+            for (int x = 0; x < W; ++x) {
+                for (int z = 0; z < D; ++z) {
+                    if (!Occupied(colors, x, neighbour, z)) mask[x][z] = colors[x][y][z];
+                }
+            }
+
+            for (int z = 0; z < D; ++z) {
+                for (int x = 0; x < W;) {
+                    const uint8_t color = mask[x][z];
+                    if (color == 0) {
+                        ++x;
+                        continue;
+                    }
+
+                    int sizeX = 1;
+                    while (x + sizeX < W && mask[x + sizeX][z] == color) ++sizeX;
+                    int sizeZ = 1;
+                    for (; z + sizeZ < D; ++sizeZ) {
+                        bool rowMatches = true;
+                        for (int i = 0; i < sizeX && rowMatches; ++i) rowMatches = mask[x + i][z + sizeZ] == color;
+                        if (!rowMatches) break;
+                    }
+
+                    for (int j = 0; j < sizeZ; ++j) {
+                        for (int i = 0; i < sizeX; ++i) mask[x + i][z + j] = 0;
+                    }
+                    Emit(layer, face, color, x, z, sizeX, sizeZ);
+                    x += sizeX;
+                }
+            }
+        }
+
+        // Side faces: runs along the face's plane, one cell high
+        for (int x = 0; x < W; ++x) {
+            for (const Face face : {NegX, PosX}) {
+                const int neighbour = face == NegX ? x - 1 : x + 1;
+                for (int z = 0; z < D;) {
+                    const uint8_t color = colors[x][y][z];
+                    if (color == 0 || Occupied(colors, neighbour, y, z)) {
+                        ++z;
+                        continue;
+                    }
+                    int size = 1;
+                    while (z + size < D && colors[x][y][z + size] == color &&
+                           !Occupied(colors, neighbour, y, z + size)) ++size;
+                    Emit(layer, face, color, x, z, 1, size);
+                    z += size;
+                }
+            }
+        }
+
+        for (int z = 0; z < D; ++z) {
+            for (const Face face : {NegZ, PosZ}) {
+                const int neighbour = face == NegZ ? z - 1 : z + 1;
+                for (int x = 0; x < W;) {
+                    const uint8_t color = colors[x][y][z];
+                    if (color == 0 || Occupied(colors, x, y, neighbour)) {
+                        ++x;
+                        continue;
+                    }
+                    int size = 1;
+                    while (x + size < W && colors[x + size][y][z] == color &&
+                           !Occupied(colors, x + size, y, neighbour)) ++size;
+                    Emit(layer, face, color, x, z, size, 1);
+                    x += size;
+                }
+            }
+        }
+    }
+
+    static void Emit(LayerMesh& layer, Face face, uint8_t color, int x, int z, int sizeX, int sizeZ) {
+        layer.quads[layer.count++] = {face, color, static_cast<uint8_t>(x), static_cast<uint8_t>(z),
+                                      static_cast<uint8_t>(sizeX), static_cast<uint8_t>(sizeZ)};
+    }
+};
@@ -1,10 +1,12 @@
 #pragma once
 #include "GameState.h"
 #include "AudioSystem.h"
+#include <optional>
+#include <random>
 
 class HoldPieceSystem {
 public:
-    HoldPieceSystem() : m_canHold(true) {}
+    HoldPieceSystem() : m_canHold(true), m_rng(std::random_device{}()) {}
 
     void Reset() {
         m_heldPiece = std::nullopt;
@@ -50,42 +52,15 @@ public:
 private:
     std::optional<TetrisPiece> m_heldPiece;
     bool m_canHold;
+    std::mt19937 m_rng;
 
     void SpawnNewPiece(GameState& gameState) {
-        static const std::vector<std::vector<XMFLOAT3>> PIECES = {
-            // I Piece
-            {{0,0,0}, {1,0,0}, {2,0,0}, {3,0,0}},
-            // L Piece
-            {{0,0,0}, {1,0,0}, {2,0,0}, {2,1,0}},
-            // J Piece
-            {{0,0,0}, {1,0,0}, {2,0,0}, {0,1,0}},
-            // O Piece
-            {{0,0,0}, {1,0,0}, {0,1,0}, {1,1,0}},
-            // S Piece
-            {{1,0,0}, {2,0,0}, {0,1,0}, {1,1,0}},
-            // T Piece
-            {{1,0,0}, {0,1,0}, {1,1,0}, {2,1,0}},
-            // Z Piece
-            {{0,0,0}, {1,0,0}, {1,1,0}, {2,1,0}}
-        };
+        std::uniform_int_distribution<int> dis(
+            0, static_cast<int>(GameState::PIECE_TEMPLATES.size()) - 1);
 
-        static const std::vector<XMFLOAT4> COLORS = {
-            {1.0f, 0.0f, 0.0f, 1.0f}, // Red
-            {0.0f, 1.0f, 0.0f, 1.0f}, // Green
-            {0.0f, 0.0f, 1.0f, 1.0f}, // Blue
-            {1.0f, 1.0f, 0.0f, 1.0f}, // Yellow
-            {1.0f, 0.0f, 1.0f, 1.0f}, // Magenta
-            {0.0f, 1.0f, 1.0f, 1.0f}, // Cyan
-            {1.0f, 0.5f, 0.0f, 1.0f}  // Orange
-        };
-
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<> dis(0, PIECES.size() - 1);
-
-        int pieceIndex = dis(gen);
-        gameState.currentPiece.blocks = PIECES[pieceIndex];
-        gameState.currentPiece.color = COLORS[pieceIndex];
+        int pieceIndex = dis(m_rng);
+        gameState.currentPiece.blocks = GameState::PIECE_TEMPLATES[pieceIndex].blocks;
+        gameState.currentPiece.color = GameState::PIECE_COLORS[pieceIndex];
         gameState.currentPiece.position = XMFLOAT3(
             GameState::GRID_WIDTH/2 - 1,
             GameState::GRID_HEIGHT - 1,
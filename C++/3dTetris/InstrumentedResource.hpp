@@ -0,0 +1,152 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+// What an allocation is for. Set for a block of code with ScopedMemoryTag,
+// or passed explicitly to MemoryManager's typed allocators.
+enum class MemoryTag : uint8_t {
+    Untagged,
+    Gameplay,
+    Particles,
+    Rendering,
+    Audio,
+    Debug,
+    Profiler,
+    COUNT
+};
+
+inline constexpr std::array<const char*, static_cast<size_t>(MemoryTag::COUNT)> MEMORY_TAG_NAMES = {
+    "Untagged", "Gameplay", "Particles", "Rendering", "Audio", "Debug", "Profiler"
+};
+
+class ScopedMemoryTag {
+public:
+    explicit ScopedMemoryTag(MemoryTag tag) : m_previous(Current()) { Current() = tag; }
+    ~ScopedMemoryTag() { Current() = m_previous; }
+
+    ScopedMemoryTag(const ScopedMemoryTag&) = delete;
+    ScopedMemoryTag& operator=(const ScopedMemoryTag&) = delete;
+
+    static MemoryTag& Current() {
+        static constinit thread_local MemoryTag tag = MemoryTag::Untagged;
+        return tag;
+    }
+
+private:
+    MemoryTag m_previous;
+};
+
+// Wraps a pool's memory_resource and counts what goes through it, per pool
+// and per tag. Counters are relaxed atomics on cache lines owned by the
+// pool, so it stays on in release builds.
+//
+// The pools are bump arenas that free nothing until they are reset, so a
+// free changes no counter: liveBytes reads as "requested since the last
+// Reset()", which is also what the arena holds.
+//
+// If the primary resource throws (an arena ran out of reservation) the
+// bad_alloc propagates; the arena has already counted the overflow.
+class InstrumentedResource : public std::pmr::memory_resource {
+public:
+    static constexpr size_t TAG_COUNT = static_cast<size_t>(MemoryTag::COUNT);
+
+    struct ResourceStats {
+        uint64_t liveBytes;      // requested bytes since the last Reset()
+        uint64_t peakBytes;      // highest liveBytes seen
+        uint64_t allocCount;     // allocations since the last Reset()
+        uint64_t alignmentWaste; // arena bytes used beyond liveBytes; filled in by MemoryManager
+
+        // Peaks of different resources need not coincide, so a sum of them
+        // overstates; the largest is kept and totals track their own peak
+        ResourceStats& operator+=(const ResourceStats& other) {
+            liveBytes += other.liveBytes;
+            peakBytes = std::max(peakBytes, other.peakBytes);
+            allocCount += other.allocCount;
+            alignmentWaste += other.alignmentWaste;
+            return *this;
+        }
+    };
+
+    InstrumentedResource(const char* name, std::pmr::memory_resource* primary)
+        : m_name(name), m_primary(primary) {}
+
+    InstrumentedResource(const InstrumentedResource&) = delete;
+    InstrumentedResource& operator=(const InstrumentedResource&) = delete;
+
+    void* Allocate(size_t bytes, size_t alignment, MemoryTag tag) {
+        void* p = m_primary->allocate(bytes, alignment);
+        Count(m_pool, bytes);
+        Count(m_tags[static_cast<size_t>(tag)], bytes);
+        return p;
+    }
+
+    void Deallocate(void* p, size_t bytes, size_t alignment) {
+        m_primary->deallocate(p, bytes, alignment);
+    }
+
+    // Call after the wrapped arena was reset: live counts restart from zero
+    void Reset() {
+        ResetCounters(m_pool);
+        for (auto& tag : m_tags) ResetCounters(tag);
+    }
+
+    const char* GetName() const { return m_name; }
+    ResourceStats GetStats() const { return Snapshot(m_pool); }
+    ResourceStats GetTagStats(MemoryTag tag) const {
+        return Snapshot(m_tags[static_cast<size_t>(tag)]);
+    }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        return Allocate(bytes, alignment, ScopedMemoryTag::Current());
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        Deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+private:
+    struct alignas(64) Counters {
+        std::atomic<uint64_t> liveBytes{0};
+        std::atomic<uint64_t> peakBytes{0};
+        std::atomic<uint64_t> allocCount{0};
+    };
+
+    const char* m_name;
+    std::pmr::memory_resource* m_primary;
+
+    Counters m_pool;
+    std::array<Counters, TAG_COUNT> m_tags;
+
+    static void Count(Counters& counters, size_t bytes) {
+        const uint64_t live = counters.liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        uint64_t peak = counters.peakBytes.load(std::memory_order_relaxed);
+        while (peak < live &&
+               !counters.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+        }
+        counters.allocCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Peak survives resets; everything else is per period
+    static void ResetCounters(Counters& counters) {
+        counters.liveBytes.store(0, std::memory_order_relaxed);
+        counters.allocCount.store(0, std::memory_order_relaxed);
+    }
+
+    static ResourceStats Snapshot(const Counters& counters) {
+        return {
+            counters.liveBytes.load(std::memory_order_relaxed),
+            counters.peakBytes.load(std::memory_order_relaxed),
+            counters.allocCount.load(std::memory_order_relaxed),
+            0
+        };
+    }
+};
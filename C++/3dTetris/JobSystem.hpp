@@ -0,0 +1,160 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed pool of worker threads for data-parallel loops. ParallelFor splits
+// a range into chunks that the workers and the calling thread claim with an
+// atomic counter; it returns once every chunk has run. One loop runs at a
+// time and issuing one never allocates, so it is safe in the frame loop.
+class JobSystem {
+public:
+    struct JobConfig {
+        static constexpr uint32_t MAX_WORKERS = 31; // plus the caller fits MemoryManager::MAX_FRAME_THREADS
+    };
+
+    // Leaves one hardware thread for the caller
+    static uint32_t DefaultWorkerCount() {
+        const uint32_t hardware = std::max(std::thread::hardware_concurrency(), 1u);
+        return std::min(hardware - 1, JobConfig::MAX_WORKERS);
+    }
+
+    explicit JobSystem(uint32_t workerCount = DefaultWorkerCount()) {
+        workerCount = std::min(workerCount, JobConfig::MAX_WORKERS);
+        m_workers.reserve(workerCount);
+        for (uint32_t i = 0; i < workerCount; ++i) {
+            m_workers.emplace_back([this, i] { WorkerLoop(i + 1); });
+        }
+    }
+
+    ~JobSystem() {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (auto& worker : m_workers) worker.join();
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    uint32_t WorkerCount() const { return static_cast<uint32_t>(m_workers.size()); }
+
+    // Threads that may run chunks of one loop, i.e. workers plus the caller
+    uint32_t ThreadCount() const { return WorkerCount() + 1; }
+
+    // 0 outside the workers (the thread issuing a loop), 1..WorkerCount()
+    // on them; a ParallelFor body can index per-thread state with it since
+    // chunk indices grow with the loop's count
+    static uint32_t ThreadIndex() { return CurrentThreadIndex(); }
+
+    // Calls fn(chunkIndex, begin, end) for consecutive chunks of [0, count).
+    // Chunks run concurrently and in no particular order.
+    template<typename Fn>
+    void ParallelFor(uint32_t count, uint32_t chunkSize, Fn&& fn) {
+        if (count == 0) return;
+        chunkSize = std::max(chunkSize, 1u);
+        const uint32_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+        using Body = std::remove_reference_t<Fn>;
+        struct Context {
+            Body* fn;
+            uint32_t count;
+            uint32_t chunkSize;
+        } context{&fn, count, chunkSize};
+
+        auto run = [](void* data, uint32_t chunk) {
+            const auto& ctx = *static_cast<Context*>(data);
+            const uint32_t begin = chunk * ctx.chunkSize;
+            (*ctx.fn)(chunk, begin, std::min(begin + ctx.chunkSize, ctx.count));
+        };
+
+        if (chunkCount == 1 || m_workers.empty()) {
+            for (uint32_t chunk = 0; chunk < chunkCount; ++chunk) run(&context, chunk);
+            return;
+        }
+
+        Batch batch;
+        {
+            std::lock_guard lock(m_mutex);
+            batch = {run, &context, chunkCount, ++m_generation};
+            m_batch = batch;
+            m_pending.store(chunkCount, std::memory_order_relaxed);
+            m_claim.store(uint64_t(uint32_t(batch.generation)) << 32, std::memory_order_release);
+        }
+        m_wake.notify_all();
+
+        RunChunks(batch);
+
+        // Wait for the chunks other threads claimed
+        for (uint32_t pending; (pending = m_pending.load(std::memory_order_acquire)) != 0;) {
+            m_pending.wait(pending, std::memory_order_acquire);
+        }
+    }
+
+private:
+    using RunFn = void (*)(void* context, uint32_t chunk);
+
+    struct Batch {
+        RunFn run;
+        void* context;
+        uint32_t chunkCount;
+        uint64_t generation;
+    };
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    uint64_t m_generation = 0;
+    bool m_stop = false;
+    Batch m_batch = {}; // copied by workers under m_mutex
+
+    // Generation in the high half, next chunk index in the low half, so a
+    // worker that wakes late can never claim a chunk of a newer loop
+    std::atomic<uint64_t> m_claim{0};
+    std::atomic<uint32_t> m_pending{0};
+
+    void RunChunks(const Batch& batch) {
+        const uint32_t generation = uint32_t(batch.generation);
+        uint64_t claim = m_claim.load(std::memory_order_acquire);
+        for (;;) {
+            if (uint32_t(claim >> 32) != generation) return;
+            const uint32_t chunk = uint32_t(claim);
+            if (chunk >= batch.chunkCount) return;
+            if (!m_claim.compare_exchange_weak(claim, claim + 1, std::memory_order_acq_rel)) continue;
+
+            batch.run(batch.context, chunk);
+            if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                m_pending.notify_all();
+            }
+            claim = m_claim.load(std::memory_order_acquire);
+        }
+    }
+
+    static uint32_t& CurrentThreadIndex() {
+        static thread_local uint32_t index = 0;
+        return index;
+    }
+
+    void WorkerLoop(uint32_t threadIndex) {
+        CurrentThreadIndex() = threadIndex;
+        uint64_t seen = 0;
+        for (;;) {
+            Batch batch;
+            {
+                std::unique_lock lock(m_mutex);
+                m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+                if (m_stop) return;
+                seen = m_generation;
+                batch = m_batch;
+            }
+            RunChunks(batch);
+        }
+    }
+};
@@ -0,0 +1,160 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+#if defined(_WIN32)
+    #include <Windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+// File mapped into memory that can grow while being written. Growing remaps
+// the view, so pointers into Data() are only valid until the next Reserve().
+class MappedFile {
+public:
+    struct MappingConfig {
+        static constexpr size_t MIN_GROWTH = 4 * 1024 * 1024;    // 4MB
+        static constexpr size_t MAX_GROWTH = 256 * 1024 * 1024;  // 256MB
+    };
+
+    MappedFile() = default;
+    ~MappedFile() { Close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool OpenForWrite(const std::filesystem::path& path, size_t initialSize) {
+        Close();
+        m_writable = true;
+
+#if defined(_WIN32)
+        m_file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+                             nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE) return false;
+#else
+        m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (m_fd < 0) return false;
+#endif
+        return Remap(initialSize);
+    }
+
+    bool OpenForRead(const std::filesystem::path& path) {
+        Close();
+        m_writable = false;
+
+#if defined(_WIN32)
+        m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                             nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE) return false;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(m_file, &size)) return false;
+        return Remap(static_cast<size_t>(size.QuadPart));
+#else
+        m_fd = ::open(path.c_str(), O_RDONLY);
+        if (m_fd < 0) return false;
+
+        struct stat info;
+        if (fstat(m_fd, &info) != 0) return false;
+        return Remap(static_cast<size_t>(info.st_size));
+#endif
+    }
+
+    // Makes sure at least `size` bytes are mapped, growing geometrically
+    bool Reserve(size_t size) {
+        if (size <= m_size) return true;
+        if (!m_writable) return false;
+
+        size_t growth = std::clamp(m_size, MappingConfig::MIN_GROWTH, MappingConfig::MAX_GROWTH);
+        return Remap(std::max(size, m_size + growth));
+    }
+
+    // Unmaps and, for written files, trims the file to the bytes actually used
+    void Close(size_t finalSize = SIZE_MAX) {
+        Unmap();
+
+#if defined(_WIN32)
+        if (m_file != INVALID_HANDLE_VALUE) {
+            if (m_writable && finalSize != SIZE_MAX) {
+                LARGE_INTEGER end;
+                end.QuadPart = static_cast<LONGLONG>(finalSize);
+                SetFilePointerEx(m_file, end, nullptr, FILE_BEGIN);
+                SetEndOfFile(m_file);
+            }
+            CloseHandle(m_file);
+            m_file = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (m_fd >= 0) {
+            if (m_writable && finalSize != SIZE_MAX) {
+                (void)ftruncate(m_fd, static_cast<off_t>(finalSize));
+            }
+            ::close(m_fd);
+            m_fd = -1;
+        }
+#endif
+        m_size = 0;
+    }
+
+    bool IsOpen() const { return m_data != nullptr; }
+    std::byte* Data() { return m_data; }
+    const std::byte* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+private:
+    std::byte* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_writable = false;
+
+#if defined(_WIN32)
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#else
+    int m_fd = -1;
+#endif
+
+    bool Remap(size_t size) {
+        Unmap();
+        if (size == 0) return false;
+
+#if defined(_WIN32)
+        const DWORD protect = m_writable ? PAGE_READWRITE : PAGE_READONLY;
+        const DWORD access = m_writable ? FILE_MAP_WRITE : FILE_MAP_READ;
+        const uint64_t size64 = size;
+
+        // Creating a writable mapping larger than the file extends the file
+        m_mapping = CreateFileMappingW(m_file, nullptr, protect,
+                                       static_cast<DWORD>(size64 >> 32),
+                                       static_cast<DWORD>(size64), nullptr);
+        if (!m_mapping) return false;
+
+        m_data = static_cast<std::byte*>(MapViewOfFile(m_mapping, access, 0, 0, size));
+#else
+        if (m_writable && ftruncate(m_fd, static_cast<off_t>(size)) != 0) return false;
+
+        const int protect = m_writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+        void* view = mmap(nullptr, size, protect, MAP_SHARED, m_fd, 0);
+        m_data = view == MAP_FAILED ? nullptr : static_cast<std::byte*>(view);
+#endif
+        if (!m_data) return false;
+
+        m_size = size;
+        return true;
+    }
+
+    void Unmap() {
+#if defined(_WIN32)
+        if (m_data) UnmapViewOfFile(m_data);
+        if (m_mapping) CloseHandle(m_mapping);
+        m_mapping = nullptr;
+#else
+        if (m_data) munmap(m_data, m_size);
+#endif
+        m_data = nullptr;
+    }
+};
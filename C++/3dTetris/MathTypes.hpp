@@ -0,0 +1,54 @@
+#pragma once
+
+// Simulation and frame-building code only needs DirectXMath's storage types.
+// Headless builds (benchmarks, Linux CI) without DirectXMath get a
+// layout-compatible subset; anything that needs XMVECTOR/XMMATRIX must still
+// include <DirectXMath.h> directly.
+#if defined(_WIN32) || __has_include(<DirectXMath.h>)
+    #include <DirectXMath.h>
+#else
+namespace DirectX {
+    constexpr float XM_PI = 3.141592654f;
+    constexpr float XM_2PI = 6.283185307f;
+    constexpr float XM_PIDIV2 = 1.570796327f;
+    constexpr float XM_PIDIV4 = 0.785398163f;
+
+    struct XMFLOAT2 {
+        float x, y;
+
+        XMFLOAT2() = default;
+        constexpr XMFLOAT2(float _x, float _y) : x(_x), y(_y) {}
+    };
+
+    struct XMFLOAT3 {
+        float x, y, z;
+
+        XMFLOAT3() = default;
+        constexpr XMFLOAT3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+    };
+
+    struct XMFLOAT4 {
+        float x, y, z, w;
+
+        XMFLOAT4() = default;
+        constexpr XMFLOAT4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+    };
+
+    struct XMFLOAT4X4 {
+        float _11, _12, _13, _14;
+        float _21, _22, _23, _24;
+        float _31, _32, _33, _34;
+        float _41, _42, _43, _44;
+
+        XMFLOAT4X4() = default;
+        constexpr XMFLOAT4X4(float m00, float m01, float m02, float m03,
+                             float m10, float m11, float m12, float m13,
+                             float m20, float m21, float m22, float m23,
+                             float m30, float m31, float m32, float m33)
+            : _11(m00), _12(m01), _13(m02), _14(m03)
+            , _21(m10), _22(m11), _23(m12), _24(m13)
+            , _31(m20), _32(m21), _33(m22), _34(m23)
+            , _41(m30), _42(m31), _43(m32), _44(m33) {}
+    };
+}
+#endif
@@ -1,8 +1,17 @@
 #pragma once
 #include <memory>
 #include <memory_resource>
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <thread>
 #include <vector>
+#include "AllocationTracker.hpp"
+#include "ConcurrentArena.hpp"
+#include "InstrumentedResource.hpp"
+#include "VirtualArena.hpp"
 
 class MemoryManager {
 public:
@@ -11,6 +20,34 @@ public:
     static constexpr size_t PERSISTENT_MEMORY = 16 * 1024 * 1024; // 16MB
     static constexpr size_t UPLOAD_MEMORY = 8 * 1024 * 1024; // 8MB
 
+    // Address space reserved per arena; only touched pages are committed
+    static constexpr size_t FRAME_RESERVE = 64 * 1024 * 1024; // 64MB per frame
+    static constexpr size_t PERSISTENT_RESERVE = 512 * 1024 * 1024; // 512MB
+    static constexpr size_t UPLOAD_RESERVE = 128 * 1024 * 1024; // 128MB
+
+    // Frame memory is per thread; the thread that creates the manager gets
+    // the full frame budget, worker threads a smaller one
+    static constexpr size_t MAX_FRAME_THREADS = 32;
+    static constexpr size_t WORKER_FRAME_MEMORY = 256 * 1024; // 256KB
+    static constexpr size_t WORKER_FRAME_RESERVE = 16 * 1024 * 1024; // 16MB
+    static constexpr size_t SCRATCH_MEMORY = 256 * 1024; // 256KB per frame
+    static constexpr size_t SCRATCH_RESERVE = 32 * 1024 * 1024; // 32MB per frame
+
+    enum class Pool : uint8_t {
+        Frame,
+        Scratch,
+        Persistent,
+        Upload,
+        COUNT
+    };
+
+    static constexpr size_t POOL_COUNT = static_cast<size_t>(Pool::COUNT);
+    static constexpr std::array<const char*, POOL_COUNT> POOL_NAMES = {
+        "Frame", "Scratch", "Persistent", "Upload"
+    };
+
+    using ResourceStats = InstrumentedResource::ResourceStats;
+
     struct MemoryStats {
         size_t frameMemoryUsed;
         size_t persistentMemoryUsed;
@@ -18,70 +55,121 @@ public:
         size_t peakFrameMemory;
         size_t peakPersistentMemory;
         size_t peakUploadMemory;
-    };
+        size_t frameMemoryCommitted;
+        size_t persistentMemoryCommitted;
+        size_t uploadMemoryCommitted;
+        size_t scratchMemoryUsed;      // included in frameMemoryUsed
+        uint32_t frameThreadCount;
+        uint32_t overflowCount;
 
-    MemoryManager() {
-        // Initialize memory pools
-        m_persistentMemory = std::make_unique<std::byte[]>(PERSISTENT_MEMORY);
-        m_persistentPool = std::pmr::monotonic_buffer_resource(
-            m_persistentMemory.get(),
-            PERSISTENT_MEMORY
-        );
+        // Frame and Scratch cover the frame that just finished, summed over
+        // threads; Persistent and Upload are running totals
+        std::array<ResourceStats, POOL_COUNT> pools;
+        std::array<ResourceStats, InstrumentedResource::TAG_COUNT> tags;
 
-        m_uploadMemory = std::make_unique<std::byte[]>(UPLOAD_MEMORY);
-        m_uploadPool = std::pmr::monotonic_buffer_resource(
-            m_uploadMemory.get(),
-            UPLOAD_MEMORY
-        );
+        const ResourceStats& Get(Pool pool) const { return pools[static_cast<size_t>(pool)]; }
+        const ResourceStats& Get(MemoryTag tag) const { return tags[static_cast<size_t>(tag)]; }
+    };
 
-        for (auto& frameMemory : m_frameMemory) {
-            frameMemory = std::make_unique<std::byte[]>(FRAME_MEMORY);
-        }
+    MemoryManager()
+        : m_persistentPool({"Persistent", PERSISTENT_RESERVE, PERSISTENT_MEMORY, true})
+        , m_uploadPool({"Upload", UPLOAD_RESERVE, UPLOAD_MEMORY})
+        , m_scratchPools{{
+              ConcurrentArena({"Scratch0", SCRATCH_RESERVE, SCRATCH_MEMORY}),
+              ConcurrentArena({"Scratch1", SCRATCH_RESERVE, SCRATCH_MEMORY}),
+              ConcurrentArena({"Scratch2", SCRATCH_RESERVE, SCRATCH_MEMORY})
+          }}
+        , m_persistentResource("Persistent", &m_persistentPool)
+        , m_uploadResource("Upload", &m_uploadPool)
+        , m_scratchResources{{
+              InstrumentedResource("Scratch", &m_scratchPools[0]),
+              InstrumentedResource("Scratch", &m_scratchPools[1]),
+              InstrumentedResource("Scratch", &m_scratchPools[2])
+          }} {
+        static_assert(FRAME_COUNT == 3, "m_scratchPools initializer lists one arena per frame");
+        RegisterFrameThread();
+    }
 
-        for (auto& framePool : m_framePools) {
-            framePool = std::pmr::monotonic_buffer_resource(
-                m_frameMemory[&framePool - &m_framePools[0]].get(),
-                FRAME_MEMORY
-            );
+    ~MemoryManager() {
+        for (auto& arenas : m_threadArenas) {
+            delete arenas.load(std::memory_order_relaxed);
         }
     }
 
-    // Frame-based allocator for temporary data
+    MemoryManager(const MemoryManager&) = delete;
+    MemoryManager& operator=(const MemoryManager&) = delete;
+
+    // Frame-based allocator for temporary data. Each thread bumps its own
+    // arena, so this needs no locks; the memory lives until the same frame
+    // index comes around again.
     template<typename T>
-    T* FrameAlloc(size_t count = 1) {
+    T* FrameAlloc(size_t count = 1, MemoryTag tag = ScopedMemoryTag::Current()) {
         size_t size = sizeof(T) * count;
+        AllocationTracker::Record(AllocationTracker::Source::FramePool, size);
         return static_cast<T*>(
-            m_framePools[m_currentFrame].allocate(
+            GetThreadFrameResource().Allocate(
                 size,
-                std::alignment_of<T>::value
+                std::alignment_of<T>::value,
+                tag
             )
         );
     }
 
+    // Frame scratch that several threads fill together (e.g. one output
+    // array written by parallel jobs). Lock-free, but every call is an
+    // atomic on a shared cache line, so prefer FrameAlloc for private data.
+    template<typename T>
+    T* ScratchAlloc(size_t count = 1, MemoryTag tag = ScopedMemoryTag::Current()) {
+        size_t size = sizeof(T) * count;
+        AllocationTracker::Record(AllocationTracker::Source::FramePool, size);
+        return static_cast<T*>(
+            m_scratchResources[m_currentFrame].Allocate(
+                size,
+                std::alignment_of<T>::value,
+                tag
+            )
+        );
+    }
+
+    // Creates the calling thread's frame arenas up front. Optional: the
+    // first FrameAlloc on a thread does the same. Slots are never recycled,
+    // so frame memory is meant for long-lived worker threads.
+    void RegisterFrameThread() {
+        (void)GetThreadFrameResource();
+    }
+
     // Persistent allocator for long-lived data
     template<typename T>
-    T* PersistentAlloc(size_t count = 1) {
+    T* PersistentAlloc(size_t count = 1, MemoryTag tag = ScopedMemoryTag::Current()) {
         size_t size = sizeof(T) * count;
+        AllocationTracker::Record(AllocationTracker::Source::PersistentPool, size);
         return static_cast<T*>(
-            m_persistentPool.allocate(
+            m_persistentResource.Allocate(
                 size,
-                std::alignment_of<T>::value
+                std::alignment_of<T>::value,
+                tag
             )
         );
     }
 
     // Upload allocator for staging buffers
     template<typename T>
-    T* UploadAlloc(size_t count = 1) {
+    T* UploadAlloc(size_t count = 1, MemoryTag tag = ScopedMemoryTag::Current()) {
         size_t size = sizeof(T) * count;
+        AllocationTracker::Record(AllocationTracker::Source::UploadPool, size);
         return static_cast<T*>(
-            m_uploadPool.allocate(
+            m_uploadResource.Allocate(
                 size,
-                std::alignment_of<T>::value
+                std::alignment_of<T>::value,
+                tag
             )
         );
     }
 
+    // Resources for pmr containers; tagged through ScopedMemoryTag
+    std::pmr::memory_resource* GetFrameResource() { return &GetThreadFrameResource(); }
+    std::pmr::memory_resource* GetPersistentResource() { return &m_persistentResource; }
+
     // STL-compatible allocators
     template<typename T>
     class FrameAllocator {
@@ -106,13 +194,20 @@ public:
         MemoryManager& m_manager;
     };
 
+    // Must be called while no other thread is allocating frame memory
     void BeginFrame() {
         m_currentFrame = (m_currentFrame + 1) % FRAME_COUNT;
-        m_framePools[m_currentFrame].release();
+        ForEachThreadArenas([&](ThreadFrameArenas& arenas) {
+            arenas.pools[m_currentFrame].Reset();
+            arenas.resources[m_currentFrame].Reset();
+        });
+        m_scratchPools[m_currentFrame].Reset();
+        m_scratchResources[m_currentFrame].Reset();
         
         // Reset upload buffer if needed
-        if (m_uploadPool.buffer_size() > UPLOAD_MEMORY / 2) {
-            m_uploadPool.release();
+        if (m_uploadPool.Used() > UPLOAD_MEMORY / 2) {
+            m_uploadPool.Reset();
+            m_uploadResource.Reset();
         }
 
         UpdateStats();
@@ -122,35 +217,198 @@ public:
         return m_stats;
     }
 
+    // Appends one CSV row per call (header first) for offline analysis
+    void ExportStats(FILE* out) {
+        if (!m_exportHeaderWritten) {
+            std::fprintf(out, "frame");
+            for (const char* pool : POOL_NAMES) {
+                std::fprintf(out, ",%s.live,%s.peak,%s.count,%s.waste",
+                             pool, pool, pool, pool);
+            }
+            for (const char* tag : MEMORY_TAG_NAMES) {
+                std::fprintf(out, ",%s.live,%s.count", tag, tag);
+            }
+            std::fprintf(out, ",overflows\n");
+            m_exportHeaderWritten = true;
+        }
+
+        std::fprintf(out, "%llu", static_cast<unsigned long long>(m_frameNumber));
+        for (const auto& pool : m_stats.pools) {
+            std::fprintf(out, ",%llu,%llu,%llu,%llu",
+                         static_cast<unsigned long long>(pool.liveBytes),
+                         static_cast<unsigned long long>(pool.peakBytes),
+                         static_cast<unsigned long long>(pool.allocCount),
+                         static_cast<unsigned long long>(pool.alignmentWaste));
+        }
+        for (const auto& tag : m_stats.tags) {
+            std::fprintf(out, ",%llu,%llu",
+                         static_cast<unsigned long long>(tag.liveBytes),
+                         static_cast<unsigned long long>(tag.allocCount));
+        }
+        std::fprintf(out, ",%u\n", m_stats.overflowCount);
+    }
+
 private:
-    std::unique_ptr<std::byte[]> m_persistentMemory;
-    std::pmr::monotonic_buffer_resource m_persistentPool;
+    struct ThreadFrameArenas {
+        std::array<VirtualArena, FRAME_COUNT> pools;
+        std::array<InstrumentedResource, FRAME_COUNT> resources;
+        std::thread::id owner;
+
+        ThreadFrameArenas(std::thread::id thread, size_t reserve, size_t commit)
+            : pools{{
+                  VirtualArena({"Frame", reserve, commit}),
+                  VirtualArena({"Frame", reserve, commit}),
+                  VirtualArena({"Frame", reserve, commit})
+              }}
+            , resources{{
+                  InstrumentedResource("Frame", &pools[0]),
+                  InstrumentedResource("Frame", &pools[1]),
+                  InstrumentedResource("Frame", &pools[2])
+              }}
+            , owner(thread) {}
+    };
 
-    std::unique_ptr<std::byte[]> m_uploadMemory;
-    std::pmr::monotonic_buffer_resource m_uploadPool;
+    VirtualArena m_persistentPool;
+    VirtualArena m_uploadPool;
+    std::array<ConcurrentArena, FRAME_COUNT> m_scratchPools;
 
-    std::array<std::unique_ptr<std::byte[]>, FRAME_COUNT> m_frameMemory;
-    std::array<std::pmr::monotonic_buffer_resource, FRAME_COUNT> m_framePools;
+    InstrumentedResource m_persistentResource;
+    InstrumentedResource m_uploadResource;
+    std::array<InstrumentedResource, FRAME_COUNT> m_scratchResources;
+
+    // Slots are claimed once per thread and published with release so
+    // BeginFrame can walk them without a lock
+    std::array<std::atomic<ThreadFrameArenas*>, MAX_FRAME_THREADS> m_threadArenas{};
+    std::atomic<uint32_t> m_threadCount{0};
+
+    // Never reused, unlike `this`, so a thread's cached slot cannot outlive
+    // its manager and match a new one built at the same address
+    const uint64_t m_instanceId = NextInstanceId();
 
     uint32_t m_currentFrame = 0;
+    uint64_t m_frameNumber = 0;
     MemoryStats m_stats = {};
+    std::array<uint64_t, POOL_COUNT> m_poolPeaks{}; // of liveBytes summed over a pool's resources
+    bool m_exportHeaderWritten = false;
+
+    InstrumentedResource& GetThreadFrameResource() {
+        struct ThreadSlot {
+            uint64_t owner;
+            ThreadFrameArenas* arenas;
+        };
+        static thread_local ThreadSlot slot = {0, nullptr};
+
+        if (slot.owner != m_instanceId) {
+            slot = {m_instanceId, FindThreadArenas()};
+        }
+        if (!slot.arenas) {
+            // Out of slots: stay correct by sharing the lock-free scratch arena
+            return m_scratchResources[m_currentFrame];
+        }
+        return slot.arenas->resources[m_currentFrame];
+    }
+
+    static uint64_t NextInstanceId() {
+        static std::atomic<uint64_t> next{1};
+        return next.fetch_add(1, std::memory_order_relaxed);
+    }
 
+    // A thread switching between managers only caches one of them, so look
+    // for the slot it already owns here before claiming another
+    ThreadFrameArenas* FindThreadArenas() {
+        const std::thread::id self = std::this_thread::get_id();
+        const uint32_t count = std::min<uint32_t>(
+            m_threadCount.load(std::memory_order_acquire), MAX_FRAME_THREADS);
+        for (uint32_t i = 0; i < count; ++i) {
+            auto* arenas = m_threadArenas[i].load(std::memory_order_acquire);
+            if (arenas && arenas->owner == self) return arenas;
+        }
+        return ClaimThreadArenas();
+    }
+
+    ThreadFrameArenas* ClaimThreadArenas() {
+        const uint32_t index = m_threadCount.fetch_add(1, std::memory_order_relaxed);
+        assert(index < MAX_FRAME_THREADS && "raise MemoryManager::MAX_FRAME_THREADS");
+        if (index >= MAX_FRAME_THREADS) return nullptr;
+
+        auto* arenas = index == 0
+            ? new ThreadFrameArenas(std::this_thread::get_id(), FRAME_RESERVE, FRAME_MEMORY)
+            : new ThreadFrameArenas(std::this_thread::get_id(), WORKER_FRAME_RESERVE, WORKER_FRAME_MEMORY);
+        m_threadArenas[index].store(arenas, std::memory_order_release);
+        return arenas;
+    }
+
+    template<typename Fn>
+    void ForEachThreadArenas(Fn&& fn) {
+        for (auto& slot : m_threadArenas) {
+            if (auto* arenas = slot.load(std::memory_order_acquire)) fn(*arenas);
+        }
+    }
+
+    void AddResourceStats(Pool pool, const InstrumentedResource& resource) {
+        m_stats.pools[static_cast<size_t>(pool)] += resource.GetStats();
+        for (size_t tag = 0; tag < InstrumentedResource::TAG_COUNT; ++tag) {
+            m_stats.tags[tag] += resource.GetTagStats(static_cast<MemoryTag>(tag));
+        }
+    }
+
+    // Reports the frame that just finished, before its pools are reused
     void UpdateStats() {
-        m_stats.frameMemoryUsed = m_framePools[m_currentFrame].buffer_size();
-        m_stats.persistentMemoryUsed = m_persistentPool.buffer_size();
-        m_stats.uploadMemoryUsed = m_uploadPool.buffer_size();
+        const uint32_t lastFrame = (m_currentFrame + FRAME_COUNT - 1) % FRAME_COUNT;
+        const auto scratch = m_scratchPools[lastFrame].GetStats();
+        const auto persistent = m_persistentPool.GetStats();
+        const auto upload = m_uploadPool.GetStats();
 
-        m_stats.peakFrameMemory = std::max(
-            m_stats.peakFrameMemory,
-            m_stats.frameMemoryUsed
-        );
-        m_stats.peakPersistentMemory = std::max(
-            m_stats.peakPersistentMemory,
-            m_stats.persistentMemoryUsed
-        );
-        m_stats.peakUploadMemory = std::max(
-            m_stats.peakUploadMemory,
-            m_stats.uploadMemoryUsed
-        );
+        m_frameNumber++;
+        m_stats.pools = {};
+        m_stats.tags = {};
+        AddResourceStats(Pool::Scratch, m_scratchResources[lastFrame]);
+        AddResourceStats(Pool::Persistent, m_persistentResource);
+        AddResourceStats(Pool::Upload, m_uploadResource);
+
+        m_stats.scratchMemoryUsed = scratch.used;
+        m_stats.frameMemoryUsed = scratch.used;
+        m_stats.frameMemoryCommitted = 0;
+        m_stats.frameThreadCount = 0;
+        m_stats.overflowCount = persistent.overflowCount + upload.overflowCount;
+
+        for (const auto& pool : m_scratchPools) {
+            const auto stats = pool.GetStats();
+            m_stats.frameMemoryCommitted += stats.committed;
+            m_stats.overflowCount += stats.overflowCount;
+        }
+
+        ForEachThreadArenas([&](ThreadFrameArenas& arenas) {
+            AddResourceStats(Pool::Frame, arenas.resources[lastFrame]);
+            m_stats.frameMemoryUsed += arenas.pools[lastFrame].Used();
+            m_stats.frameThreadCount++;
+            for (const auto& pool : arenas.pools) {
+                const auto stats = pool.GetStats();
+                m_stats.frameMemoryCommitted += stats.committed;
+                m_stats.overflowCount += stats.overflowCount;
+            }
+        });
+
+        m_stats.persistentMemoryUsed = persistent.used;
+        m_stats.uploadMemoryUsed = upload.used;
+
+        // Each arena holds exactly its resource's blocks, so whatever it used
+        // beyond the requested bytes went to alignment
+        const std::array<size_t, POOL_COUNT> arenaUsed = {
+            m_stats.frameMemoryUsed - scratch.used, scratch.used, persistent.used, upload.used
+        };
+        for (size_t pool = 0; pool < POOL_COUNT; ++pool) {
+            auto& stats = m_stats.pools[pool];
+            stats.alignmentWaste = arenaUsed[pool] - std::min<uint64_t>(arenaUsed[pool], stats.liveBytes);
+            m_poolPeaks[pool] = std::max(m_poolPeaks[pool], stats.liveBytes);
+            stats.peakBytes = m_poolPeaks[pool];
+        }
+
+        m_stats.peakFrameMemory = std::max(m_stats.peakFrameMemory, m_stats.frameMemoryUsed);
+        m_stats.peakPersistentMemory = persistent.highWater;
+        m_stats.peakUploadMemory = upload.highWater;
+
+        m_stats.persistentMemoryCommitted = persistent.committed;
+        m_stats.uploadMemoryCommitted = upload.committed;
     }
 };
\ No newline at end of file
@@ -0,0 +1,250 @@
+#pragma once
+#include "RenderBackend.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+// Backend without a GPU. Buffers live in system memory so maps and updates
+// behave as on a device; every state change and draw is recorded and
+// counted instead of executed. Benchmarks and CI drive the real frame
+// building code through it and check what reached the "GPU".
+class NullRenderBackend final : public RenderBackend {
+public:
+    struct NullConfig {
+        static constexpr size_t INITIAL_COMMAND_CAPACITY = 4096; // per frame, grows if exceeded
+    };
+
+    enum class CommandType : uint8_t {
+        SetPipeline,
+        SetVertexBuffer,
+        SetIndexBuffer,
+        SetConstantBuffer,
+        Map,
+        UpdateBuffer,
+        Draw,
+        DrawIndexed
+    };
+
+    // One recorded call. Draws record their pipeline in `handle` and fill
+    // every count; the other calls use the fields that apply.
+    struct Command {
+        CommandType type;
+        uint32_t handle = 0;        // buffer or pipeline
+        uint32_t slot = 0;
+        uint32_t count = 0;         // vertices or indices per instance, bytes for maps and
+                                    // updates, stride for vertex and index buffer binds
+        uint32_t instanceCount = 0;
+        uint32_t first = 0;         // first vertex or index, offset for vertex buffer binds and updates
+        uint32_t firstInstance = 0;
+        int32_t baseVertex = 0;
+    };
+
+    struct FrameStats {
+        uint32_t draws;
+        uint32_t instances;
+        uint64_t vertices;        // vertices or indices processed, all instances
+        uint32_t pipelineChanges; // SetPipeline calls that switched pipeline
+        uint32_t bufferBinds;
+        uint32_t maps;
+        uint64_t bytesMapped;
+        uint64_t bytesUpdated;
+        uint32_t invalidCalls;    // unknown handles, draws without a pipeline, maps of non-Dynamic buffers
+    };
+
+    NullRenderBackend() { m_commands.reserve(NullConfig::INITIAL_COMMAND_CAPACITY); }
+
+    BufferHandle CreateBuffer(const BufferDesc& desc, std::span<const std::byte> initialData = {}) override {
+        if (desc.byteWidth == 0 || (desc.usage == BufferUsage::Immutable && initialData.empty())) {
+            return BufferHandle::Invalid;
+        }
+
+        uint32_t index;
+        if (!m_freeBuffers.empty()) {
+            index = m_freeBuffers.back();
+            m_freeBuffers.pop_back();
+        } else {
+            index = static_cast<uint32_t>(m_buffers.size());
+            m_buffers.emplace_back();
+        }
+
+        Buffer& buffer = m_buffers[index];
+        buffer.desc = desc;
+        buffer.data.assign(desc.byteWidth, std::byte{0});
+        if (!initialData.empty()) {
+            std::memcpy(buffer.data.data(), initialData.data(), std::min<size_t>(initialData.size(), desc.byteWidth));
+        }
+        buffer.live = true;
+        buffer.mapped = false;
+        return static_cast<BufferHandle>(index + 1);
+    }
+
+    void DestroyBuffer(BufferHandle handle) override {
+        Buffer* buffer = Find(handle);
+        if (!buffer) return;
+        buffer->live = false;
+        buffer->data = {};
+        m_freeBuffers.push_back(static_cast<uint32_t>(handle) - 1);
+    }
+
+    PipelineHandle CreatePipeline(const PipelineDesc& desc) override {
+        m_pipelines.push_back({desc, true});
+        return static_cast<PipelineHandle>(m_pipelines.size());
+    }
+
+    void DestroyPipeline(PipelineHandle handle) override {
+        const auto index = static_cast<uint32_t>(handle);
+        if (index == 0 || index > m_pipelines.size()) return;
+        m_pipelines[index - 1].live = false;
+    }
+
+    std::span<std::byte> Map(BufferHandle handle, MapMode) override {
+        Buffer* buffer = Find(handle);
+        if (!buffer || buffer->desc.usage != BufferUsage::Dynamic || buffer->mapped) {
+            ++m_stats.invalidCalls;
+            return {};
+        }
+        buffer->mapped = true;
+        ++m_stats.maps;
+        m_stats.bytesMapped += buffer->data.size();
+        Record({CommandType::Map, static_cast<uint32_t>(handle), 0, static_cast<uint32_t>(buffer->data.size())});
+        return buffer->data;
+    }
+
+    void Unmap(BufferHandle handle) override {
+        Buffer* buffer = Find(handle);
+        if (!buffer || !buffer->mapped) {
+            ++m_stats.invalidCalls;
+            return;
+        }
+        buffer->mapped = false;
+    }
+
+    void UpdateBuffer(BufferHandle handle, std::span<const std::byte> data, uint32_t offset = 0) override {
+        Buffer* buffer = Find(handle);
+        if (!buffer || buffer->desc.usage != BufferUsage::Default || offset > buffer->data.size() ||
+            data.size() > buffer->data.size() - offset) {
+            ++m_stats.invalidCalls;
+            return;
+        }
+        if (!data.empty()) std::memcpy(buffer->data.data() + offset, data.data(), data.size());
+        m_stats.bytesUpdated += data.size();
+        Record({CommandType::UpdateBuffer, static_cast<uint32_t>(handle), 0, static_cast<uint32_t>(data.size()), 0, offset});
+    }
+
+    void BeginFrame(const ClearDesc&) override {
+        m_commands.clear();
+        m_stats = {};
+        m_pipeline = PipelineHandle::Invalid;
+    }
+
+    void EndFrame() override {
+        m_lastStats = m_stats;
+        ++m_frameCount;
+    }
+
+    void SetPipeline(PipelineHandle pipeline) override {
+        const auto index = static_cast<uint32_t>(pipeline);
+        if (index == 0 || index > m_pipelines.size() || !m_pipelines[index - 1].live) {
+            ++m_stats.invalidCalls;
+            return;
+        }
+        if (pipeline != m_pipeline) ++m_stats.pipelineChanges;
+        m_pipeline = pipeline;
+        Record({CommandType::SetPipeline, index});
+    }
+
+    void SetVertexBuffer(uint32_t slot, BufferHandle buffer, uint32_t stride, uint32_t offset = 0) override {
+        Bind(CommandType::SetVertexBuffer, buffer, slot, stride, offset);
+    }
+
+    void SetIndexBuffer(BufferHandle buffer, IndexFormat format) override {
+        Bind(CommandType::SetIndexBuffer, buffer, 0, format == IndexFormat::UInt16 ? 2 : 4, 0);
+    }
+
+    void SetConstantBuffer(uint32_t slot, BufferHandle buffer) override {
+        Bind(CommandType::SetConstantBuffer, buffer, slot, 0, 0);
+    }
+
+    void Draw(uint32_t vertexCount, uint32_t firstVertex = 0) override {
+        RecordDraw(CommandType::Draw, vertexCount, 1, firstVertex, 0, 0);
+    }
+
+    void DrawInstanced(uint32_t vertexCount, uint32_t instanceCount,
+                       uint32_t firstVertex = 0, uint32_t firstInstance = 0) override {
+        RecordDraw(CommandType::Draw, vertexCount, instanceCount, firstVertex, firstInstance, 0);
+    }
+
+    void DrawIndexed(uint32_t indexCount, uint32_t firstIndex = 0, int32_t baseVertex = 0) override {
+        RecordDraw(CommandType::DrawIndexed, indexCount, 1, firstIndex, 0, baseVertex);
+    }
+
+    void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex = 0,
+                              int32_t baseVertex = 0, uint32_t firstInstance = 0) override {
+        RecordDraw(CommandType::DrawIndexed, indexCount, instanceCount, firstIndex, firstInstance, baseVertex);
+    }
+
+    // Calls since BeginFrame, and the totals of the frame in progress
+    std::span<const Command> GetCommands() const { return m_commands; }
+    const FrameStats& GetStats() const { return m_stats; }
+    // Totals of the last frame that reached EndFrame
+    const FrameStats& GetLastFrameStats() const { return m_lastStats; }
+    uint64_t GetFrameCount() const { return m_frameCount; }
+
+    // Current contents of a buffer, e.g. to check an upload
+    std::span<const std::byte> GetBufferData(BufferHandle handle) const {
+        const auto index = static_cast<uint32_t>(handle);
+        if (index == 0 || index > m_buffers.size() || !m_buffers[index - 1].live) return {};
+        return m_buffers[index - 1].data;
+    }
+
+private:
+    struct Buffer {
+        BufferDesc desc;
+        std::vector<std::byte> data;
+        bool live = false;
+        bool mapped = false;
+    };
+
+    struct Pipeline {
+        PipelineDesc desc;
+        bool live;
+    };
+
+    std::vector<Buffer> m_buffers;
+    std::vector<uint32_t> m_freeBuffers;
+    std::vector<Pipeline> m_pipelines;
+    std::vector<Command> m_commands;
+    PipelineHandle m_pipeline = PipelineHandle::Invalid;
+    FrameStats m_stats = {};
+    FrameStats m_lastStats = {};
+    uint64_t m_frameCount = 0;
+
+    Buffer* Find(BufferHandle handle) {
+        const auto index = static_cast<uint32_t>(handle);
+        if (index == 0 || index > m_buffers.size() || !m_buffers[index - 1].live) return nullptr;
+        return &m_buffers[index - 1];
+    }
+
+    void Record(const Command& command) { m_commands.push_back(command); }
+
+    void Bind(CommandType type, BufferHandle buffer, uint32_t slot, uint32_t stride, uint32_t offset) {
+        if (!Find(buffer)) {
+            ++m_stats.invalidCalls;
+            return;
+        }
+        ++m_stats.bufferBinds;
+        Record({type, static_cast<uint32_t>(buffer), slot, stride, 0, offset});
+    }
+
+    void RecordDraw(CommandType type, uint32_t count, uint32_t instanceCount, uint32_t first,
+                    uint32_t firstInstance, int32_t baseVertex) {
+        if (m_pipeline == PipelineHandle::Invalid) {
+            ++m_stats.invalidCalls;
+            return;
+        }
+        ++m_stats.draws;
+        m_stats.instances += instanceCount;
+        m_stats.vertices += uint64_t(count) * instanceCount;
+        Record({type, static_cast<uint32_t>(m_pipeline), 0, count, instanceCount, first, firstInstance, baseVertex});
+    }
+};
@@ -0,0 +1,350 @@
+#pragma once
+#include "GameState.hpp"
+#include "ParticleLanes.hpp"
+#include "ParticleStorage.hpp"
+#include "JobSystem.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+// The locked blocks of GameState::grid as bits, one 64-bit mask per layer
+// with bit x * GRID_DEPTH + z set for an occupied cell. A lookup is a shift
+// of one word instead of three levels of bool arrays.
+struct GridOccupancy {
+    static_assert(GameState::GRID_WIDTH * GameState::GRID_DEPTH <= 64, "a layer must fit in one mask");
+
+    // One spare empty layer above the well, so clamped lookups need no branch
+    std::array<uint64_t, GameState::GRID_HEIGHT + 1> layers{};
+    int height = 0; // layers up to the highest occupied one
+
+    // Per cell, bit 2 * axis + side for each face whose neighbour is
+    // empty: side 0 is the lower face along the axis, 1 the upper one
+    std::array<uint8_t, GameState::GRID_WIDTH * GameState::GRID_HEIGHT * GameState::GRID_DEPTH> openFaces{};
+
+    static constexpr int CellIndex(int x, int y, int z) {
+        return (y * GameState::GRID_WIDTH + x) * GameState::GRID_DEPTH + z;
+    }
+
+    void Build(const GameState::GridType& grid) {
+        height = 0;
+        for (int y = 0; y < GameState::GRID_HEIGHT; y++) {
+            uint64_t mask = 0;
+            for (int x = 0; x < GameState::GRID_WIDTH; x++) {
+                for (int z = 0; z < GameState::GRID_DEPTH; z++) {
+                    mask |= uint64_t(grid[x][y][z]) << (x * GameState::GRID_DEPTH + z);
+                }
+            }
+            layers[y] = mask;
+            if (mask) height = y + 1;
+        }
+        layers[GameState::GRID_HEIGHT] = 0;
+
+        for (int y = 0; y < GameState::GRID_HEIGHT; y++) {
+            for (int x = 0; x < GameState::GRID_WIDTH; x++) {
+                for (int z = 0; z < GameState::GRID_DEPTH; z++) {
+                    openFaces[CellIndex(x, y, z)] = static_cast<uint8_t>(
+                        !Solid(x - 1, y, z) << 0 | !Solid(x + 1, y, z) << 1 |
+                        !Solid(x, y - 1, z) << 2 | !Solid(x, y + 1, z) << 3 |
+                        !Solid(x, y, z - 1) << 4 | !Solid(x, y, z + 1) << 5);
+                }
+            }
+        }
+    }
+
+    // Walls and floor count as solid, the open top as empty
+    bool Solid(int x, int y, int z) const {
+        if (x < 0 || x >= GameState::GRID_WIDTH || z < 0 || z >= GameState::GRID_DEPTH || y < 0) return true;
+        if (y >= GameState::GRID_HEIGHT) return false;
+        return (layers[y] >> (x * GameState::GRID_DEPTH + z)) & 1;
+    }
+};
+
+// Bounces particles off the well: its floor, its four walls and the locked
+// blocks. Runs after ParticleStorage::Update, eight particles at a time: the
+// walls and floor are branch-free clamps, the block test packs one occupancy
+// bit per particle, and only groups with a hit are pushed back out.
+class ParticleCollider {
+public:
+    struct ColliderConfig {
+        // World bounds of the well; cell (x, y, z) is the unit cube centred
+        // on (x - GRID_WIDTH / 2, y, z - GRID_DEPTH / 2), as Render.cpp draws it
+        static constexpr float MIN_X = -GameState::GRID_WIDTH / 2.0f - 0.5f;
+        static constexpr float MIN_Y = -0.5f;
+        static constexpr float MIN_Z = -GameState::GRID_DEPTH / 2.0f - 0.5f;
+        static constexpr float MAX_X = MIN_X + GameState::GRID_WIDTH;
+        static constexpr float MAX_Z = MIN_Z + GameState::GRID_DEPTH;
+        static constexpr float SURFACE_OFFSET = 1e-3f;  // pushed-out particles sit just off the face
+        static constexpr float SETTLE_SPEED = 0.25f;    // bounces slower than this stop dead
+        static constexpr float DEFAULT_RESTITUTION = 0.4f;
+        static constexpr float DEFAULT_FRICTION = 0.7f; // tangential velocity kept per contact
+        static constexpr uint32_t BLOCK = 8; // particles per ParticleLanes::F8
+        static constexpr uint32_t PARALLEL_CHUNK = ParticleStorage::StorageConfig::PARALLEL_CHUNK;
+    };
+
+    struct CollisionParams {
+        float restitution = ColliderConfig::DEFAULT_RESTITUTION;
+        float friction = ColliderConfig::DEFAULT_FRICTION;
+    };
+
+    void SetGrid(const GameState::GridType& grid) { m_occupancy.Build(grid); }
+    const GridOccupancy& GetOccupancy() const { return m_occupancy; }
+
+    void Collide(ParticleStorage& particles, const CollisionParams& params, JobSystem* jobs = nullptr) const {
+        const uint32_t count = particles.Count();
+        Columns columns = {
+            particles.GetMutableColumn(ParticleStorage::PositionX),
+            particles.GetMutableColumn(ParticleStorage::PositionY),
+            particles.GetMutableColumn(ParticleStorage::PositionZ),
+            particles.GetMutableColumn(ParticleStorage::VelocityX),
+            particles.GetMutableColumn(ParticleStorage::VelocityY),
+            particles.GetMutableColumn(ParticleStorage::VelocityZ)
+        };
+        auto collide = [&](uint32_t, uint32_t begin, uint32_t end) { CollideRange(columns, begin, end, params); };
+        if (jobs && count > ColliderConfig::PARALLEL_CHUNK) {
+            jobs->ParallelFor(count, ColliderConfig::PARALLEL_CHUNK, collide);
+        } else {
+            collide(0, 0, count);
+        }
+    }
+
+private:
+    struct Columns {
+        float* px;
+        float* py;
+        float* pz;
+        float* vx;
+        float* vy;
+        float* vz;
+    };
+
+    GridOccupancy m_occupancy;
+
+    static float Bounce(float velocity, float restitution) {
+        const float bounced = -velocity * restitution;
+        return std::abs(bounced) < ColliderConfig::SETTLE_SPEED ? 0.0f : bounced;
+    }
+
+    void CollideRange(const Columns& c, uint32_t begin, uint32_t end, const CollisionParams& params) const {
+        constexpr uint32_t BLOCK = ColliderConfig::BLOCK;
+        uint32_t block = begin;
+        for (; block + BLOCK <= end; block += BLOCK) {
+            const uint32_t hits = CollideBlock(c, block, params);
+            if (hits) ResolveBlock(c, block, hits, params);
+        }
+
+        // The tail, one particle at a time
+        for (; block < end; ++block) {
+            if (CollideBounds(c, block, params)) ResolveParticle(c, block, params);
+        }
+    }
+
+    // Floor and walls for eight particles: clamps the positions and
+    // reflects the velocity components that point out of the well. Returns
+    // the occupancy bits of the clamped positions, one per lane; cells above
+    // the well hit the spare empty layer.
+    uint32_t CollideBlock(const Columns& c, uint32_t i, const CollisionParams& params) const {
+        using namespace ParticleLanes;
+        const F8 zero = Splat(0.0f);
+        const F8 minX = Splat(ColliderConfig::MIN_X);
+        const F8 minY = Splat(ColliderConfig::MIN_Y);
+        const F8 minZ = Splat(ColliderConfig::MIN_Z);
+        const F8 maxX = Splat(ColliderConfig::MAX_X);
+        const F8 maxZ = Splat(ColliderConfig::MAX_Z);
+        const F8 restitution = Splat(params.restitution);
+        const F8 friction = Splat(params.friction);
+
+        const F8 x = Load(c.px + i);
+        const F8 y = Load(c.py + i);
+        const F8 z = Load(c.pz + i);
+        const F8 vx = Load(c.vx + i);
+        const F8 vy = Load(c.vy + i);
+        const F8 vz = Load(c.vz + i);
+        const F8 wallX = (Less(x, minX) & Less(vx, zero)) | (Less(maxX, x) & Less(zero, vx));
+        const F8 wallZ = (Less(z, minZ) & Less(vz, zero)) | (Less(maxZ, z) & Less(zero, vz));
+        const F8 floor = Less(y, minY);
+        const F8 cx = Min(Max(x, minX), maxX);
+        const F8 cy = Max(y, minY);
+        const F8 cz = Min(Max(z, minZ), maxZ);
+        Store(c.px + i, cx);
+        Store(c.py + i, cy);
+        Store(c.pz + i, cz);
+        Store(c.vx + i, Select(wallX, Bounce(vx, restitution), Select(floor, vx * friction, vx)));
+        Store(c.vy + i, Select(floor & Less(vy, zero), Bounce(vy, restitution), vy));
+        Store(c.vz + i, Select(wallZ, Bounce(vz, restitution), Select(floor, vz * friction, vz)));
+
+        // Only particles below the top of the stack can be inside a block,
+        // so the usual group above it skips the lookups entirely
+        uint32_t candidates = MoveMask(Less(cy, Splat(ColliderConfig::MIN_Y + m_occupancy.height)));
+        if (!candidates) return 0;
+
+        alignas(32) uint32_t ix[ColliderConfig::BLOCK];
+        alignas(32) uint32_t iy[ColliderConfig::BLOCK];
+        alignas(32) uint32_t iz[ColliderConfig::BLOCK];
+        Store(ix, Truncate(Min(cx - minX, Splat(GameState::GRID_WIDTH - 1.0f))));
+        Store(iy, Truncate(cy - minY));
+        Store(iz, Truncate(Min(cz - minZ, Splat(GameState::GRID_DEPTH - 1.0f))));
+        uint32_t hits = 0;
+        while (candidates) {
+            const auto lane = static_cast<uint32_t>(std::countr_zero(candidates));
+            candidates &= candidates - 1;
+            const uint64_t layer = m_occupancy.layers[iy[lane]];
+            hits |= static_cast<uint32_t>((layer >> (ix[lane] * GameState::GRID_DEPTH + iz[lane])) & 1) << lane;
+        }
+        return hits;
+    }
+
+    static ParticleLanes::F8 Bounce(ParticleLanes::F8 velocity, ParticleLanes::F8 restitution) {
+        using namespace ParticleLanes;
+        const F8 bounced = Splat(0.0f) - velocity * restitution;
+        return Select(Less(Abs(bounced), Splat(ColliderConfig::SETTLE_SPEED)), Splat(0.0f), bounced);
+    }
+
+    // The same for one particle of the tail
+    uint32_t CollideBounds(const Columns& c, uint32_t i, const CollisionParams& params) const {
+        const float x = c.px[i];
+        const float y = c.py[i];
+        const float z = c.pz[i];
+        const float vx = c.vx[i];
+        const float vy = c.vy[i];
+        const float vz = c.vz[i];
+        const bool wallX = (x < ColliderConfig::MIN_X && vx < 0.0f) || (x > ColliderConfig::MAX_X && vx > 0.0f);
+        const bool wallZ = (z < ColliderConfig::MIN_Z && vz < 0.0f) || (z > ColliderConfig::MAX_Z && vz > 0.0f);
+        const bool floor = y < ColliderConfig::MIN_Y;
+        const float cx = std::clamp(x, ColliderConfig::MIN_X, ColliderConfig::MAX_X);
+        const float cy = std::max(y, ColliderConfig::MIN_Y);
+        const float cz = std::clamp(z, ColliderConfig::MIN_Z, ColliderConfig::MAX_Z);
+        c.px[i] = cx;
+        c.py[i] = cy;
+        c.pz[i] = cz;
+        c.vx[i] = wallX ? Bounce(vx, params.restitution) : (floor ? vx * params.friction : vx);
+        c.vy[i] = floor && vy < 0.0f ? Bounce(vy, params.restitution) : vy;
+        c.vz[i] = wallZ ? Bounce(vz, params.restitution) : (floor ? vz * params.friction : vz);
+
+        const auto ix = std::min(static_cast<uint32_t>(cx - ColliderConfig::MIN_X), uint32_t(GameState::GRID_WIDTH - 1));
+        const auto iy = std::min(static_cast<uint32_t>(std::min(cy - ColliderConfig::MIN_Y, float(GameState::GRID_HEIGHT))),
+                                 uint32_t(GameState::GRID_HEIGHT));
+        const auto iz = std::min(static_cast<uint32_t>(cz - ColliderConfig::MIN_Z), uint32_t(GameState::GRID_DEPTH - 1));
+        return static_cast<uint32_t>((m_occupancy.layers[iy] >> (ix * GameState::GRID_DEPTH + iz)) & 1);
+    }
+
+    // Pushes the particles in `hits` out of the locked blocks they are in.
+    // Each entered through the face it crossed most recently, i.e. the
+    // smallest penetration over speed along the axis; faces backed by
+    // another solid cell are skipped, and a particle with no way out leaves
+    // through the top. Worked out for all eight lanes at once: most hits are
+    // particles resting on the stack, and per-particle branches on which
+    // face they hit mispredict constantly.
+    void ResolveBlock(const Columns& c, uint32_t i, uint32_t hits, const CollisionParams& params) const {
+        using namespace ParticleLanes;
+        constexpr std::array<float, 3> MIN = {ColliderConfig::MIN_X, ColliderConfig::MIN_Y, ColliderConfig::MIN_Z};
+        constexpr std::array<float, 3> LAST_CELL = {
+            GameState::GRID_WIDTH - 1.0f, GameState::GRID_HEIGHT - 1.0f, GameState::GRID_DEPTH - 1.0f
+        };
+        const std::array<float*, 3> positions = {c.px + i, c.py + i, c.pz + i};
+        const std::array<float*, 3> velocities = {c.vx + i, c.vy + i, c.vz + i};
+        const F8 zero = Splat(0.0f);
+        const F8 one = Splat(1.0f);
+        const F8 allSet = Less(zero, one);
+
+        std::array<F8, 3> p;
+        std::array<F8, 3> v;
+        std::array<F8, 3> cell;
+        alignas(32) std::array<std::array<uint32_t, ColliderConfig::BLOCK>, 3> cellIndex;
+        for (int axis = 0; axis < 3; ++axis) {
+            p[axis] = Load(positions[axis]);
+            v[axis] = Load(velocities[axis]);
+            // Clamped like the occupancy lookup, so a particle on the far wall stays in the last cell
+            const U8 index = Truncate(Min(p[axis] - Splat(MIN[axis]), Splat(LAST_CELL[axis])));
+            Store(cellIndex[axis].data(), index);
+            cell[axis] = ToFloat(index);
+        }
+
+        // Open faces of each hit cell; lanes without a hit get none and are
+        // left as they are
+        alignas(32) std::array<uint32_t, ColliderConfig::BLOCK> open = {};
+        alignas(32) std::array<uint32_t, ColliderConfig::BLOCK> hit = {};
+        for (uint32_t lanes = hits; lanes; lanes &= lanes - 1) {
+            const auto lane = static_cast<uint32_t>(std::countr_zero(lanes));
+            open[lane] = m_occupancy.openFaces[GridOccupancy::CellIndex(
+                cellIndex[0][lane], cellIndex[1][lane], cellIndex[2][lane])];
+            hit[lane] = 1;
+        }
+        const U8 openFaces = Load(open.data());
+        const F8 hitLanes = NonZero(Load(hit.data()));
+
+        F8 bestTime = Splat(std::numeric_limits<float>::max());
+        F8 bestUpper = allSet;
+        std::array<F8, 3> best = {zero, allSet, zero};
+        for (int axis = 0; axis < 3; ++axis) {
+            const F8 upper = Less(v[axis], zero); // moving down the axis, so it came in through the upper face
+            const F8 face = Splat(MIN[axis]) + cell[axis] + Select(upper, one, zero);
+            const F8 usable = Select(upper, NonZero(openFaces & SplatBits(2u << (2 * axis))),
+                                            NonZero(openFaces & SplatBits(1u << (2 * axis))))
+                            & (upper | Less(zero, v[axis]));
+            const F8 time = Select(usable, Abs(p[axis] - face) / Max(Abs(v[axis]), Splat(1e-20f)), bestTime);
+            const F8 better = Less(time, bestTime);
+            bestTime = Select(better, time, bestTime);
+            bestUpper = Select(better, upper, bestUpper);
+            for (int previous = 0; previous < axis; ++previous) {
+                best[previous] = Select(better, zero, best[previous]);
+            }
+            best[axis] = Select(better, allSet, best[axis]);
+        }
+
+        const F8 restitution = Splat(params.restitution);
+        const F8 friction = Splat(params.friction);
+        const F8 offset = Select(bestUpper, Splat(1.0f + ColliderConfig::SURFACE_OFFSET),
+                                            Splat(-ColliderConfig::SURFACE_OFFSET));
+        for (int axis = 0; axis < 3; ++axis) {
+            const F8 inward = Select(bestUpper, Less(v[axis], zero), Less(zero, v[axis]));
+            const F8 normal = Select(inward, Bounce(v[axis], restitution), v[axis]);
+            const F8 velocity = Select(best[axis], normal, v[axis] * friction);
+            Store(velocities[axis], Select(hitLanes, velocity, v[axis]));
+            const F8 pushed = Splat(MIN[axis]) + cell[axis] + offset;
+            Store(positions[axis], Select(hitLanes & best[axis], pushed, p[axis]));
+        }
+    }
+
+    // The same for one particle of the tail
+    void ResolveParticle(const Columns& c, uint32_t i, const CollisionParams& params) const {
+        constexpr std::array<float, 3> MIN = {ColliderConfig::MIN_X, ColliderConfig::MIN_Y, ColliderConfig::MIN_Z};
+        const std::array<float*, 3> position = {&c.px[i], &c.py[i], &c.pz[i]};
+        const std::array<float*, 3> velocity = {&c.vx[i], &c.vy[i], &c.vz[i]};
+        const std::array<int, 3> cell = {
+            std::min(static_cast<int>(c.px[i] - MIN[0]), GameState::GRID_WIDTH - 1),
+            static_cast<int>(c.py[i] - MIN[1]),
+            std::min(static_cast<int>(c.pz[i] - MIN[2]), GameState::GRID_DEPTH - 1)
+        };
+        const uint32_t open = m_occupancy.openFaces[GridOccupancy::CellIndex(cell[0], cell[1], cell[2])];
+
+        int bestAxis = 1;
+        int bestUpper = 1;
+        float bestTime = std::numeric_limits<float>::max();
+        for (int axis = 0; axis < 3; ++axis) {
+            const float v = *velocity[axis];
+            const int upper = v < 0.0f;
+            if (v == 0.0f || !((open >> (2 * axis + upper)) & 1)) continue;
+
+            const float time = std::abs(*position[axis] - (MIN[axis] + cell[axis] + upper)) / std::abs(v);
+            if (time < bestTime) {
+                bestTime = time;
+                bestAxis = axis;
+                bestUpper = upper;
+            }
+        }
+
+        for (int axis = 0; axis < 3; ++axis) {
+            float& v = *velocity[axis];
+            if (axis != bestAxis) {
+                v *= params.friction;
+            } else if (bestUpper ? v < 0.0f : v > 0.0f) {
+                v = Bounce(v, params.restitution);
+            }
+        }
+        *position[bestAxis] = MIN[bestAxis] + cell[bestAxis] +
+                              (bestUpper ? 1.0f + ColliderConfig::SURFACE_OFFSET : -ColliderConfig::SURFACE_OFFSET);
+    }
+};
@@ -0,0 +1,150 @@
+#pragma once
+#include "ParticleStorage.hpp"
+#include "JobSystem.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <span>
+
+// Back-to-front order of a ParticleStorage's live particles, for alpha
+// blending with depth writes off. View depths are quantized to 16-bit keys
+// over the frame's depth range and ordered with an LSD radix sort (two
+// 8-bit digits), so the cost is linear with no comparisons.
+class ParticleDepthSort {
+public:
+    struct SortConfig {
+        static constexpr uint32_t DIGIT_BITS = 8;
+        static constexpr uint32_t BUCKETS = 1u << DIGIT_BITS;
+        static constexpr uint32_t KEY_BITS = 16;
+        static constexpr uint32_t PASSES = KEY_BITS / DIGIT_BITS;
+        static constexpr uint32_t PARALLEL_CHUNK = ParticleStorage::StorageConfig::PARALLEL_CHUNK;
+    };
+
+    explicit ParticleDepthSort(uint32_t capacity,
+                               std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : m_capacity(capacity), m_upstream(upstream) {
+        m_block = static_cast<std::byte*>(m_upstream->allocate(BlockBytes(), alignof(uint32_t)));
+        auto* indices = reinterpret_cast<uint32_t*>(m_block);
+        m_indices = {indices, indices + capacity};
+        auto* depths = reinterpret_cast<float*>(indices + 2 * size_t(capacity));
+        m_depths = depths;
+        auto* keys = reinterpret_cast<uint16_t*>(depths + capacity);
+        m_keys = {keys, keys + capacity};
+    }
+
+    ~ParticleDepthSort() { m_upstream->deallocate(m_block, BlockBytes(), alignof(uint32_t)); }
+
+    ParticleDepthSort(const ParticleDepthSort&) = delete;
+    ParticleDepthSort& operator=(const ParticleDepthSort&) = delete;
+
+    // Orders the live particles by distance along `forward` (unit length)
+    // from `eye`, farthest first
+    void Sort(const ParticleStorage& particles, const XMFLOAT3& eye, const XMFLOAT3& forward,
+              JobSystem* jobs = nullptr) {
+        const uint32_t count = std::min(particles.Count(), m_capacity);
+        m_count = count;
+        m_current = 0;
+        if (count == 0) return;
+
+        // View depth of every particle, plus the depth range of each chunk
+        const uint32_t rangeChunk = std::max(SortConfig::PARALLEL_CHUNK,
+                                             (count + MAX_RANGE_CHUNKS - 1) / MAX_RANGE_CHUNKS);
+        const uint32_t rangeCount = (count + rangeChunk - 1) / rangeChunk;
+        std::array<float, 2 * MAX_RANGE_CHUNKS> ranges;
+        auto depthPass = [&](uint32_t chunk, uint32_t begin, uint32_t end) {
+            const float* px = particles.GetColumn(ParticleStorage::PositionX).data();
+            const float* py = particles.GetColumn(ParticleStorage::PositionY).data();
+            const float* pz = particles.GetColumn(ParticleStorage::PositionZ).data();
+            const float offset = -(eye.x * forward.x + eye.y * forward.y + eye.z * forward.z);
+            float lo = std::numeric_limits<float>::max();
+            float hi = std::numeric_limits<float>::lowest();
+            for (uint32_t i = begin; i < end; ++i) {
+                const float depth = px[i] * forward.x + py[i] * forward.y + pz[i] * forward.z + offset;
+                m_depths[i] = depth;
+                lo = std::min(lo, depth);
+                hi = std::max(hi, depth);
+            }
+            ranges[2 * chunk] = lo;
+            ranges[2 * chunk + 1] = hi;
+        };
+        if (jobs) {
+            jobs->ParallelFor(count, rangeChunk, depthPass);
+        } else {
+            for (uint32_t chunk = 0; chunk < rangeCount; ++chunk) {
+                depthPass(chunk, chunk * rangeChunk, std::min((chunk + 1) * rangeChunk, count));
+            }
+        }
+
+        float nearest = ranges[0];
+        float farthest = ranges[1];
+        for (uint32_t chunk = 1; chunk < rangeCount; ++chunk) {
+            nearest = std::min(nearest, ranges[2 * chunk]);
+            farthest = std::max(farthest, ranges[2 * chunk + 1]);
+        }
+
+        // Farthest gets key 0 so an ascending sort is back to front
+        constexpr float KEY_MAX = float((1u << SortConfig::KEY_BITS) - 1);
+        const float scale = farthest > nearest ? KEY_MAX / (farthest - nearest) : 0.0f;
+        std::array<std::array<uint32_t, SortConfig::BUCKETS>, SortConfig::PASSES> histograms = {};
+        uint16_t* keys = m_keys[0];
+        uint32_t* indices = m_indices[0];
+        for (uint32_t i = 0; i < count; ++i) {
+            const auto key = static_cast<uint16_t>((farthest - m_depths[i]) * scale);
+            keys[i] = key;
+            indices[i] = i;
+            ++histograms[0][key & (SortConfig::BUCKETS - 1)];
+            ++histograms[1][key >> SortConfig::DIGIT_BITS];
+        }
+
+        // One stable scatter per digit, low digit first
+        for (uint32_t pass = 0; pass < SortConfig::PASSES; ++pass) {
+            auto& histogram = histograms[pass];
+            const uint32_t shift = pass * SortConfig::DIGIT_BITS;
+            if (histogram[(keys[0] >> shift) & (SortConfig::BUCKETS - 1)] == count) {
+                continue; // every key has the same digit, so this pass would not move anything
+            }
+
+            uint32_t offset = 0;
+            for (uint32_t& bucket : histogram) {
+                const uint32_t size = bucket;
+                bucket = offset;
+                offset += size;
+            }
+
+            const uint32_t from = m_current;
+            const uint32_t to = from ^ 1;
+            const uint16_t* srcKeys = m_keys[from];
+            const uint32_t* srcIndices = m_indices[from];
+            uint16_t* dstKeys = m_keys[to];
+            uint32_t* dstIndices = m_indices[to];
+            for (uint32_t i = 0; i < count; ++i) {
+                const uint16_t key = srcKeys[i];
+                const uint32_t slot = histogram[(key >> shift) & (SortConfig::BUCKETS - 1)]++;
+                dstKeys[slot] = key;
+                dstIndices[slot] = srcIndices[i];
+            }
+            m_current = to;
+        }
+    }
+
+    // Particle indices from the last Sort, farthest first
+    std::span<const uint32_t> GetOrder() const { return {m_indices[m_current], m_count}; }
+
+private:
+    static constexpr uint32_t MAX_RANGE_CHUNKS = 64;
+
+    uint32_t m_capacity;
+    std::pmr::memory_resource* m_upstream;
+    std::byte* m_block = nullptr;
+    std::array<uint32_t*, 2> m_indices = {};
+    std::array<uint16_t*, 2> m_keys = {};
+    float* m_depths = nullptr;
+    uint32_t m_current = 0;
+    uint32_t m_count = 0;
+
+    size_t BlockBytes() const {
+        return size_t(m_capacity) * (2 * sizeof(uint32_t) + sizeof(float) + 2 * sizeof(uint16_t));
+    }
+};
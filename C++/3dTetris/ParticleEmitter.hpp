@@ -0,0 +1,265 @@
+#pragma once
+#include "ParticleLanes.hpp"
+#include "ParticleStorage.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+// What one effect spawns, as data. Ranges are sampled uniformly per
+// particle. Velocity is baseVelocity + direction * speed + jitter, where the
+// direction comes from the unit-sphere table and is pulled toward coneAxis
+// as coneSpread goes to 0. Color and size ramp linearly over each
+// particle's own lifetime, from their spawn values to their end values.
+struct EmitterDesc {
+    uint32_t burst = 1;     // particles per origin for a one-shot Emit
+    float rate = 0.0f;      // particles per second for EmitOverTime
+    float lifeMin = 1.0f;
+    float lifeMax = 1.0f;
+    XMFLOAT3 baseVelocity = {0.0f, 0.0f, 0.0f};
+    XMFLOAT3 coneAxis = {0.0f, 1.0f, 0.0f};
+    float coneSpread = 1.0f; // 0 along coneAxis, 1 any direction
+    float speedMin = 0.0f;
+    float speedMax = 0.0f;
+    XMFLOAT3 velocityJitter = {0.0f, 0.0f, 0.0f}; // +/- per axis
+    XMFLOAT4 colorStart = {1.0f, 1.0f, 1.0f, 1.0f}; // at spawn
+    XMFLOAT4 colorEnd = {1.0f, 1.0f, 1.0f, 1.0f};   // when life runs out
+    float sizeMin = 0.1f;   // spawn size range
+    float sizeMax = 0.1f;
+    float sizeEnd = 1.0f;   // size when life runs out, as a multiple of the spawn size
+    float rotationSpeedMin = 0.0f;
+    float rotationSpeedMax = 0.0f;
+};
+
+// xorshift128 in eight independent lanes, one register per state word.
+// Every SIMD level produces the same sequence.
+class ParticleRandom {
+public:
+    static constexpr uint32_t LANES = 8;
+
+    explicit ParticleRandom(uint64_t seed) { Seed(seed); }
+
+    void Seed(uint64_t seed) {
+        // splitmix64 spreads one seed over every lane
+        alignas(32) uint32_t words[4][LANES];
+        for (uint32_t i = 0; i < 4 * LANES; i += 2) {
+            seed += 0x9E3779B97F4A7C15ull;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            z ^= z >> 31;
+            words[i / LANES][i % LANES] = static_cast<uint32_t>(z);
+            words[i / LANES][i % LANES + 1] = static_cast<uint32_t>(z >> 32);
+        }
+        // An all-zero lane would stay zero forever
+        for (uint32_t lane = 0; lane < LANES; ++lane) {
+            if (!(words[0][lane] | words[1][lane] | words[2][lane] | words[3][lane])) words[3][lane] = 1;
+        }
+        for (uint32_t row = 0; row < 4; ++row) m_state[row] = ParticleLanes::Load(words[row]);
+    }
+
+    ParticleLanes::U8 NextBits() {
+        using namespace ParticleLanes;
+        U8 t = m_state[0] ^ ShiftLeft<11>(m_state[0]);
+        t = t ^ ShiftRight<8>(t);
+        const U8 w = m_state[3];
+        m_state[0] = m_state[1];
+        m_state[1] = m_state[2];
+        m_state[2] = w;
+        m_state[3] = w ^ ShiftRight<19>(w) ^ t;
+        return m_state[3];
+    }
+
+    // Eight floats in [min, max)
+    ParticleLanes::F8 NextRange(float min, float max) {
+        using namespace ParticleLanes;
+        return Splat(min) + UnitFromBits(NextBits()) * Splat(max - min);
+    }
+
+private:
+    std::array<ParticleLanes::U8, 4> m_state; // x, y, z, w
+};
+
+// Runs EmitterDescs against a ParticleStorage eight particles at a time,
+// writing straight into its columns. Directions come from a fixed table of
+// points spread evenly over the unit sphere, so spawning needs no
+// trigonometry or per-particle distributions.
+class ParticleEmitter {
+public:
+    struct EmitterConfig {
+        static constexpr uint32_t DIRECTION_BITS = 10; // 1024 table entries
+        static constexpr uint32_t DIRECTION_COUNT = 1u << DIRECTION_BITS;
+    };
+
+    explicit ParticleEmitter(uint64_t seed) : m_random(seed) {}
+
+    // Spawns desc.burst particles at each origin; returns how many fit
+    uint32_t Emit(ParticleStorage& storage, const EmitterDesc& desc, std::span<const XMFLOAT3> origins) {
+        return Emit(storage, desc, origins, static_cast<uint32_t>(origins.size()) * desc.burst);
+    }
+
+    // Spawns `requested` particles spread evenly over the origins, e.g. a
+    // thinned-out burst; returns how many fit
+    uint32_t Emit(ParticleStorage& storage, const EmitterDesc& desc, std::span<const XMFLOAT3> origins,
+                  uint32_t requested) {
+        if (origins.empty()) return 0;
+        const uint32_t first = storage.Count();
+        const uint32_t count = storage.Append(requested);
+        if (count == 0) return 0;
+
+        WritePositions(storage, first, count, requested, origins);
+        WriteAttributes(storage, first, count, desc);
+        return count;
+    }
+
+    uint32_t Emit(ParticleStorage& storage, const EmitterDesc& desc, const XMFLOAT3& origin) {
+        return Emit(storage, desc, std::span<const XMFLOAT3>(&origin, 1));
+    }
+
+    // Continuous emission at desc.rate. `carry` holds the fraction of a
+    // particle left over between calls and belongs to the caller.
+    uint32_t EmitOverTime(ParticleStorage& storage, const EmitterDesc& desc, const XMFLOAT3& origin,
+                          float deltaTime, float& carry) {
+        carry += desc.rate * deltaTime;
+        const uint32_t whole = static_cast<uint32_t>(carry);
+        if (whole == 0) return 0;
+        carry -= static_cast<float>(whole);
+
+        const uint32_t first = storage.Count();
+        const uint32_t count = storage.Append(whole);
+        if (count == 0) return 0;
+
+        WritePositions(storage, first, count, whole, std::span<const XMFLOAT3>(&origin, 1));
+        WriteAttributes(storage, first, count, desc);
+        return count;
+    }
+
+private:
+    using Column = ParticleStorage::Column;
+    static constexpr uint32_t LANES = ParticleRandom::LANES;
+
+    struct DirectionTable {
+        std::array<float, EmitterConfig::DIRECTION_COUNT> x, y, z;
+    };
+
+    ParticleRandom m_random;
+
+    // Fibonacci lattice: even coverage without clustering at the poles
+    static const DirectionTable& Directions() {
+        static const DirectionTable table = [] {
+            DirectionTable t;
+            constexpr float GOLDEN_ANGLE = 2.39996323f;
+            constexpr float N = static_cast<float>(EmitterConfig::DIRECTION_COUNT);
+            for (uint32_t i = 0; i < EmitterConfig::DIRECTION_COUNT; ++i) {
+                const float y = 1.0f - (2.0f * i + 1.0f) / N;
+                const float radius = std::sqrt(1.0f - y * y);
+                const float angle = GOLDEN_ANGLE * i;
+                t.x[i] = radius * std::cos(angle);
+                t.y[i] = y;
+                t.z[i] = radius * std::sin(angle);
+            }
+            return t;
+        }();
+        return table;
+    }
+
+    // Origin k gets particles [k * requested / n, (k + 1) * requested / n);
+    // anything past `count` did not fit
+    static void WritePositions(ParticleStorage& storage, uint32_t first, uint32_t count, uint32_t requested,
+                               std::span<const XMFLOAT3> origins) {
+        float* px = storage.GetMutableColumn(ParticleStorage::PositionX) + first;
+        float* py = storage.GetMutableColumn(ParticleStorage::PositionY) + first;
+        float* pz = storage.GetMutableColumn(ParticleStorage::PositionZ) + first;
+        const uint64_t n = origins.size();
+        uint32_t begin = 0;
+        for (uint64_t k = 0; k < n && begin < count; ++k) {
+            const uint32_t end = std::min(static_cast<uint32_t>((k + 1) * requested / n), count);
+            std::fill(px + begin, px + end, origins[k].x);
+            std::fill(py + begin, py + end, origins[k].y);
+            std::fill(pz + begin, pz + end, origins[k].z);
+            begin = end;
+        }
+    }
+
+    void WriteAttributes(ParticleStorage& storage, uint32_t first, uint32_t count, const EmitterDesc& desc) {
+        using namespace ParticleLanes;
+        const DirectionTable& directions = Directions();
+        const float keep = 1.0f - desc.coneSpread;
+        const F8 spread = Splat(desc.coneSpread);
+        const F8 axisX = Splat(desc.coneAxis.x * keep);
+        const F8 axisY = Splat(desc.coneAxis.y * keep);
+        const F8 axisZ = Splat(desc.coneAxis.z * keep);
+        const F8 baseX = Splat(desc.baseVelocity.x);
+        const F8 baseY = Splat(desc.baseVelocity.y);
+        const F8 baseZ = Splat(desc.baseVelocity.z);
+        const XMFLOAT4& c0 = desc.colorStart;
+        const XMFLOAT4& c1 = desc.colorEnd;
+        const XMFLOAT3& jitter = desc.velocityJitter;
+
+        // One block of eight particles, column by column
+        alignas(32) float out[Column::COLUMN_COUNT][LANES];
+        alignas(32) float gx[LANES], gy[LANES], gz[LANES];
+        alignas(32) uint32_t pick[LANES];
+        Store(out[Column::Rotation], Splat(0.0f));
+        Store(out[Column::ColorR], Splat(c0.x));
+        Store(out[Column::ColorG], Splat(c0.y));
+        Store(out[Column::ColorB], Splat(c0.z));
+        Store(out[Column::ColorA], Splat(c0.w));
+        Store(out[Column::ColorEndR], Splat(c1.x));
+        Store(out[Column::ColorEndG], Splat(c1.y));
+        Store(out[Column::ColorEndB], Splat(c1.z));
+        Store(out[Column::ColorEndA], Splat(c1.w));
+        const F8 sizeEnd = Splat(desc.sizeEnd);
+
+        // A local copy lets the generator state live in registers
+        ParticleRandom random = m_random;
+
+        for (uint32_t base = 0; base < count; base += LANES) {
+            Store(pick, random.NextBits());
+            for (uint32_t lane = 0; lane < LANES; ++lane) {
+                const uint32_t d = pick[lane] >> (32 - EmitterConfig::DIRECTION_BITS);
+                gx[lane] = directions.x[d];
+                gy[lane] = directions.y[d];
+                gz[lane] = directions.z[d];
+            }
+
+            F8 dx = axisX + Load(gx) * spread;
+            F8 dy = axisY + Load(gy) * spread;
+            F8 dz = axisZ + Load(gz) * spread;
+            if (desc.coneSpread < 1.0f) {
+                const F8 inverse = Splat(1.0f) / Sqrt(dx * dx + dy * dy + dz * dz + Splat(1e-12f));
+                dx = dx * inverse;
+                dy = dy * inverse;
+                dz = dz * inverse;
+            }
+
+            const F8 speed = random.NextRange(desc.speedMin, desc.speedMax);
+            Store(out[Column::VelocityX], baseX + dx * speed + random.NextRange(-jitter.x, jitter.x));
+            Store(out[Column::VelocityY], baseY + dy * speed + random.NextRange(-jitter.y, jitter.y));
+            Store(out[Column::VelocityZ], baseZ + dz * speed + random.NextRange(-jitter.z, jitter.z));
+
+            const F8 life = random.NextRange(desc.lifeMin, desc.lifeMax);
+            const F8 size = random.NextRange(desc.sizeMin, desc.sizeMax);
+            Store(out[Column::Life], life);
+            Store(out[Column::Lifetime], life);
+            Store(out[Column::Size], size);
+            Store(out[Column::SizeEnd], size * sizeEnd);
+            Store(out[Column::RotationSpeed], random.NextRange(desc.rotationSpeedMin, desc.rotationSpeedMax));
+
+            // Constant-size copies for whole blocks compile to vector stores;
+            // only the last block copies a partial one
+            const uint32_t lanes = std::min(LANES, count - base);
+            for (uint32_t column = Column::VelocityX; column < Column::COLUMN_COUNT; ++column) {
+                float* dst = storage.GetMutableColumn(Column(column)) + first + base;
+                if (lanes == LANES) {
+                    std::memcpy(dst, out[column], sizeof(float) * LANES);
+                } else {
+                    std::memcpy(dst, out[column], sizeof(float) * lanes);
+                }
+            }
+        }
+        m_random = random;
+    }
+};
@@ -0,0 +1,274 @@
+#pragma once
+#include "ParticleCollision.hpp"
+#include "ParticleDepthSort.hpp"
+#include "ParticleEmitter.hpp"
+#include "FrustumCuller.hpp"
+#include "JobSystem.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+// Who wins when the budget runs out. Each priority may fill the budget up
+// to its share; Critical effects may also evict live particles.
+enum class EffectPriority : uint8_t {
+    Low,
+    Normal,
+    High,
+    Critical,
+    COUNT
+};
+
+struct ParticleEffectDesc {
+    EmitterDesc emitter;
+    EffectPriority priority = EffectPriority::Normal;
+};
+
+// The one particle simulation in the game. Every effect spawns into a
+// single storage under a global budget, so the per-frame cost stays bounded
+// however many effects fire at once:
+//  - the budget shrinks while frames run over the target time and grows
+//    back slowly while they make it
+//  - bursts far from the camera, where particles cover few pixels, spawn
+//    fewer, larger particles (LOD)
+//  - bursts that do not fit in their priority's share of the budget are
+//    thinned the same way
+class ParticleEngine {
+public:
+    struct EngineConfig {
+        static constexpr uint32_t MAX_PARTICLES = 1u << 17; // storage, and the budget's ceiling
+        static constexpr uint32_t MIN_BUDGET = 1024;
+        static constexpr uint32_t DEFAULT_BUDGET = 16 * 1024;
+        static constexpr float TARGET_FRAME_TIME = 1.0f / 60.0f;
+        static constexpr float SHRINK_ABOVE = 1.10f;  // of the target frame time
+        static constexpr float GROW_BELOW = 1.02f;    // vsync holds frames at about the target
+        static constexpr float BUDGET_SHRINK = 0.90f; // per frame over
+        static constexpr uint32_t BUDGET_GROW = 256;  // particles per frame under
+        static constexpr float FRAME_TIME_SMOOTHING = 0.1f;
+        static constexpr float LOD_FULL_DETAIL_SIZE = 0.005f; // particle size / distance that spawns every particle
+        static constexpr float LOD_MIN_KEEP = 0.125f;
+        static constexpr float MAX_MERGE_GROWTH = 2.0f; // size factor for survivors of a thinned burst
+        static constexpr uint32_t CULL_BLOCK = 256; // particles whose cull radii are gathered at a time
+        static constexpr std::array<float, static_cast<size_t>(EffectPriority::COUNT)> PRIORITY_SHARE = {
+            0.5f, 0.75f, 0.9f, 1.0f
+        };
+    };
+
+    // Counters for the frame since the last Update
+    struct EngineStats {
+        uint32_t live;
+        uint32_t budget;
+        uint32_t requested;  // particles the effects asked for
+        uint32_t emitted;
+        uint32_t lodThinned; // dropped by distance LOD
+        uint32_t budgetThinned; // dropped because the budget was full
+        uint32_t evicted;    // live particles removed for Critical effects or a shrinking budget
+        float smoothedFrameTime;
+    };
+
+    explicit ParticleEngine(JobSystem* jobs = nullptr, uint64_t seed = 0x9A271C1E,
+                            uint32_t capacity = EngineConfig::MAX_PARTICLES)
+        : m_particles(capacity), m_emitter(seed), m_depthSort(capacity), m_jobs(jobs),
+          m_budget(std::clamp(EngineConfig::DEFAULT_BUDGET, std::min(EngineConfig::MIN_BUDGET, capacity), capacity)),
+          m_visible((capacity + 7) / 8), m_visibleOrder(capacity) {}
+
+    // Camera position for distance LOD
+    void SetViewPosition(const XMFLOAT3& position) { m_viewPosition = position; }
+
+    // Optional bounce off the well and its locked blocks, applied after
+    // every Update. The grid is copied into occupancy masks, so pass it
+    // again whenever blocks lock or layers clear.
+    void SetCollision(bool enabled, const ParticleCollider::CollisionParams& params = {}) {
+        m_collide = enabled;
+        m_collisionParams = params;
+    }
+    void SetCollisionGrid(const GameState::GridType& grid) { m_collider.SetGrid(grid); }
+
+    uint32_t Emit(const ParticleEffectDesc& effect, const XMFLOAT3& origin) {
+        return Emit(effect, std::span<const XMFLOAT3>(&origin, 1));
+    }
+
+    // Spawns the effect at each origin, thinned by LOD and the budget;
+    // returns how many particles were created
+    uint32_t Emit(const ParticleEffectDesc& effect, std::span<const XMFLOAT3> origins) {
+        const uint32_t requested = static_cast<uint32_t>(origins.size()) * effect.emitter.burst;
+        if (requested == 0) return 0;
+        m_stats.requested += requested;
+
+        // LOD never thins a burst away completely
+        const uint32_t afterLod = std::max(1u, static_cast<uint32_t>(requested * LodKeep(effect.emitter, origins)));
+        m_stats.lodThinned += requested - afterLod;
+
+        const float share = EngineConfig::PRIORITY_SHARE[static_cast<size_t>(effect.priority)];
+        const uint32_t limit = static_cast<uint32_t>(m_budget * share);
+        uint32_t live = m_particles.Count();
+        if (effect.priority == EffectPriority::Critical && live + afterLod > limit) {
+            const uint32_t keep = limit > afterLod ? limit - afterLod : 0;
+            if (live > keep) {
+                m_stats.evicted += live - keep;
+                m_particles.Truncate(keep);
+                m_sorted = false;
+                live = keep;
+            }
+        }
+        const uint32_t room = limit > live ? limit - live : 0;
+        const uint32_t count = std::min(afterLod, room);
+        m_stats.budgetThinned += afterLod - count;
+        if (count == 0) return 0;
+
+        // Survivors grow so a thinned burst still covers about the same area
+        EmitterDesc desc = effect.emitter;
+        if (count < requested) {
+            const float growth = std::min(std::sqrt(static_cast<float>(requested) / count),
+                                          EngineConfig::MAX_MERGE_GROWTH);
+            desc.sizeMin *= growth;
+            desc.sizeMax *= growth;
+        }
+
+        const uint32_t emitted = m_emitter.Emit(m_particles, desc, origins, count);
+        m_sorted = false;
+        m_stats.emitted += emitted;
+        return emitted;
+    }
+
+    // `deltaTime` is the measured length of the last frame and drives the
+    // budget as well as the simulation
+    void Update(float deltaTime, const ParticleStorage::UpdateParams& params) {
+        AdaptBudget(deltaTime);
+
+        if (m_jobs) {
+            m_particles.Update(deltaTime, params, *m_jobs);
+        } else {
+            m_particles.Update(deltaTime, params);
+        }
+        if (m_collide) m_collider.Collide(m_particles, m_collisionParams, m_jobs);
+
+        m_sorted = false;
+        m_stats.live = m_particles.Count();
+        m_stats.budget = m_budget;
+        m_lastStats = m_stats;
+        m_stats = {};
+    }
+
+    void Update(float deltaTime) { Update(deltaTime, ParticleStorage::UpdateParams{}); }
+
+    // Orders the live particles back to front along the view direction;
+    // the next WriteInstances follows that order until particles change
+    void SortByDepth(const XMFLOAT3& eye, const XMFLOAT3& forward) {
+        m_depthSort.Sort(m_particles, eye, forward, m_jobs);
+        m_sorted = true;
+    }
+
+    uint32_t WriteInstances(std::span<ParticleInstance> out) const {
+        if (m_sorted) return m_particles.WriteInstances(out, m_depthSort.GetOrder(), m_jobs);
+        return m_particles.WriteInstances(out, m_jobs);
+    }
+
+    // Same, leaving out particles outside `frustum`. Each is tested as a
+    // sphere of radius max(Size, SizeEnd), which covers its quad at any
+    // rotation and any point of its size ramp.
+    uint32_t WriteInstances(std::span<ParticleInstance> out, const FrustumCuller& frustum) {
+        const uint32_t count = m_particles.Count();
+        const float* x = m_particles.GetColumn(ParticleStorage::PositionX).data();
+        const float* y = m_particles.GetColumn(ParticleStorage::PositionY).data();
+        const float* z = m_particles.GetColumn(ParticleStorage::PositionZ).data();
+        const float* size = m_particles.GetColumn(ParticleStorage::Size).data();
+        const float* sizeEnd = m_particles.GetColumn(ParticleStorage::SizeEnd).data();
+        auto cull = [&](uint32_t, uint32_t begin, uint32_t end) {
+            alignas(32) float radius[EngineConfig::CULL_BLOCK];
+            for (uint32_t first = begin; first < end; first += EngineConfig::CULL_BLOCK) {
+                const uint32_t n = std::min(EngineConfig::CULL_BLOCK, end - first);
+                // Whole lanes, as CullSpheres reads them; columns are padded to match
+                for (uint32_t i = 0; i < ((n + 7) & ~7u); ++i) radius[i] = std::max(size[first + i], sizeEnd[first + i]);
+                frustum.CullSpheres(x + first, y + first, z + first, radius, n, m_visible.data() + first / 8);
+            }
+        };
+        if (m_jobs) {
+            m_jobs->ParallelFor(count, ParticleStorage::StorageConfig::PARALLEL_CHUNK, cull);
+        } else {
+            cull(0, 0, count);
+        }
+
+        // The survivors, in depth order if there is one
+        uint32_t visible = 0;
+        if (m_sorted) {
+            for (const uint32_t p : m_depthSort.GetOrder()) {
+                if (FrustumCuller::IsVisible(m_visible.data(), p)) m_visibleOrder[visible++] = p;
+            }
+        } else {
+            for (uint32_t group = 0; group < count; group += 8) {
+                for (uint32_t bits = m_visible[group / 8]; bits != 0; bits &= bits - 1) {
+                    m_visibleOrder[visible++] = group + static_cast<uint32_t>(std::countr_zero(bits));
+                }
+            }
+        }
+        m_cullStats = {count, visible};
+        return m_particles.WriteInstances(out, std::span<const uint32_t>(m_visibleOrder.data(), visible), m_jobs);
+    }
+
+    void Clear() {
+        m_particles.Clear();
+        m_sorted = false;
+    }
+
+    const ParticleStorage& GetParticles() const { return m_particles; }
+    uint32_t GetBudget() const { return m_budget; }
+    uint32_t GetCapacity() const { return m_particles.Capacity(); }
+    const EngineStats& GetStats() const { return m_lastStats; }
+    const FrustumCuller::CullStats& GetCullStats() const { return m_cullStats; } // from the last culled WriteInstances
+
+private:
+    ParticleStorage m_particles;
+    ParticleEmitter m_emitter;
+    ParticleDepthSort m_depthSort;
+    ParticleCollider m_collider;
+    ParticleCollider::CollisionParams m_collisionParams;
+    bool m_collide = false;
+    JobSystem* m_jobs;
+    bool m_sorted = false; // m_depthSort matches the live particles
+    uint32_t m_budget;
+    float m_smoothedFrameTime = EngineConfig::TARGET_FRAME_TIME;
+    XMFLOAT3 m_viewPosition = {0.0f, 0.0f, 0.0f};
+    EngineStats m_stats = {};
+    EngineStats m_lastStats = {};
+    std::vector<uint8_t> m_visible;       // a bit per particle from the last culled WriteInstances
+    std::vector<uint32_t> m_visibleOrder; // indices of the particles it kept
+    FrustumCuller::CullStats m_cullStats = {};
+
+    void AdaptBudget(float deltaTime) {
+        m_smoothedFrameTime += (deltaTime - m_smoothedFrameTime) * EngineConfig::FRAME_TIME_SMOOTHING;
+        m_stats.smoothedFrameTime = m_smoothedFrameTime;
+
+        const uint32_t ceiling = m_particles.Capacity();
+        const uint32_t floor = std::min(EngineConfig::MIN_BUDGET, ceiling);
+        if (m_smoothedFrameTime > EngineConfig::TARGET_FRAME_TIME * EngineConfig::SHRINK_ABOVE) {
+            m_budget = std::max(static_cast<uint32_t>(m_budget * EngineConfig::BUDGET_SHRINK), floor);
+        } else if (m_smoothedFrameTime < EngineConfig::TARGET_FRAME_TIME * EngineConfig::GROW_BELOW) {
+            m_budget = std::min(m_budget + EngineConfig::BUDGET_GROW, ceiling);
+        }
+
+        // A smaller budget applies to particles already alive too
+        if (m_particles.Count() > m_budget) {
+            m_stats.evicted += m_particles.Count() - m_budget;
+            m_particles.Truncate(m_budget);
+        }
+    }
+
+    // Fraction of a burst worth spawning: size over distance from the
+    // camera to the nearest origin, relative to the full-detail size
+    float LodKeep(const EmitterDesc& desc, std::span<const XMFLOAT3> origins) const {
+        float nearest = std::numeric_limits<float>::max();
+        for (const XMFLOAT3& origin : origins) {
+            const float dx = origin.x - m_viewPosition.x;
+            const float dy = origin.y - m_viewPosition.y;
+            const float dz = origin.z - m_viewPosition.z;
+            nearest = std::min(nearest, dx * dx + dy * dy + dz * dz);
+        }
+        const float size = 0.5f * (desc.sizeMin + desc.sizeMax);
+        const float projected = size / std::max(std::sqrt(nearest), 1e-3f);
+        return std::clamp(projected / EngineConfig::LOD_FULL_DETAIL_SIZE, EngineConfig::LOD_MIN_KEEP, 1.0f);
+    }
+};
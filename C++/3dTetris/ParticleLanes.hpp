@@ -0,0 +1,180 @@
+#pragma once
+#include "ParticleStorage.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+// Eight floats or eight 32-bit integers processed together: one AVX
+// register, two SSE registers or a plain array, following
+// TETRIS_PARTICLE_SIMD. Just the operations the particle kernels need;
+// comparisons return masks as F8 with every bit of a true lane set.
+namespace ParticleLanes {
+#if TETRIS_PARTICLE_SIMD >= 2
+    struct F8 { __m256 v; };
+    struct U8 { __m256i v; };
+
+    inline F8 Splat(float f) { return {_mm256_set1_ps(f)}; }
+    inline F8 Load(const float* p) { return {_mm256_load_ps(p)}; }
+    inline void Store(float* p, F8 a) { _mm256_store_ps(p, a.v); }
+    inline F8 operator+(F8 a, F8 b) { return {_mm256_add_ps(a.v, b.v)}; }
+    inline F8 operator*(F8 a, F8 b) { return {_mm256_mul_ps(a.v, b.v)}; }
+    inline F8 operator/(F8 a, F8 b) { return {_mm256_div_ps(a.v, b.v)}; }
+    inline F8 Sqrt(F8 a) { return {_mm256_sqrt_ps(a.v)}; }
+    inline F8 operator-(F8 a, F8 b) { return {_mm256_sub_ps(a.v, b.v)}; }
+    inline F8 Min(F8 a, F8 b) { return {_mm256_min_ps(a.v, b.v)}; }
+    inline F8 Max(F8 a, F8 b) { return {_mm256_max_ps(a.v, b.v)}; }
+    inline F8 Abs(F8 a) { return {_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)}; }
+    inline F8 Less(F8 a, F8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)}; }
+    inline F8 operator&(F8 a, F8 b) { return {_mm256_and_ps(a.v, b.v)}; }
+    inline F8 operator|(F8 a, F8 b) { return {_mm256_or_ps(a.v, b.v)}; }
+    inline F8 Select(F8 mask, F8 a, F8 b) { return {_mm256_blendv_ps(b.v, a.v, mask.v)}; }
+    inline uint32_t MoveMask(F8 mask) { return static_cast<uint32_t>(_mm256_movemask_ps(mask.v)); }
+    inline U8 Truncate(F8 a) { return {_mm256_cvttps_epi32(a.v)}; }
+    inline F8 ToFloat(U8 a) { return {_mm256_cvtepi32_ps(a.v)}; }
+    inline U8 SplatBits(uint32_t u) { return {_mm256_set1_epi32(static_cast<int>(u))}; }
+    inline U8 operator&(U8 a, U8 b) { return {_mm256_and_si256(a.v, b.v)}; }
+    inline F8 NonZero(U8 a) {
+        const __m256i zero = _mm256_cmpeq_epi32(a.v, _mm256_setzero_si256());
+        return {_mm256_castsi256_ps(_mm256_xor_si256(zero, _mm256_set1_epi32(-1)))};
+    }
+
+    inline U8 Load(const uint32_t* p) { return {_mm256_load_si256(reinterpret_cast<const __m256i*>(p))}; }
+    inline void Store(uint32_t* p, U8 a) { _mm256_store_si256(reinterpret_cast<__m256i*>(p), a.v); }
+    inline U8 operator^(U8 a, U8 b) { return {_mm256_xor_si256(a.v, b.v)}; }
+    template<int N> U8 ShiftLeft(U8 a) { return {_mm256_slli_epi32(a.v, N)}; }
+    template<int N> U8 ShiftRight(U8 a) { return {_mm256_srli_epi32(a.v, N)}; }
+
+    // The top 23 bits become the mantissa of a float in [1, 2)
+    inline F8 UnitFromBits(U8 bits) {
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256i mantissa = _mm256_srli_epi32(bits.v, 9);
+        return {_mm256_sub_ps(_mm256_castsi256_ps(_mm256_or_si256(mantissa, _mm256_castps_si256(one))), one)};
+    }
+#elif TETRIS_PARTICLE_SIMD >= 1
+    struct F8 { __m128 lo, hi; };
+    struct U8 { __m128i lo, hi; };
+
+    inline F8 Splat(float f) { return {_mm_set1_ps(f), _mm_set1_ps(f)}; }
+    inline F8 Load(const float* p) { return {_mm_load_ps(p), _mm_load_ps(p + 4)}; }
+    inline void Store(float* p, F8 a) { _mm_store_ps(p, a.lo); _mm_store_ps(p + 4, a.hi); }
+    inline F8 operator+(F8 a, F8 b) { return {_mm_add_ps(a.lo, b.lo), _mm_add_ps(a.hi, b.hi)}; }
+    inline F8 operator*(F8 a, F8 b) { return {_mm_mul_ps(a.lo, b.lo), _mm_mul_ps(a.hi, b.hi)}; }
+    inline F8 operator/(F8 a, F8 b) { return {_mm_div_ps(a.lo, b.lo), _mm_div_ps(a.hi, b.hi)}; }
+    inline F8 Sqrt(F8 a) { return {_mm_sqrt_ps(a.lo), _mm_sqrt_ps(a.hi)}; }
+    inline F8 operator-(F8 a, F8 b) { return {_mm_sub_ps(a.lo, b.lo), _mm_sub_ps(a.hi, b.hi)}; }
+    inline F8 Min(F8 a, F8 b) { return {_mm_min_ps(a.lo, b.lo), _mm_min_ps(a.hi, b.hi)}; }
+    inline F8 Max(F8 a, F8 b) { return {_mm_max_ps(a.lo, b.lo), _mm_max_ps(a.hi, b.hi)}; }
+    inline F8 Abs(F8 a) {
+        const __m128 sign = _mm_set1_ps(-0.0f);
+        return {_mm_andnot_ps(sign, a.lo), _mm_andnot_ps(sign, a.hi)};
+    }
+    inline F8 Less(F8 a, F8 b) { return {_mm_cmplt_ps(a.lo, b.lo), _mm_cmplt_ps(a.hi, b.hi)}; }
+    inline F8 operator&(F8 a, F8 b) { return {_mm_and_ps(a.lo, b.lo), _mm_and_ps(a.hi, b.hi)}; }
+    inline F8 operator|(F8 a, F8 b) { return {_mm_or_ps(a.lo, b.lo), _mm_or_ps(a.hi, b.hi)}; }
+    inline F8 Select(F8 mask, F8 a, F8 b) {
+        return {_mm_or_ps(_mm_and_ps(mask.lo, a.lo), _mm_andnot_ps(mask.lo, b.lo)),
+                _mm_or_ps(_mm_and_ps(mask.hi, a.hi), _mm_andnot_ps(mask.hi, b.hi))};
+    }
+    inline uint32_t MoveMask(F8 mask) {
+        return static_cast<uint32_t>(_mm_movemask_ps(mask.lo) | (_mm_movemask_ps(mask.hi) << 4));
+    }
+    inline U8 Truncate(F8 a) { return {_mm_cvttps_epi32(a.lo), _mm_cvttps_epi32(a.hi)}; }
+    inline F8 ToFloat(U8 a) { return {_mm_cvtepi32_ps(a.lo), _mm_cvtepi32_ps(a.hi)}; }
+    inline U8 SplatBits(uint32_t u) { return {_mm_set1_epi32(static_cast<int>(u)), _mm_set1_epi32(static_cast<int>(u))}; }
+    inline U8 operator&(U8 a, U8 b) { return {_mm_and_si128(a.lo, b.lo), _mm_and_si128(a.hi, b.hi)}; }
+    inline F8 NonZero(U8 a) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i ones = _mm_set1_epi32(-1);
+        return {_mm_castsi128_ps(_mm_xor_si128(_mm_cmpeq_epi32(a.lo, zero), ones)),
+                _mm_castsi128_ps(_mm_xor_si128(_mm_cmpeq_epi32(a.hi, zero), ones))};
+    }
+
+    inline U8 Load(const uint32_t* p) {
+        const auto* v = reinterpret_cast<const __m128i*>(p);
+        return {_mm_load_si128(v), _mm_load_si128(v + 1)};
+    }
+    inline void Store(uint32_t* p, U8 a) {
+        auto* v = reinterpret_cast<__m128i*>(p);
+        _mm_store_si128(v, a.lo);
+        _mm_store_si128(v + 1, a.hi);
+    }
+    inline U8 operator^(U8 a, U8 b) { return {_mm_xor_si128(a.lo, b.lo), _mm_xor_si128(a.hi, b.hi)}; }
+    template<int N> U8 ShiftLeft(U8 a) { return {_mm_slli_epi32(a.lo, N), _mm_slli_epi32(a.hi, N)}; }
+    template<int N> U8 ShiftRight(U8 a) { return {_mm_srli_epi32(a.lo, N), _mm_srli_epi32(a.hi, N)}; }
+
+    inline F8 UnitFromBits(U8 bits) {
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128i exponent = _mm_castps_si128(one);
+        return {
+            _mm_sub_ps(_mm_castsi128_ps(_mm_or_si128(_mm_srli_epi32(bits.lo, 9), exponent)), one),
+            _mm_sub_ps(_mm_castsi128_ps(_mm_or_si128(_mm_srli_epi32(bits.hi, 9), exponent)), one)
+        };
+    }
+#else
+    struct F8 { float v[8]; };
+    struct U8 { uint32_t v[8]; };
+
+    template<typename T, typename Op>
+    inline T Map(T a, T b, Op op) {
+        for (int i = 0; i < 8; ++i) a.v[i] = op(a.v[i], b.v[i]);
+        return a;
+    }
+
+    inline F8 Splat(float f) { F8 r; std::fill(r.v, r.v + 8, f); return r; }
+    inline F8 Load(const float* p) { F8 r; std::copy(p, p + 8, r.v); return r; }
+    inline void Store(float* p, F8 a) { std::copy(a.v, a.v + 8, p); }
+    inline F8 operator+(F8 a, F8 b) { return Map(a, b, [](float x, float y) { return x + y; }); }
+    inline F8 operator*(F8 a, F8 b) { return Map(a, b, [](float x, float y) { return x * y; }); }
+    inline F8 operator/(F8 a, F8 b) { return Map(a, b, [](float x, float y) { return x / y; }); }
+    inline F8 Sqrt(F8 a) { for (float& f : a.v) f = std::sqrt(f); return a; }
+    inline F8 operator-(F8 a, F8 b) { return Map(a, b, [](float x, float y) { return x - y; }); }
+    inline F8 Min(F8 a, F8 b) { return Map(a, b, [](float x, float y) { return y < x ? y : x; }); }
+    inline F8 Max(F8 a, F8 b) { return Map(a, b, [](float x, float y) { return y > x ? y : x; }); }
+    inline F8 Abs(F8 a) { for (float& f : a.v) f = std::abs(f); return a; }
+
+    inline float MaskBits(bool b) { return std::bit_cast<float>(b ? ~0u : 0u); }
+    inline bool IsSet(float mask) { return std::bit_cast<uint32_t>(mask) != 0; }
+    inline F8 Less(F8 a, F8 b) { return Map(a, b, [](float x, float y) { return MaskBits(x < y); }); }
+    inline F8 operator&(F8 a, F8 b) { return Map(a, b, [](float x, float y) { return MaskBits(IsSet(x) && IsSet(y)); }); }
+    inline F8 operator|(F8 a, F8 b) { return Map(a, b, [](float x, float y) { return MaskBits(IsSet(x) || IsSet(y)); }); }
+    inline F8 Select(F8 mask, F8 a, F8 b) {
+        for (int i = 0; i < 8; ++i) a.v[i] = IsSet(mask.v[i]) ? a.v[i] : b.v[i];
+        return a;
+    }
+    inline uint32_t MoveMask(F8 mask) {
+        uint32_t bits = 0;
+        for (int i = 0; i < 8; ++i) bits |= uint32_t(IsSet(mask.v[i])) << i;
+        return bits;
+    }
+    inline U8 Truncate(F8 a) {
+        U8 r;
+        for (int i = 0; i < 8; ++i) r.v[i] = static_cast<uint32_t>(static_cast<int32_t>(a.v[i]));
+        return r;
+    }
+    inline F8 ToFloat(U8 a) {
+        F8 r;
+        for (int i = 0; i < 8; ++i) r.v[i] = static_cast<float>(static_cast<int32_t>(a.v[i]));
+        return r;
+    }
+    inline U8 SplatBits(uint32_t u) { U8 r; std::fill(r.v, r.v + 8, u); return r; }
+    inline U8 operator&(U8 a, U8 b) { return Map(a, b, [](uint32_t x, uint32_t y) { return x & y; }); }
+    inline F8 NonZero(U8 a) {
+        F8 r;
+        for (int i = 0; i < 8; ++i) r.v[i] = MaskBits(a.v[i] != 0);
+        return r;
+    }
+
+    inline U8 Load(const uint32_t* p) { U8 r; std::copy(p, p + 8, r.v); return r; }
+    inline void Store(uint32_t* p, U8 a) { std::copy(a.v, a.v + 8, p); }
+    inline U8 operator^(U8 a, U8 b) { return Map(a, b, [](uint32_t x, uint32_t y) { return x ^ y; }); }
+    template<int N> U8 ShiftLeft(U8 a) { for (uint32_t& u : a.v) u <<= N; return a; }
+    template<int N> U8 ShiftRight(U8 a) { for (uint32_t& u : a.v) u >>= N; return a; }
+
+    inline F8 UnitFromBits(U8 bits) {
+        F8 r;
+        for (int i = 0; i < 8; ++i) r.v[i] = std::bit_cast<float>((bits.v[i] >> 9) | 0x3F800000u) - 1.0f;
+        return r;
+    }
+#endif
+}
@@ -0,0 +1,423 @@
+#pragma once
+#include "MathTypes.hpp"
+#include "JobSystem.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+
+// SIMD level for the particle kernels: 0 scalar, 1 SSE, 2 AVX2. Follows the
+// compiler's target flags (/arch:AVX2, -mavx2) unless overridden.
+#ifndef TETRIS_PARTICLE_SIMD
+    #if defined(__AVX2__)
+        #define TETRIS_PARTICLE_SIMD 2
+    #elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #define TETRIS_PARTICLE_SIMD 1
+    #else
+        #define TETRIS_PARTICLE_SIMD 0
+    #endif
+#endif
+
+#if TETRIS_PARTICLE_SIMD >= 2
+    #include <immintrin.h>
+#elif TETRIS_PARTICLE_SIMD >= 1
+    #include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+using namespace DirectX;
+
+// Spawn description of one particle; storage keeps it split into columns.
+// Color and size ramp linearly from their spawn values to the end values
+// over `lifetime`; by default they stay constant.
+struct Particle {
+    XMFLOAT3 position;
+    XMFLOAT3 velocity;
+    XMFLOAT4 color;
+    float life;
+    float size;
+    float rotation;
+    float rotationSpeed;
+    XMFLOAT4 colorEnd = color;
+    float sizeEnd = size;
+    float lifetime = life; // life at spawn
+};
+
+// Per-particle vertex data for the instanced particle draw
+struct ParticleInstance {
+    XMFLOAT3 position;
+    float size;
+    XMFLOAT4 color;
+    float rotation;
+};
+
+// Particles stored as one float array per attribute so the update kernels
+// stream through memory a full SIMD register at a time. Dead particles are
+// removed by moving the last particle into the hole, so order is not kept.
+//
+// Color and size ramps are not integrated: the Color and Size columns hold
+// the spawn values, and WriteInstances evaluates the ramp at the particle's
+// normalised age, 1 - Life / Lifetime.
+class ParticleStorage {
+public:
+    enum Column : uint32_t {
+        PositionX, PositionY, PositionZ,
+        VelocityX, VelocityY, VelocityZ,
+        ColorR, ColorG, ColorB, ColorA,
+        Life,
+        Size,
+        Rotation,
+        RotationSpeed,
+        ColorEndR, ColorEndG, ColorEndB, ColorEndA,
+        SizeEnd,
+        Lifetime,
+        COLUMN_COUNT
+    };
+
+    struct StorageConfig {
+        static constexpr size_t COLUMN_ALIGNMENT = 64; // a cache line, enough for AVX
+        static constexpr size_t PAGE_SIZE = 4096;
+        static constexpr uint32_t LANE_PADDING = 8;    // capacity rounds up to whole AVX registers
+        static constexpr float DEFAULT_GRAVITY = 9.8f;
+        static constexpr uint32_t PARALLEL_CHUNK = 16 * 1024; // particles per job, a multiple of LANE_PADDING
+    };
+
+    struct UpdateParams {
+        float gravity = StorageConfig::DEFAULT_GRAVITY;
+        float fadeRate = 0.0f; // when > 0, alpha = life * fadeRate instead of the alpha ramp
+    };
+
+    explicit ParticleStorage(uint32_t capacity,
+                             std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : m_capacity(capacity), m_upstream(upstream) {
+        m_stride = (capacity + StorageConfig::LANE_PADDING - 1) & ~(StorageConfig::LANE_PADDING - 1);
+        // Columns a whole number of pages apart share cache sets, and the
+        // kernels stream more columns than L1 has ways. Offsetting each
+        // column by one more cache line than the last spreads them out.
+        constexpr uint32_t PAGE_FLOATS = StorageConfig::PAGE_SIZE / sizeof(float);
+        constexpr uint32_t LINE_FLOATS = StorageConfig::COLUMN_ALIGNMENT / sizeof(float);
+        m_stride += (LINE_FLOATS + PAGE_FLOATS - m_stride % PAGE_FLOATS) % PAGE_FLOATS;
+        m_block = static_cast<float*>(m_upstream->allocate(BlockBytes(), StorageConfig::COLUMN_ALIGNMENT));
+        for (uint32_t column = 0; column < COLUMN_COUNT; ++column) {
+            m_columns[column] = m_block + size_t(column) * m_stride;
+        }
+        m_chunkCapacity = (capacity + StorageConfig::PARALLEL_CHUNK - 1) / StorageConfig::PARALLEL_CHUNK;
+        m_chunkEnds = static_cast<uint32_t*>(
+            m_upstream->allocate(sizeof(uint32_t) * m_chunkCapacity, alignof(uint32_t)));
+    }
+
+    ~ParticleStorage() {
+        m_upstream->deallocate(m_chunkEnds, sizeof(uint32_t) * m_chunkCapacity, alignof(uint32_t));
+        m_upstream->deallocate(m_block, BlockBytes(), StorageConfig::COLUMN_ALIGNMENT);
+    }
+
+    ParticleStorage(const ParticleStorage&) = delete;
+    ParticleStorage& operator=(const ParticleStorage&) = delete;
+
+    // Returns false when the storage is full
+    bool Emit(const Particle& p) {
+        if (m_size >= m_capacity) return false;
+
+        const uint32_t i = m_size++;
+        m_columns[PositionX][i] = p.position.x;
+        m_columns[PositionY][i] = p.position.y;
+        m_columns[PositionZ][i] = p.position.z;
+        m_columns[VelocityX][i] = p.velocity.x;
+        m_columns[VelocityY][i] = p.velocity.y;
+        m_columns[VelocityZ][i] = p.velocity.z;
+        m_columns[ColorR][i] = p.color.x;
+        m_columns[ColorG][i] = p.color.y;
+        m_columns[ColorB][i] = p.color.z;
+        m_columns[ColorA][i] = p.color.w;
+        m_columns[Life][i] = p.life;
+        m_columns[Size][i] = p.size;
+        m_columns[Rotation][i] = p.rotation;
+        m_columns[RotationSpeed][i] = p.rotationSpeed;
+        m_columns[ColorEndR][i] = p.colorEnd.x;
+        m_columns[ColorEndG][i] = p.colorEnd.y;
+        m_columns[ColorEndB][i] = p.colorEnd.z;
+        m_columns[ColorEndA][i] = p.colorEnd.w;
+        m_columns[SizeEnd][i] = p.sizeEnd;
+        m_columns[Lifetime][i] = p.lifetime;
+        return true;
+    }
+
+    // Ages every particle, integrates motion with gravity, then compacts
+    // away the ones whose life ran out
+    void Update(float deltaTime, const UpdateParams& params) {
+        const uint32_t firstDead = Integrate(0, m_size, deltaTime, params);
+        if (firstDead < m_size) m_size = Compact(firstDead, m_size);
+    }
+
+    void Update(float deltaTime) { Update(deltaTime, UpdateParams{}); }
+
+    // Same result as Update, spread over the job system in PARALLEL_CHUNK
+    // slices. Each slice integrates and compacts itself; the holes left at
+    // the slice tails are then filled from the end of the array.
+    void Update(float deltaTime, const UpdateParams& params, JobSystem& jobs) {
+        const uint32_t count = m_size;
+        if (count <= StorageConfig::PARALLEL_CHUNK) {
+            Update(deltaTime, params);
+            return;
+        }
+
+        jobs.ParallelFor(count, StorageConfig::PARALLEL_CHUNK, [&](uint32_t chunk, uint32_t begin, uint32_t end) {
+            const uint32_t firstDead = Integrate(begin, end, deltaTime, params);
+            m_chunkEnds[chunk] = firstDead < end ? Compact(firstDead, end) : end;
+        });
+        m_size = FillChunkGaps(count);
+    }
+
+    // Packs live particles into `out` (e.g. a mapped instance buffer) and
+    // returns how many were written
+    uint32_t WriteInstances(std::span<ParticleInstance> out, JobSystem* jobs = nullptr) const {
+        const uint32_t count = std::min(m_size, static_cast<uint32_t>(out.size()));
+        auto write = [&](uint32_t, uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i) out[i] = MakeInstance(i);
+        };
+        if (jobs) {
+            jobs->ParallelFor(count, StorageConfig::PARALLEL_CHUNK, write);
+        } else {
+            write(0, 0, count);
+        }
+        return count;
+    }
+
+    // Same, in the given order of particle indices (e.g. a depth sort)
+    uint32_t WriteInstances(std::span<ParticleInstance> out, std::span<const uint32_t> order,
+                            JobSystem* jobs = nullptr) const {
+        const uint32_t count = static_cast<uint32_t>(std::min(order.size(), out.size()));
+        auto write = [&](uint32_t, uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i) out[i] = MakeInstance(order[i]);
+        };
+        if (jobs) {
+            jobs->ParallelFor(count, StorageConfig::PARALLEL_CHUNK, write);
+        } else {
+            write(0, 0, count);
+        }
+        return count;
+    }
+
+    // Grows the live range by up to `count` particles without initializing
+    // them, for batched emitters that write the columns directly. Returns
+    // how many fit; they start at the previous Count().
+    uint32_t Append(uint32_t count) {
+        count = std::min(count, m_capacity - m_size);
+        m_size += count;
+        return count;
+    }
+
+    // Drops particles past `count`; the most recently emitted go first
+    // unless compaction has moved them
+    void Truncate(uint32_t count) { m_size = std::min(m_size, count); }
+
+    void Clear() { m_size = 0; }
+
+    // Gathers one particle back into AoS form (tools and tests, not hot paths)
+    Particle Get(uint32_t i) const {
+        return {
+            {m_columns[PositionX][i], m_columns[PositionY][i], m_columns[PositionZ][i]},
+            {m_columns[VelocityX][i], m_columns[VelocityY][i], m_columns[VelocityZ][i]},
+            {m_columns[ColorR][i], m_columns[ColorG][i], m_columns[ColorB][i], m_columns[ColorA][i]},
+            m_columns[Life][i],
+            m_columns[Size][i],
+            m_columns[Rotation][i],
+            m_columns[RotationSpeed][i],
+            {m_columns[ColorEndR][i], m_columns[ColorEndG][i], m_columns[ColorEndB][i], m_columns[ColorEndA][i]},
+            m_columns[SizeEnd][i],
+            m_columns[Lifetime][i]
+        };
+    }
+
+    std::span<const float> GetColumn(Column column) const { return {m_columns[column], m_size}; }
+    float* GetMutableColumn(Column column) { return m_columns[column]; }
+
+    uint32_t Count() const { return m_size; }
+    uint32_t Capacity() const { return m_capacity; }
+    bool Empty() const { return m_size == 0; }
+    bool Full() const { return m_size >= m_capacity; }
+
+private:
+    uint32_t m_capacity;
+    uint32_t m_stride = 0; // floats per column: padded, and a cache line past a whole number of pages
+    uint32_t m_size = 0;
+    std::pmr::memory_resource* m_upstream;
+    float* m_block = nullptr;
+    std::array<float*, COLUMN_COUNT> m_columns = {};
+    uint32_t* m_chunkEnds = nullptr; // live end of each slice during a parallel update
+    uint32_t m_chunkCapacity = 0;
+
+    size_t BlockBytes() const { return sizeof(float) * COLUMN_COUNT * m_stride; }
+
+    // Particle `p` as drawn now, its color and size taken along their ramps
+    ParticleInstance MakeInstance(uint32_t p) const {
+        const float lifetime = m_columns[Lifetime][p];
+        const float age = lifetime > 0.0f ? 1.0f - m_columns[Life][p] / lifetime : 1.0f;
+        auto ramp = [&](Column start, Column finish) {
+            return m_columns[start][p] + (m_columns[finish][p] - m_columns[start][p]) * age;
+        };
+        return {
+            {m_columns[PositionX][p], m_columns[PositionY][p], m_columns[PositionZ][p]},
+            ramp(Size, SizeEnd),
+            {ramp(ColorR, ColorEndR), ramp(ColorG, ColorEndG), ramp(ColorB, ColorEndB), ramp(ColorA, ColorEndA)},
+            m_columns[Rotation][p]
+        };
+    }
+
+    static uint32_t LowestBit(uint32_t mask) {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return index;
+#else
+        return static_cast<uint32_t>(__builtin_ctz(mask));
+#endif
+    }
+
+    // Integrates [begin, end); `begin` must be a multiple of LANE_PADDING.
+    // Returns the index of the first particle that died, or `end`.
+    uint32_t Integrate(uint32_t begin, uint32_t end, float deltaTime, const UpdateParams& params) {
+        float* px = m_columns[PositionX];
+        float* py = m_columns[PositionY];
+        float* pz = m_columns[PositionZ];
+        const float* vx = m_columns[VelocityX];
+        float* vy = m_columns[VelocityY];
+        const float* vz = m_columns[VelocityZ];
+        float* alpha = m_columns[ColorA];
+        float* alphaEnd = m_columns[ColorEndA];
+        float* life = m_columns[Life];
+        float* rotation = m_columns[Rotation];
+        const float* rotationSpeed = m_columns[RotationSpeed];
+
+        const float gravityStep = params.gravity * deltaTime;
+        const bool fade = params.fadeRate > 0.0f;
+        uint32_t firstDead = end;
+        uint32_t i = begin;
+
+#if TETRIS_PARTICLE_SIMD >= 2
+        const __m256 dt = _mm256_set1_ps(deltaTime);
+        const __m256 gravity = _mm256_set1_ps(gravityStep);
+        const __m256 fadeRate = _mm256_set1_ps(params.fadeRate);
+        const __m256 zero = _mm256_setzero_ps();
+        for (; i + 8 <= end; i += 8) {
+            const __m256 l = _mm256_sub_ps(_mm256_load_ps(life + i), dt);
+            _mm256_store_ps(life + i, l);
+
+            const __m256 y = _mm256_load_ps(vy + i);
+            _mm256_store_ps(px + i, _mm256_add_ps(_mm256_load_ps(px + i), _mm256_mul_ps(_mm256_load_ps(vx + i), dt)));
+            _mm256_store_ps(py + i, _mm256_add_ps(_mm256_load_ps(py + i), _mm256_mul_ps(y, dt)));
+            _mm256_store_ps(pz + i, _mm256_add_ps(_mm256_load_ps(pz + i), _mm256_mul_ps(_mm256_load_ps(vz + i), dt)));
+            _mm256_store_ps(vy + i, _mm256_sub_ps(y, gravity));
+            _mm256_store_ps(rotation + i, _mm256_add_ps(_mm256_load_ps(rotation + i),
+                                                        _mm256_mul_ps(_mm256_load_ps(rotationSpeed + i), dt)));
+            if (fade) {
+                const __m256 a = _mm256_mul_ps(l, fadeRate);
+                _mm256_store_ps(alpha + i, a);
+                _mm256_store_ps(alphaEnd + i, a);
+            }
+
+            const uint32_t dead = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(l, zero, _CMP_LE_OQ)));
+            if (dead && firstDead == end) firstDead = i + LowestBit(dead);
+        }
+#elif TETRIS_PARTICLE_SIMD >= 1
+        const __m128 dt = _mm_set1_ps(deltaTime);
+        const __m128 gravity = _mm_set1_ps(gravityStep);
+        const __m128 fadeRate = _mm_set1_ps(params.fadeRate);
+        const __m128 zero = _mm_setzero_ps();
+        for (; i + 4 <= end; i += 4) {
+            const __m128 l = _mm_sub_ps(_mm_load_ps(life + i), dt);
+            _mm_store_ps(life + i, l);
+
+            const __m128 y = _mm_load_ps(vy + i);
+            _mm_store_ps(px + i, _mm_add_ps(_mm_load_ps(px + i), _mm_mul_ps(_mm_load_ps(vx + i), dt)));
+            _mm_store_ps(py + i, _mm_add_ps(_mm_load_ps(py + i), _mm_mul_ps(y, dt)));
+            _mm_store_ps(pz + i, _mm_add_ps(_mm_load_ps(pz + i), _mm_mul_ps(_mm_load_ps(vz + i), dt)));
+            _mm_store_ps(vy + i, _mm_sub_ps(y, gravity));
+            _mm_store_ps(rotation + i, _mm_add_ps(_mm_load_ps(rotation + i),
+                                                  _mm_mul_ps(_mm_load_ps(rotationSpeed + i), dt)));
+            if (fade) {
+                const __m128 a = _mm_mul_ps(l, fadeRate);
+                _mm_store_ps(alpha + i, a);
+                _mm_store_ps(alphaEnd + i, a);
+            }
+
+            const uint32_t dead = static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(l, zero)));
+            if (dead && firstDead == end) firstDead = i + LowestBit(dead);
+        }
+#endif
+
+        // Scalar fallback and the tail the vector loop left over
+        for (; i < end; ++i) {
+            life[i] -= deltaTime;
+            px[i] += vx[i] * deltaTime;
+            py[i] += vy[i] * deltaTime;
+            pz[i] += vz[i] * deltaTime;
+            vy[i] -= gravityStep;
+            rotation[i] += rotationSpeed[i] * deltaTime;
+            if (fade) alpha[i] = alphaEnd[i] = life[i] * params.fadeRate;
+            if (life[i] <= 0.0f && firstDead == end) firstDead = i;
+        }
+        return firstDead;
+    }
+
+    // Swap-and-pop within [first, end): each dead particle is replaced by
+    // the last one, which is re-checked since it may have died this frame
+    // too. Returns the new end of the live range.
+    uint32_t Compact(uint32_t first, uint32_t end) {
+        const float* life = m_columns[Life];
+        uint32_t i = first;
+        while (i < end) {
+            if (life[i] > 0.0f) {
+                ++i;
+                continue;
+            }
+
+            const uint32_t last = --end;
+            if (i == last) break;
+            Move(last, i);
+        }
+        return end;
+    }
+
+    void Move(uint32_t from, uint32_t to) {
+        for (float* column : m_columns) {
+            column[to] = column[from];
+        }
+    }
+
+    // After a parallel update every slice is live up to m_chunkEnds. Moves
+    // the live particles above the new size, last first, into the holes
+    // below it; only as many particles move as died.
+    uint32_t FillChunkGaps(uint32_t count) {
+        constexpr uint32_t CHUNK = StorageConfig::PARALLEL_CHUNK;
+        const uint32_t chunkCount = (count + CHUNK - 1) / CHUNK;
+        auto chunkEnd = [&](uint32_t chunk) { return std::min((chunk + 1) * CHUNK, count); };
+
+        uint32_t live = 0;
+        for (uint32_t chunk = 0; chunk < chunkCount; ++chunk) {
+            live += m_chunkEnds[chunk] - chunk * CHUNK;
+        }
+
+        uint32_t holeChunk = 0;
+        uint32_t hole = m_chunkEnds[0];
+        uint32_t sourceChunk = chunkCount - 1;
+        uint32_t source = m_chunkEnds[sourceChunk]; // one past the next particle to move
+        for (;;) {
+            while (hole >= chunkEnd(holeChunk)) {
+                if (++holeChunk >= chunkCount) return live;
+                hole = m_chunkEnds[holeChunk];
+            }
+            if (hole >= live) return live;
+
+            while (source == sourceChunk * CHUNK) {
+                source = m_chunkEnds[--sourceChunk];
+            }
+            Move(--source, hole++);
+        }
+    }
+};
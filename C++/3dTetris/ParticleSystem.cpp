@@ -1,162 +1,82 @@
 #include "ParticleSystem.h"
-#include <random>
-
-ParticleSystem::ParticleSystem() : m_vertexBuffer(nullptr), m_instanceBuffer(nullptr),
-    m_vertexShader(nullptr), m_pixelShader(nullptr), m_geometryShader(nullptr),
-    m_inputLayout(nullptr), m_blendState(nullptr), m_depthState(nullptr),
-    m_random(std::random_device{}()) {}
+#include "ProfilerSystem.h"
 
 ParticleSystem::~ParticleSystem() {
-    if (m_vertexBuffer) m_vertexBuffer->Release();
-    if (m_instanceBuffer) m_instanceBuffer->Release();
-    if (m_vertexShader) m_vertexShader->Release();
-    if (m_pixelShader) m_pixelShader->Release();
-    if (m_geometryShader) m_geometryShader->Release();
-    if (m_inputLayout) m_inputLayout->Release();
-    if (m_blendState) m_blendState->Release();
-    if (m_depthState) m_depthState->Release();
+    if (!m_backend) return;
+    m_backend->DestroyBuffer(m_instanceBuffer);
+    m_backend->DestroyBuffer(m_cameraBuffer);
+    m_backend->DestroyPipeline(m_pipeline);
 }
 
-bool ParticleSystem::Initialize(ID3D11Device* device) {
-    // Create blend state for alpha blending
-    D3D11_BLEND_DESC blendDesc = {};
-    blendDesc.AlphaToCoverageEnable = false;
-    blendDesc.IndependentBlendEnable = false;
-    blendDesc.RenderTarget[0].BlendEnable = true;
-    blendDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
-    blendDesc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
-    blendDesc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
-    blendDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
-    blendDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ZERO;
-    blendDesc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
-    blendDesc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+bool ParticleSystem::Initialize(RenderBackend& backend, ParticleEngine& engine, uint32_t shader) {
+    m_backend = &backend;
+    m_engine = &engine;
 
-    HRESULT hr = device->CreateBlendState(&blendDesc, &m_blendState);
-    if (FAILED(hr)) return false;
+    // Alpha blended points expanded by the geometry shader; depth is tested
+    // but not written so particles don't hide each other
+    PipelineDesc pipelineDesc;
+    pipelineDesc.shader = shader;
+    pipelineDesc.blend = BlendMode::Alpha;
+    pipelineDesc.depth = DepthMode::TestOnly;
+    pipelineDesc.topology = Topology::PointList;
+    m_pipeline = backend.CreatePipeline(pipelineDesc);
 
-    // Create depth stencil state
-    D3D11_DEPTH_STENCIL_DESC depthDesc = {};
-    depthDesc.DepthEnable = true;
-    depthDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO; // Don't write to depth buffer
-    depthDesc.DepthFunc = D3D11_COMPARISON_LESS;
+    // One instance per particle the engine can hold
+    BufferDesc instanceDesc;
+    instanceDesc.kind = BufferKind::Vertex;
+    instanceDesc.usage = BufferUsage::Dynamic;
+    instanceDesc.stride = sizeof(ParticleInstance);
+    instanceDesc.byteWidth = static_cast<uint32_t>(sizeof(ParticleInstance) * engine.GetCapacity());
+    m_instanceBuffer = backend.CreateBuffer(instanceDesc);
+    if (m_instanceBuffer == BufferHandle::Invalid) return false;
 
-    hr = device->CreateDepthStencilState(&depthDesc, &m_depthState);
-    if (FAILED(hr)) return false;
+    BufferDesc cameraDesc;
+    cameraDesc.kind = BufferKind::Constant;
+    cameraDesc.usage = BufferUsage::Default;
+    cameraDesc.byteWidth = sizeof(CameraConstants);
+    m_cameraBuffer = backend.CreateBuffer(cameraDesc);
+    if (m_cameraBuffer == BufferHandle::Invalid) return false;
 
-    // Initialize particle buffer
-    m_particles.reserve(MAX_PARTICLES);
-    
-    return true;
+    return m_pipeline != PipelineHandle::Invalid;
 }
 
-void ParticleSystem::Update(float deltaTime) {
-    // Update existing particles
-    for (auto it = m_particles.begin(); it != m_particles.end();) {
-        it->life -= deltaTime;
-        if (it->life <= 0.0f) {
-            it = m_particles.erase(it);
-        } else {
-            // Update position based on velocity
-            it->position.x += it->velocity.x * deltaTime;
-            it->position.y += it->velocity.y * deltaTime;
-            it->position.z += it->velocity.z * deltaTime;
-            
-            // Add gravity effect
-            it->velocity.y -= 9.8f * deltaTime;
-            
-            // Update color alpha based on life
-            it->color.w = it->life / PARTICLE_LIFETIME;
-            
-            ++it;
-        }
-    }
-}
+void ParticleSystem::Render(const XMMATRIX& view, const XMMATRIX& projection, const FrustumCuller& frustum) {
+    PROFILE_SCOPE("Particles.Render");
+    if (!m_backend) return;
 
-XMFLOAT3 ParticleSystem::RandomVelocity(float speed) {
-    std::uniform_real_distribution<float> angleDist(0.0f, XM_2PI);
-    std::uniform_real_distribution<float> elevationDist(-XM_PIDIV2, XM_PIDIV2);
-    
-    float angle = angleDist(m_random);
-    float elevation = elevationDist(m_random);
-    
-    return XMFLOAT3(
-        speed * cos(elevation) * cos(angle),
-        speed * sin(elevation),
-        speed * cos(elevation) * sin(angle)
-    );
-}
+    const uint32_t count = UpdateParticleBuffer(view, frustum);
+    if (count == 0) return;
 
-void ParticleSystem::EmitLineClear(int y) {
-    std::uniform_real_distribution<float> colorDist(0.5f, 1.0f);
-    std::uniform_real_distribution<float> speedDist(2.0f, 5.0f);
-    
-    for (int x = 0; x < GameState::GRID_WIDTH; x++) {
-        for (int z = 0; z < GameState::GRID_DEPTH; z++) {
-            if (m_particles.size() >= MAX_PARTICLES) return;
-            
-            Particle p;
-            p.position = XMFLOAT3(
-                x - GameState::GRID_WIDTH/2.0f,
-                y,
-                z - GameState::GRID_DEPTH/2.0f
-            );
-            p.velocity = RandomVelocity(speedDist(m_random));
-            p.color = XMFLOAT4(
-                colorDist(m_random),
-                colorDist(m_random),
-                colorDist(m_random),
-                1.0f
-            );
-            p.life = PARTICLE_LIFETIME;
-            p.size = 0.1f;
-            
-            m_particles.push_back(p);
-        }
-    }
-}
+    CameraConstants camera;
+    XMStoreFloat4x4(&camera.view, XMMatrixTranspose(view));
+    XMStoreFloat4x4(&camera.projection, XMMatrixTranspose(projection));
+    m_backend->UpdateBufferFrom(m_cameraBuffer, camera);
 
-void ParticleSystem::EmitPieceLock(const XMFLOAT3& position) {
-    std::uniform_real_distribution<float> speedDist(1.0f, 3.0f);
-    std::uniform_real_distribution<float> colorDist(0.7f, 1.0f);
-    
-    for (int i = 0; i < 20; i++) {
-        if (m_particles.size() >= MAX_PARTICLES) return;
-        
-        Particle p;
-        p.position = position;
-        p.velocity = RandomVelocity(speedDist(m_random));
-        p.color = XMFLOAT4(
-            colorDist(m_random),
-            colorDist(m_random),
-            1.0f,  // More blue for lock effect
-            1.0f
-        );
-        p.life = PARTICLE_LIFETIME * 0.5f;
-        p.size = 0.05f;
-        
-        m_particles.push_back(p);
-    }
+    m_backend->SetPipeline(m_pipeline);
+    m_backend->SetConstantBuffer(0, m_cameraBuffer);
+    m_backend->SetVertexBuffer(0, m_instanceBuffer, sizeof(ParticleInstance));
+    m_backend->Draw(count);
 }
 
-void ParticleSystem::EmitGameOver() {
-    std::uniform_real_distribution<float> speedDist(3.0f, 8.0f);
-    std::uniform_real_distribution<float> colorDist(0.8f, 1.0f);
-    
-    for (int i = 0; i < 200; i++) {
-        if (m_particles.size() >= MAX_PARTICLES) return;
-        
-        Particle p;
-        p.position = XMFLOAT3(0.0f, GameState::GRID_HEIGHT/2.0f, 0.0f);
-        p.velocity = RandomVelocity(speedDist(m_random));
-        p.color = XMFLOAT4(
-            1.0f,  // Red for game over
-            colorDist(m_random) * 0.3f,
-            colorDist(m_random) * 0.3f,
-            1.0f
-        );
-        p.life = PARTICLE_LIFETIME * 2.0f;
-        p.size = 0.15f;
-        
-        m_particles.push_back(p);
+uint32_t ParticleSystem::UpdateParticleBuffer(const XMMATRIX& view, const FrustumCuller& frustum) {
+    PROFILE_SCOPE("Particles.Upload");
+
+    // Blending is order dependent with depth writes off, so draw back to front
+    {
+        PROFILE_SCOPE("Particles.DepthSort");
+        const XMMATRIX cameraToWorld = XMMatrixInverse(nullptr, view);
+        XMFLOAT3 eye, forward;
+        XMStoreFloat3(&eye, cameraToWorld.r[3]);
+        XMStoreFloat3(&forward, XMVector3Normalize(cameraToWorld.r[2]));
+        m_engine->SortByDepth(eye, forward);
     }
-}
\ No newline at end of file
+
+    // Visible particles are gathered in sorted order straight into the
+    // mapped buffer in parallel
+    const std::span<ParticleInstance> instances =
+        m_backend->MapAs<ParticleInstance>(m_instanceBuffer, MapMode::WriteDiscard);
+    if (instances.empty()) return 0;
+    const uint32_t count = m_engine->WriteInstances(instances, frustum);
+    m_backend->Unmap(m_instanceBuffer);
+    return count;
+}
@@ -1,52 +1,42 @@
 #pragma once
-#include <d3d11.h>
 #include <directxmath.h>
-#include <vector>
-#include <random>
+#include "ParticleEngine.hpp"
+#include "RenderBackend.hpp"
 
 using namespace DirectX;
 
-struct Particle {
-    XMFLOAT3 position;
-    XMFLOAT3 velocity;
-    XMFLOAT4 color;
-    float life;
-    float size;
-};
-
+// GPU side of the particle engine: owns the instance buffer and pipeline
+// and uploads the engine's live particles as instances through a
+// RenderBackend. Simulation and emission live in ParticleEngine.
 class ParticleSystem {
 public:
-    ParticleSystem();
+    ParticleSystem() = default;
     ~ParticleSystem();
 
-    bool Initialize(ID3D11Device* device);
-    void Update(float deltaTime);
-    void Render(ID3D11DeviceContext* context, const XMMATRIX& view, const XMMATRIX& projection);
-    
-    // Particle emission
-    void EmitLineClear(int y);
-    void EmitPieceLock(const XMFLOAT3& position);
-    void EmitGameOver();
+    ParticleSystem(const ParticleSystem&) = delete;
+    ParticleSystem& operator=(const ParticleSystem&) = delete;
+
+    // `shader` is the program id the backend knows the particle shaders by
+    bool Initialize(RenderBackend& backend, ParticleEngine& engine, uint32_t shader);
+    // Particles outside `frustum` (the camera's, e.g. BoardRenderer's) are
+    // left out of the upload
+    void Render(const XMMATRIX& view, const XMMATRIX& projection, const FrustumCuller& frustum);
 
 private:
-    // DirectX resources
-    ID3D11Buffer* m_vertexBuffer;
-    ID3D11Buffer* m_instanceBuffer;
-    ID3D11VertexShader* m_vertexShader;
-    ID3D11PixelShader* m_pixelShader;
-    ID3D11GeometryShader* m_geometryShader;
-    ID3D11InputLayout* m_inputLayout;
-    ID3D11BlendState* m_blendState;
-    ID3D11DepthStencilState* m_depthState;
-    
-    // Particle storage
-    std::vector<Particle> m_particles;
-    std::mt19937 m_random;
-    
-    // Particle system parameters
-    const int MAX_PARTICLES = 10000;
-    const float PARTICLE_LIFETIME = 2.0f;
-    
-    void UpdateParticleBuffer(ID3D11DeviceContext* context);
-    XMFLOAT3 RandomVelocity(float speed);
-};
\ No newline at end of file
+    // Matches the particle shaders' b0
+    struct CameraConstants {
+        XMFLOAT4X4 view;
+        XMFLOAT4X4 projection;
+    };
+
+    RenderBackend* m_backend = nullptr;
+    BufferHandle m_instanceBuffer = BufferHandle::Invalid;
+    BufferHandle m_cameraBuffer = BufferHandle::Invalid;
+    PipelineHandle m_pipeline = PipelineHandle::Invalid;
+
+    ParticleEngine* m_engine = nullptr;
+
+    // Depth-sorts the particles for the camera in `view` and uploads the
+    // ones inside `frustum` back to front; returns the number uploaded
+    uint32_t UpdateParticleBuffer(const XMMATRIX& view, const FrustumCuller& frustum);
+};
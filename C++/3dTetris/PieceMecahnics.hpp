@@ -86,7 +86,7 @@ public:
         return ghostPos;
     }
 
-private:
+    // True when every block is inside the well and on an empty cell
     static bool IsValidPosition(
         const GameState::PieceTemplate& piece,
         const GameState::GridType& grid,
@@ -106,14 +106,14 @@ private:
 };
 
 #pragma once
-#include <DirectXMath.h>
+#include "MathTypes.hpp"
 #include <vector>
 #include <array>
 
 using namespace DirectX;
 
 struct TetrisPiece {
-    std::vector<XMFLOAT3> blocks;
+    std::array<XMFLOAT3, 4> blocks; // fixed size so copies never allocate
     XMFLOAT3 position;
     XMFLOAT4 color;
     int rotation = 0;  // 0-3 for each 90-degree rotation
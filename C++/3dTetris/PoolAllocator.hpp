@@ -0,0 +1,222 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+// Occupancy of one pool, as shown in the profiler overlay
+struct PoolStats {
+    const char* name;
+    uint32_t capacity;
+    uint32_t live;
+    uint32_t peak;
+    uint32_t failed; // creates rejected because the pool was full
+};
+
+// Every SlotMap registers itself here so occupancy can be
+// listed without the owner having to plumb its pools through.
+class PoolRegistry {
+public:
+    struct RegistryConfig {
+        static constexpr size_t MAX_POOLS = 64;
+    };
+
+    using StatsFn = PoolStats (*)(const void* pool);
+
+    static void Register(const void* pool, StatsFn stats) {
+        auto& state = Get();
+        std::lock_guard lock(state.mutex);
+        if (state.count < RegistryConfig::MAX_POOLS) {
+            state.entries[state.count++] = {pool, stats};
+        }
+    }
+
+    static void Unregister(const void* pool) {
+        auto& state = Get();
+        std::lock_guard lock(state.mutex);
+        for (size_t i = 0; i < state.count; ++i) {
+            if (state.entries[i].pool == pool) {
+                state.entries[i] = state.entries[--state.count];
+                return;
+            }
+        }
+    }
+
+    template<typename Fn>
+    static void ForEach(Fn&& fn) {
+        auto& state = Get();
+        std::lock_guard lock(state.mutex);
+        for (size_t i = 0; i < state.count; ++i) {
+            fn(state.entries[i].stats(state.entries[i].pool));
+        }
+    }
+
+private:
+    struct Entry {
+        const void* pool;
+        StatsFn stats;
+    };
+
+    struct State {
+        std::mutex mutex;
+        std::array<Entry, RegistryConfig::MAX_POOLS> entries;
+        size_t count = 0;
+    };
+
+    static State& Get() {
+        static State state;
+        return state;
+    }
+};
+
+// 32-bit handle into a SlotMap: low bits index the slot, high bits hold the
+// slot's generation so handles to removed objects are detected. Zero is
+// never a valid handle.
+struct SlotHandle {
+    static constexpr uint32_t INDEX_BITS = 20;
+    static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+    static constexpr uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+
+    uint32_t value = 0;
+
+    constexpr uint32_t Index() const { return value & INDEX_MASK; }
+    constexpr uint32_t Generation() const { return value >> INDEX_BITS; }
+    constexpr explicit operator bool() const { return value != 0; }
+    constexpr bool operator==(const SlotHandle&) const = default;
+};
+
+// Objects packed densely for iteration, addressed through stable
+// generational handles. Removal swaps the last object into the hole.
+template<typename T>
+class SlotMap {
+public:
+    static constexpr uint32_t MAX_CAPACITY = SlotHandle::INDEX_MASK + 1;
+
+    SlotMap(const char* name, uint32_t capacity,
+            std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : m_name(name), m_capacity(capacity)
+        , m_dense(upstream), m_denseToSlot(upstream), m_slots(upstream) {
+        assert(capacity <= MAX_CAPACITY);
+        m_dense.reserve(capacity);
+        m_denseToSlot.reserve(capacity);
+        m_slots.resize(capacity);
+        for (uint32_t i = 0; i < capacity; ++i) {
+            m_slots[i] = {1, i + 1};
+        }
+        PoolRegistry::Register(this, &SlotMap::StatsThunk);
+    }
+
+    ~SlotMap() { PoolRegistry::Unregister(this); }
+
+    SlotMap(const SlotMap&) = delete;
+    SlotMap& operator=(const SlotMap&) = delete;
+
+    // Returns an invalid handle when the map is full
+    template<typename... Args>
+    SlotHandle Emplace(Args&&... args) {
+        if (m_freeHead >= m_capacity) {
+            m_failed++;
+            return {};
+        }
+
+        const uint32_t index = m_freeHead;
+        Slot& slot = m_slots[index];
+        m_freeHead = slot.denseOrNext;
+
+        slot.denseOrNext = static_cast<uint32_t>(m_dense.size());
+        m_dense.emplace_back(std::forward<Args>(args)...);
+        m_denseToSlot.push_back(index);
+        m_peak = std::max(m_peak, Size());
+        return MakeHandle(index, slot.generation);
+    }
+
+    bool Remove(SlotHandle handle) {
+        if (!Contains(handle)) return false;
+        RemoveAt(m_slots[handle.Index()].denseOrNext);
+        return true;
+    }
+
+    // Removes by position in Values(); the last object moves into `denseIndex`
+    void RemoveAt(uint32_t denseIndex) {
+        const uint32_t index = m_denseToSlot[denseIndex];
+        const uint32_t last = Size() - 1;
+        if (denseIndex != last) {
+            m_dense[denseIndex] = std::move(m_dense[last]);
+            m_denseToSlot[denseIndex] = m_denseToSlot[last];
+            m_slots[m_denseToSlot[denseIndex]].denseOrNext = denseIndex;
+        }
+        m_dense.pop_back();
+        m_denseToSlot.pop_back();
+
+        Slot& slot = m_slots[index];
+        slot.generation = (slot.generation + 1) & SlotHandle::GENERATION_MASK;
+        if (slot.generation == 0) slot.generation = 1; // keep handles non-zero
+        slot.denseOrNext = m_freeHead;
+        m_freeHead = index;
+    }
+
+    bool Contains(SlotHandle handle) const {
+        const uint32_t index = handle.Index();
+        return handle && index < m_capacity &&
+               m_slots[index].generation == handle.Generation() &&
+               m_slots[index].denseOrNext < Size() &&
+               m_denseToSlot[m_slots[index].denseOrNext] == index;
+    }
+
+    T* Get(SlotHandle handle) {
+        return Contains(handle) ? &m_dense[m_slots[handle.Index()].denseOrNext] : nullptr;
+    }
+
+    const T* Get(SlotHandle handle) const {
+        return Contains(handle) ? &m_dense[m_slots[handle.Index()].denseOrNext] : nullptr;
+    }
+
+    SlotHandle HandleAt(uint32_t denseIndex) const {
+        const uint32_t index = m_denseToSlot[denseIndex];
+        return MakeHandle(index, m_slots[index].generation);
+    }
+
+    void Clear() {
+        while (!m_dense.empty()) RemoveAt(Size() - 1);
+    }
+
+    std::span<T> Values() { return m_dense; }
+    std::span<const T> Values() const { return m_dense; }
+    uint32_t Size() const { return static_cast<uint32_t>(m_dense.size()); }
+    uint32_t Capacity() const { return m_capacity; }
+    bool Empty() const { return m_dense.empty(); }
+    bool Full() const { return m_freeHead >= m_capacity; }
+
+    PoolStats GetStats() const {
+        return {m_name, m_capacity, Size(), m_peak, m_failed};
+    }
+
+private:
+    struct Slot {
+        uint32_t generation;
+        uint32_t denseOrNext; // dense index while live, next free slot otherwise
+    };
+
+    const char* m_name;
+    uint32_t m_capacity;
+    std::pmr::vector<T> m_dense;
+    std::pmr::vector<uint32_t> m_denseToSlot;
+    std::pmr::vector<Slot> m_slots;
+    uint32_t m_freeHead = 0;
+    uint32_t m_peak = 0;
+    uint32_t m_failed = 0;
+
+    static constexpr SlotHandle MakeHandle(uint32_t index, uint32_t generation) {
+        return {(generation << SlotHandle::INDEX_BITS) | index};
+    }
+
+    static PoolStats StatsThunk(const void* pool) {
+        return static_cast<const SlotMap*>(pool)->GetStats();
+    }
+};
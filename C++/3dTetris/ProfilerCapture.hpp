@@ -0,0 +1,239 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <string_view>
+#include <vector>
+#include "MappedFile.hpp"
+
+// Binary layout of a continuous profiler capture (.t3dprof):
+//
+//   CaptureHeader
+//   FrameRecord, MarkerRecord[markerCount]   (repeated, one per frame)
+//   IndexEntry[indexCount]                   (written on Close)
+//   NameEntry + name bytes                   (written on Close)
+//
+// Header and dataEnd are updated after every frame, so a capture from a
+// crashed session is still readable; readers rebuild the index by walking
+// the frame records when indexCount is zero.
+namespace ProfilerCapture {
+    static constexpr char MAGIC[8] = {'T', '3', 'D', 'P', 'R', 'O', 'F', '\0'};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t INDEX_STRIDE = 60; // one index entry per second at 60fps
+
+    struct CaptureHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t headerSize;
+        uint64_t frameCount;
+        uint64_t dataEnd;
+        uint64_t indexOffset;
+        uint64_t indexCount;
+        uint64_t nameTableOffset;
+        uint64_t nameCount;
+    };
+
+    struct FrameRecord {
+        uint64_t frameNumber;
+        uint64_t startNs;        // since capture start
+        float frameTime;         // seconds
+        uint32_t markerCount;
+        uint32_t heapAllocCount;
+        uint32_t heapAllocBytes;
+    };
+
+    struct MarkerRecord {
+        uint32_t nameHash;       // stable across runs, resolved via the name table
+        uint16_t threadId;
+        uint16_t depth;
+        uint32_t startNs;        // since frame start
+        uint32_t durationNs;
+    };
+
+    struct IndexEntry {
+        uint64_t frameNumber;
+        uint64_t startNs;
+        uint64_t offset;
+    };
+
+    struct NameEntry {
+        uint32_t nameHash;
+        uint32_t length;
+    };
+
+    class Writer {
+    public:
+        bool Open(const std::filesystem::path& path) {
+            if (!m_file.OpenForWrite(path, MappedFile::MappingConfig::MIN_GROWTH)) return false;
+
+            m_header = {};
+            std::memcpy(m_header.magic, MAGIC, sizeof(MAGIC));
+            m_header.version = VERSION;
+            m_header.headerSize = sizeof(CaptureHeader);
+            m_header.dataEnd = sizeof(CaptureHeader);
+            m_index.clear();
+            m_index.reserve(64 * 1024); // ~18 hours at 60fps before growing
+            FlushHeader();
+            return true;
+        }
+
+        bool IsOpen() const { return m_file.IsOpen(); }
+
+        bool WriteFrame(const FrameRecord& frame, std::span<const MarkerRecord> markers) {
+            if (!IsOpen()) return false;
+
+            const uint64_t offset = m_header.dataEnd;
+            const size_t size = sizeof(FrameRecord) + markers.size_bytes();
+            if (!m_file.Reserve(offset + size)) return false;
+
+            FrameRecord record = frame;
+            record.markerCount = static_cast<uint32_t>(markers.size());
+            std::byte* dst = m_file.Data() + offset;
+            std::memcpy(dst, &record, sizeof(FrameRecord));
+            if (!markers.empty()) {
+                std::memcpy(dst + sizeof(FrameRecord), markers.data(), markers.size_bytes());
+            }
+
+            if (m_header.frameCount % INDEX_STRIDE == 0) {
+                m_index.push_back({record.frameNumber, record.startNs, offset});
+            }
+
+            m_header.frameCount++;
+            m_header.dataEnd = offset + size;
+            FlushHeader();
+            return true;
+        }
+
+        // Appends the index and the marker name table, then trims the file
+        template<typename NameFn>
+        void Close(std::span<const uint32_t> nameHashes, NameFn&& getName) {
+            if (!IsOpen()) return;
+
+            uint64_t offset = m_header.dataEnd;
+            const size_t indexBytes = m_index.size() * sizeof(IndexEntry);
+            if (m_file.Reserve(offset + indexBytes)) {
+                std::memcpy(m_file.Data() + offset, m_index.data(), indexBytes);
+                m_header.indexOffset = offset;
+                m_header.indexCount = m_index.size();
+                offset += indexBytes;
+            }
+
+            m_header.nameTableOffset = offset;
+            m_header.nameCount = 0;
+            for (size_t i = 0; i < nameHashes.size(); ++i) {
+                const char* name = getName(i);
+                NameEntry entry{nameHashes[i], static_cast<uint32_t>(std::strlen(name))};
+                if (!m_file.Reserve(offset + sizeof(NameEntry) + entry.length)) break;
+
+                std::memcpy(m_file.Data() + offset, &entry, sizeof(NameEntry));
+                std::memcpy(m_file.Data() + offset + sizeof(NameEntry), name, entry.length);
+                offset += sizeof(NameEntry) + entry.length;
+                m_header.nameCount++;
+            }
+
+            FlushHeader();
+            m_file.Close(offset);
+        }
+
+    private:
+        MappedFile m_file;
+        CaptureHeader m_header = {};
+        std::vector<IndexEntry> m_index;
+
+        void FlushHeader() {
+            std::memcpy(m_file.Data(), &m_header, sizeof(CaptureHeader));
+        }
+    };
+
+    class Reader {
+    public:
+        bool Open(const std::filesystem::path& path) {
+            if (!m_file.OpenForRead(path) || m_file.Size() < sizeof(CaptureHeader)) return false;
+
+            std::memcpy(&m_header, m_file.Data(), sizeof(CaptureHeader));
+            if (std::memcmp(m_header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+                m_header.version != VERSION ||
+                m_header.dataEnd > m_file.Size()) {
+                return false;
+            }
+
+            LoadIndex();
+            return true;
+        }
+
+        const CaptureHeader& GetHeader() const { return m_header; }
+        const std::vector<IndexEntry>& GetIndex() const { return m_index; }
+
+        // Offset of the first frame that could start at or after startNs
+        uint64_t FindFrameOffset(uint64_t startNs) const {
+            auto it = std::upper_bound(m_index.begin(), m_index.end(), startNs,
+                [](uint64_t ns, const IndexEntry& entry) { return ns < entry.startNs; });
+            return it == m_index.begin() ? m_header.headerSize : std::prev(it)->offset;
+        }
+
+        // Reads the frame at `offset`; returns the offset of the next frame or 0
+        uint64_t ReadFrame(uint64_t offset, FrameRecord& frame,
+                           std::span<const MarkerRecord>& markers) const {
+            if (offset + sizeof(FrameRecord) > m_header.dataEnd) return 0;
+
+            std::memcpy(&frame, m_file.Data() + offset, sizeof(FrameRecord));
+            const uint64_t markerBytes = uint64_t(frame.markerCount) * sizeof(MarkerRecord);
+            const uint64_t next = offset + sizeof(FrameRecord) + markerBytes;
+            if (next > m_header.dataEnd) return 0;
+
+            markers = {
+                reinterpret_cast<const MarkerRecord*>(m_file.Data() + offset + sizeof(FrameRecord)),
+                frame.markerCount
+            };
+            return next;
+        }
+
+        template<typename Fn>
+        void ForEachName(Fn&& fn) const {
+            uint64_t offset = m_header.nameTableOffset;
+            for (uint64_t i = 0; i < m_header.nameCount; ++i) {
+                if (offset + sizeof(NameEntry) > m_file.Size()) return;
+
+                NameEntry entry;
+                std::memcpy(&entry, m_file.Data() + offset, sizeof(NameEntry));
+                offset += sizeof(NameEntry);
+                if (offset + entry.length > m_file.Size()) return;
+
+                fn(entry.nameHash, std::string_view(
+                    reinterpret_cast<const char*>(m_file.Data() + offset), entry.length));
+                offset += entry.length;
+            }
+        }
+
+    private:
+        MappedFile m_file;
+        CaptureHeader m_header = {};
+        std::vector<IndexEntry> m_index;
+
+        void LoadIndex() {
+            m_index.clear();
+            if (m_header.indexCount > 0 &&
+                m_header.indexOffset + m_header.indexCount * sizeof(IndexEntry) <= m_file.Size()) {
+                m_index.resize(m_header.indexCount);
+                std::memcpy(m_index.data(), m_file.Data() + m_header.indexOffset,
+                            m_index.size() * sizeof(IndexEntry));
+                return;
+            }
+
+            // Capture was not closed cleanly; rebuild the index from the records
+            FrameRecord frame;
+            std::span<const MarkerRecord> markers;
+            uint64_t offset = m_header.headerSize;
+            for (uint64_t i = 0; offset != 0; ++i) {
+                uint64_t next = ReadFrame(offset, frame, markers);
+                if (next == 0) break;
+                if (i % INDEX_STRIDE == 0) {
+                    m_index.push_back({frame.frameNumber, frame.startNs, offset});
+                }
+                offset = next;
+            }
+        }
+    };
+}
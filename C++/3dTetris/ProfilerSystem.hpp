@@ -1,11 +1,34 @@
 #pragma once
 #include <chrono>
-#include <string>
+#include <string_view>
+#include <algorithm>
 #include <array>
-#include <unordered_map>
+#include <atomic>
+#include <bit>
 #include <vector>
+#include <span>
 #include <thread>
 #include <mutex>
+#include <cassert>
+#include <cstring>
+#include <cstdio>
+#include "AllocationTracker.hpp"
+#include "PoolAllocator.hpp"
+#include "ProfilerCapture.hpp"
+
+// Profiler build levels:
+//   0 - every marker compiles to nothing (release builds)
+//   1 - cheap always-on CPU markers (development builds)
+//   2 - CPU and GPU markers (ENABLE_PROFILING builds)
+#ifndef TETRIS_PROFILER_LEVEL
+    #if defined(ENABLE_PROFILING)
+        #define TETRIS_PROFILER_LEVEL 2
+    #elif defined(NDEBUG)
+        #define TETRIS_PROFILER_LEVEL 0
+    #else
+        #define TETRIS_PROFILER_LEVEL 1
+    #endif
+#endif
 
 class ProfilerSystem {
 public:
@@ -14,13 +37,87 @@ public:
         static constexpr size_t MAX_MARKERS = 1024;
         static constexpr size_t MAX_THREADS = 32;
         static constexpr float HISTORY_TIME = 5.0f; // 5 seconds of history
+        // Flag a marker that hit the heap in this many of the last
+        // HEAP_CHURN_WINDOW frames; a per-event allocation (line clear,
+        // spawn) is as much churn as a per-frame one
+        static constexpr uint32_t HEAP_CHURN_WINDOW = 60; // frames, at most 64
+        static constexpr uint32_t HEAP_CHURN_FRAMES = 3;
+    };
+
+    static constexpr uint16_t INVALID_MARKER = 0xFFFF;
+    static_assert(ProfileConfig::HEAP_CHURN_WINDOW <= 64, "heapHistory holds one bit per frame");
+    static constexpr uint64_t HEAP_CHURN_WINDOW_MASK = ProfileConfig::HEAP_CHURN_WINDOW == 64
+        ? ~0ull : (1ull << ProfileConfig::HEAP_CHURN_WINDOW) - 1;
+    static constexpr uint32_t NO_PARENT = ~0u;
+
+    // FNV-1a over the marker name, forced to compile time so call sites
+    // only ever carry an integer
+    static consteval uint32_t HashMarkerName(std::string_view name) {
+        uint32_t hash = 2166136261u;
+        for (char c : name) {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    // Process-wide table mapping marker hashes to dense slots. Each call site
+    // registers once (function-local static), after that only the slot is used.
+    class MarkerRegistry {
+    public:
+        struct Entry {
+            uint32_t hash;
+            const char* name;
+        };
+
+        static uint16_t Register(uint32_t hash, const char* name) {
+            auto& registry = Get();
+            std::lock_guard<std::mutex> lock(registry.m_mutex);
+
+            size_t count = registry.m_count.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < count; ++i) {
+                if (registry.m_entries[i].hash == hash) {
+                    assert(std::strcmp(registry.m_entries[i].name, name) == 0 &&
+                           "Profiler marker hash collision");
+                    return static_cast<uint16_t>(i);
+                }
+            }
+
+            if (count >= ProfileConfig::MAX_MARKERS) return INVALID_MARKER;
+
+            registry.m_entries[count] = {hash, name};
+            registry.m_count.store(count + 1, std::memory_order_release);
+            return static_cast<uint16_t>(count);
+        }
+
+        static const char* GetName(uint16_t slot) {
+            return slot < Count() ? Get().m_entries[slot].name : "<invalid>";
+        }
+
+        static uint32_t GetHash(uint16_t slot) {
+            return slot < Count() ? Get().m_entries[slot].hash : 0;
+        }
+
+        static size_t Count() {
+            return Get().m_count.load(std::memory_order_acquire);
+        }
+
+    private:
+        std::array<Entry, ProfileConfig::MAX_MARKERS> m_entries = {};
+        std::atomic<size_t> m_count{0};
+        std::mutex m_mutex;
+
+        static MarkerRegistry& Get() {
+            static MarkerRegistry registry;
+            return registry;
+        }
     };
 
     struct ProfileMarker {
-        std::string name;
         std::chrono::high_resolution_clock::time_point start;
         std::chrono::high_resolution_clock::time_point end;
-        uint32_t threadId;
+        uint16_t markerId;
+        uint16_t threadId;
         uint32_t parentIndex;
         uint32_t depth;
         bool isGPU;
@@ -28,6 +125,7 @@ public:
 
     struct ProfileFrame {
         std::vector<ProfileMarker> markers;
+        AllocationTracker::AllocationSnapshot allocations;
         float frameTime;
         uint64_t frameNumber;
     };
@@ -38,23 +136,39 @@ public:
         float avgTime;
         float lastTime;
         uint32_t callCount;
+
+        // Allocations made directly inside this marker during the last frame
+        AllocationTracker::AllocationSnapshot lastAllocations;
+        uint64_t heapHistory;     // bit n set: heap allocations n frames ago
+        uint32_t heapChurnFrames; // frames with heap allocations in the window
+        bool heapChurn;
+
+        // Sum of the AddCount calls for this marker during the last frame
+        uint32_t lastCount;
+        bool isCounter;
     };
 
     class ScopedMarker {
     public:
-        ScopedMarker(ProfilerSystem& profiler, const char* name, bool isGPU = false)
-            : m_profiler(profiler), m_name(name), m_isGPU(isGPU) {
-            m_profiler.BeginMarker(m_name, m_isGPU);
+        ScopedMarker(ProfilerSystem* profiler, uint16_t markerId, bool isGPU = false)
+            : m_profiler(profiler)
+            , m_index(profiler ? profiler->BeginMarker(markerId, isGPU) : NO_PARENT) {
+            if (m_profiler) AllocationTracker::PushScope(markerId);
         }
 
         ~ScopedMarker() {
-            m_profiler.EndMarker(m_name);
+            if (m_profiler) {
+                AllocationTracker::PopScope();
+                m_profiler->EndMarker(m_index);
+            }
         }
 
+        ScopedMarker(const ScopedMarker&) = delete;
+        ScopedMarker& operator=(const ScopedMarker&) = delete;
+
     private:
-        ProfilerSystem& m_profiler;
-        const char* m_name;
-        bool m_isGPU;
+        ProfilerSystem* m_profiler;
+        uint32_t m_index;
     };
 
     ProfilerSystem()
@@ -62,6 +176,22 @@ public:
         , m_frameCount(0)
         , m_enabled(true) {
         m_frames.resize(ProfileConfig::MAX_FRAMES);
+
+        ProfilerSystem* expected = nullptr;
+        s_active.compare_exchange_strong(expected, this);
+        AllocationTracker::SetMarkerNameResolver(&MarkerRegistry::GetName);
+    }
+
+    ~ProfilerSystem() {
+        StopCapture();
+
+        ProfilerSystem* expected = this;
+        s_active.compare_exchange_strong(expected, nullptr);
+    }
+
+    // Profiler the PROFILE_* macros report to (first one constructed)
+    static ProfilerSystem* Active() {
+        return s_active.load(std::memory_order_acquire);
     }
 
     void BeginFrame() {
@@ -70,6 +200,9 @@ public:
         m_frameStart = std::chrono::high_resolution_clock::now();
         m_currentFrame = (m_currentFrame + 1) % ProfileConfig::MAX_FRAMES;
         m_frames[m_currentFrame].markers.clear();
+        // Ring frames grow to the busiest frame seen so far, here rather
+        // than mid-frame under the lock; a quiet game stays small
+        m_frames[m_currentFrame].markers.reserve(m_peakMarkersPerFrame);
         m_frames[m_currentFrame].frameNumber = m_frameCount++;
 
         // Begin GPU frame query
@@ -84,6 +217,8 @@ public:
         auto frameEnd = std::chrono::high_resolution_clock::now();
         float frameTime = std::chrono::duration<float>(frameEnd - m_frameStart).count();
         m_frames[m_currentFrame].frameTime = frameTime;
+        m_frames[m_currentFrame].allocations = AllocationTracker::EndFrame();
+        m_peakMarkersPerFrame = std::max(m_peakMarkersPerFrame, m_frames[m_currentFrame].markers.size());
 
         // End GPU frame query
         if (m_d3dQuery) {
@@ -93,50 +228,106 @@ public:
 
         // Update statistics
         UpdateStats();
+
+        if (m_capture.IsOpen()) {
+            WriteCaptureFrame();
+        }
     }
 
-    void BeginMarker(const char* name, bool isGPU = false) {
-        if (!m_enabled) return;
+    // Returns the marker's index in the current frame, handed back to EndMarker
+    uint32_t BeginMarker(uint16_t markerId, bool isGPU = false) {
+        if (!m_enabled || markerId == INVALID_MARKER) return NO_PARENT;
 
-        uint32_t threadId = static_cast<uint32_t>(
-            std::hash<std::thread::id>{}(std::this_thread::get_id())
-        );
+        ThreadState& thread = GetThreadState();
 
         ProfileMarker marker;
-        marker.name = name;
+        marker.markerId = markerId;
         marker.start = std::chrono::high_resolution_clock::now();
-        marker.threadId = threadId;
+        marker.threadId = thread.slot;
+        marker.parentIndex = thread.openMarker;
+        marker.depth = thread.depth++;
         marker.isGPU = isGPU;
-        marker.depth = GetCurrentDepth(threadId);
 
         // GPU timing
         if (isGPU) {
-            BeginGPUMarker(name);
+            BeginGPUMarker(MarkerRegistry::GetName(markerId));
         }
 
         std::lock_guard<std::mutex> lock(m_mutex);
-        m_frames[m_currentFrame].markers.push_back(marker);
+        auto& markers = m_frames[m_currentFrame].markers;
+        uint32_t index = static_cast<uint32_t>(markers.size());
+        markers.push_back(marker);
+        thread.openMarker = index;
+        return index;
     }
 
-    void EndMarker(const char* name) {
-        if (!m_enabled) return;
+    void EndMarker(uint32_t index) {
+        if (!m_enabled || index == NO_PARENT) return;
+
+        auto now = std::chrono::high_resolution_clock::now();
+        ThreadState& thread = GetThreadState();
+        if (thread.depth > 0) --thread.depth;
 
         std::lock_guard<std::mutex> lock(m_mutex);
         auto& markers = m_frames[m_currentFrame].markers;
 
-        // Find matching marker
-        for (auto it = markers.rbegin(); it != markers.rend(); ++it) {
-            if (it->name == name && it->end.time_since_epoch().count() == 0) {
-                it->end = std::chrono::high_resolution_clock::now();
+        // The frame may have rolled over while the scope was open
+        if (index >= markers.size()) {
+            thread.openMarker = NO_PARENT;
+            return;
+        }
+
+        auto& marker = markers[index];
+        marker.end = now;
+        thread.openMarker = marker.parentIndex;
 
-                if (it->isGPU) {
-                    EndGPUMarker();
-                }
-                break;
-            }
+        if (marker.isGPU) {
+            EndGPUMarker();
         }
     }
 
+    // Streams every frame to a memory-mapped capture file until StopCapture.
+    // Unlike the in-memory history this is unbounded, for long soak tests.
+    bool StartCapture(const std::filesystem::path& path) {
+        StopCapture();
+        m_captureScratch.reserve(ProfileConfig::MAX_MARKERS);
+        m_captureStart = std::chrono::high_resolution_clock::now();
+        return m_capture.Open(path);
+    }
+
+    void StopCapture() {
+        if (!m_capture.IsOpen()) return;
+
+        std::array<uint32_t, ProfileConfig::MAX_MARKERS> hashes;
+        size_t count = MarkerRegistry::Count();
+        for (size_t i = 0; i < count; ++i) {
+            hashes[i] = MarkerRegistry::GetHash(static_cast<uint16_t>(i));
+        }
+        m_capture.Close(std::span<const uint32_t>(hashes.data(), count), [](size_t slot) {
+            return MarkerRegistry::GetName(static_cast<uint16_t>(slot));
+        });
+    }
+
+    bool IsCapturing() const { return m_capture.IsOpen(); }
+
+    const ProfileStats& GetStats(uint16_t markerId) const {
+        return m_stats[markerId];
+    }
+
+    // Adds to a per-frame counter (e.g. objects culled), shown next to the
+    // timings; safe from any thread
+    void AddCount(uint16_t markerId, uint32_t value) {
+        if (!m_enabled || markerId == INVALID_MARKER) return;
+        m_counts[markerId].fetch_add(value, std::memory_order_relaxed);
+        m_isCounter[markerId].store(true, std::memory_order_relaxed);
+    }
+
+    // Markers that hit the global heap in HEAP_CHURN_FRAMES of the last
+    // HEAP_CHURN_WINDOW frames
+    std::span<const uint16_t> GetHeapChurnMarkers() const {
+        return {m_heapChurnMarkers.data(), m_heapChurnCount};
+    }
+
     void RenderUI(DebugRenderer& debug) {
         if (!m_enabled) return;
 
@@ -148,16 +339,33 @@ public:
 
         // Draw statistics
         DrawStats(debug);
-    }
 
-    // Helper macro for scoped profiling
-    #define PROFILE_SCOPE(name) ProfilerSystem::ScopedMarker CONCAT(scopedMarker, __LINE__)(*this, name)
-    #define PROFILE_SCOPE_GPU(name) ProfilerSystem::ScopedMarker CONCAT(scopedMarker, __LINE__)(*this, name, true)
+        // Draw flagged heap churn
+        DrawAllocationWarnings(debug);
+
+        // Draw slot map occupancy
+        DrawPoolOccupancy(debug);
+
+        // Draw per-frame counters
+        DrawCounters(debug);
+    }
 
 private:
+    // Per thread, so nesting is tracked exactly even when more threads
+    // than MAX_THREADS share a capture slot
+    struct ThreadState {
+        uint16_t slot;
+        uint32_t openMarker;
+        uint32_t depth;
+    };
+
+    inline static std::atomic<ProfilerSystem*> s_active{nullptr};
+    inline static std::atomic<uint16_t> s_nextThreadSlot{0};
+
     std::vector<ProfileFrame> m_frames;
     size_t m_currentFrame;
     uint64_t m_frameCount;
+    size_t m_peakMarkersPerFrame = 0;
     bool m_enabled;
     std::mutex m_mutex;
     std::chrono::high_resolution_clock::time_point m_frameStart;
@@ -167,10 +375,205 @@ private:
     ComPtr<ID3D11Query> m_d3dQuery;
     std::vector<ComPtr<ID3D11Query>> m_gpuMarkerQueries;
 
-    std::unordered_map<std::string, ProfileStats> m_stats;
-    std::array<uint32_t, ProfileConfig::MAX_THREADS> m_threadDepths = {};
+    std::array<ProfileStats, ProfileConfig::MAX_MARKERS> m_stats = {};
+    std::array<float, ProfileConfig::MAX_MARKERS> m_frameTotals = {};
+    std::array<uint16_t, ProfileConfig::MAX_MARKERS> m_frameTouched = {};
+    std::array<uint64_t, ProfileConfig::MAX_MARKERS> m_lastSeenFrame = {};
+    std::array<uint16_t, ProfileConfig::MAX_MARKERS> m_heapChurnMarkers = {};
+    size_t m_heapChurnCount = 0;
+    std::array<std::atomic<uint32_t>, ProfileConfig::MAX_MARKERS> m_counts = {};
+    std::array<std::atomic<bool>, ProfileConfig::MAX_MARKERS> m_isCounter = {};
+
+    // Continuous capture
+    ProfilerCapture::Writer m_capture;
+    std::vector<ProfilerCapture::MarkerRecord> m_captureScratch;
+    std::chrono::high_resolution_clock::time_point m_captureStart;
+
+    static ThreadState& GetThreadState() {
+        thread_local ThreadState state{
+            static_cast<uint16_t>(s_nextThreadSlot.fetch_add(1) % ProfileConfig::MAX_THREADS),
+            NO_PARENT,
+            0
+        };
+        return state;
+    }
 
     void UpdateStats() {
-        // Group markers by name and calculate
+        // Group markers by id and calculate
+        size_t touchedCount = 0;
+        for (const auto& marker : m_frames[m_currentFrame].markers) {
+            if (marker.end.time_since_epoch().count() == 0) continue;
+
+            float duration = std::chrono::duration<float>(marker.end - marker.start).count();
+            if (m_lastSeenFrame[marker.markerId] != m_frameCount) {
+                m_lastSeenFrame[marker.markerId] = m_frameCount;
+                m_frameTotals[marker.markerId] = 0.0f;
+                m_frameTouched[touchedCount++] = marker.markerId;
+            }
+            m_frameTotals[marker.markerId] += duration;
+        }
+
+        for (size_t i = 0; i < touchedCount; ++i) {
+            uint16_t id = m_frameTouched[i];
+            float total = m_frameTotals[id];
+            auto& stats = m_stats[id];
+
+            if (stats.callCount == 0) {
+                stats.minTime = total;
+                stats.maxTime = total;
+                stats.avgTime = total;
+            } else {
+                stats.minTime = std::min(stats.minTime, total);
+                stats.maxTime = std::max(stats.maxTime, total);
+                stats.avgTime += (total - stats.avgTime) / static_cast<float>(stats.callCount + 1);
+            }
+            stats.lastTime = total;
+            stats.callCount++;
+        }
+
+        UpdateAllocationStats();
+        UpdateCounters();
+    }
+
+    void UpdateCounters() {
+        size_t markerCount = MarkerRegistry::Count();
+        for (size_t id = 0; id < markerCount; ++id) {
+            m_stats[id].lastCount = m_counts[id].exchange(0, std::memory_order_relaxed);
+            m_stats[id].isCounter = m_isCounter[id].load(std::memory_order_relaxed);
+        }
+    }
+
+    void UpdateAllocationStats() {
+        // Drain every registered marker so idle markers do not carry counts over
+        m_heapChurnCount = 0;
+        size_t markerCount = MarkerRegistry::Count();
+        for (size_t id = 0; id < markerCount; ++id) {
+            auto& stats = m_stats[id];
+            stats.lastAllocations = AllocationTracker::ConsumeMarker(static_cast<uint16_t>(id));
+
+            const bool allocated = stats.lastAllocations.Get(AllocationTracker::Source::Heap).count > 0;
+            stats.heapHistory = ((stats.heapHistory << 1) | (allocated ? 1u : 0u)) & HEAP_CHURN_WINDOW_MASK;
+            stats.heapChurnFrames = static_cast<uint32_t>(std::popcount(stats.heapHistory));
+
+            stats.heapChurn = stats.heapChurnFrames >= ProfileConfig::HEAP_CHURN_FRAMES;
+            if (stats.heapChurn) {
+                m_heapChurnMarkers[m_heapChurnCount++] = static_cast<uint16_t>(id);
+            }
+        }
+
+        // Allocations outside any scope are only reported in the frame totals
+        AllocationTracker::ConsumeMarker(AllocationTracker::TrackerConfig::UNSCOPED);
+    }
+
+    void WriteCaptureFrame() {
+        using namespace std::chrono;
+        const auto& frame = m_frames[m_currentFrame];
+        const auto& heap = frame.allocations.Get(AllocationTracker::Source::Heap);
+
+        m_captureScratch.clear();
+        for (const auto& marker : frame.markers) {
+            if (marker.end.time_since_epoch().count() == 0) continue;
+            m_captureScratch.push_back({
+                MarkerRegistry::GetHash(marker.markerId),
+                marker.threadId,
+                static_cast<uint16_t>(marker.depth),
+                static_cast<uint32_t>(duration_cast<nanoseconds>(marker.start - m_frameStart).count()),
+                static_cast<uint32_t>(duration_cast<nanoseconds>(marker.end - marker.start).count())
+            });
+        }
+
+        ProfilerCapture::FrameRecord record = {};
+        record.frameNumber = frame.frameNumber;
+        record.startNs = static_cast<uint64_t>(
+            duration_cast<nanoseconds>(m_frameStart - m_captureStart).count());
+        record.frameTime = frame.frameTime;
+        record.heapAllocCount = heap.count;
+        record.heapAllocBytes = static_cast<uint32_t>(std::min<uint64_t>(heap.bytes, UINT32_MAX));
+
+        if (!m_capture.WriteFrame(record, m_captureScratch)) {
+            StopCapture();
+        }
+    }
+
+    void DrawAllocationWarnings(DebugRenderer& debug) {
+        char line[160];
+        float y = 10.0f;
+        for (uint16_t id : GetHeapChurnMarkers()) {
+            const auto& heap = m_stats[id].lastAllocations.Get(AllocationTracker::Source::Heap);
+            std::snprintf(line, sizeof(line), "Heap churn: %s (%u of %u frames, last %u allocs, %llu bytes)",
+                          MarkerRegistry::GetName(id), m_stats[id].heapChurnFrames,
+                          ProfileConfig::HEAP_CHURN_WINDOW, heap.count,
+                          static_cast<unsigned long long>(heap.bytes));
+            debug.DrawText(line, {10.0f, y}, {1.0f, 0.3f, 0.3f, 1.0f});
+            y += 18.0f;
+        }
+    }
+
+    void DrawPoolOccupancy(DebugRenderer& debug) {
+        char line[160];
+        float y = 400.0f;
+        PoolRegistry::ForEach([&](const PoolStats& pool) {
+            const bool nearlyFull = pool.peak * 10 >= pool.capacity * 9;
+            std::snprintf(line, sizeof(line), "%s: %u / %u (peak %u, rejected %u)",
+                          pool.name, pool.live, pool.capacity, pool.peak, pool.failed);
+            debug.DrawText(line, {10.0f, y},
+                           pool.failed > 0 || nearlyFull ? XMFLOAT4{1.0f, 0.6f, 0.2f, 1.0f}
+                                                         : XMFLOAT4{0.8f, 0.8f, 0.8f, 1.0f});
+            y += 18.0f;
+        });
+    }
+
+    void DrawCounters(DebugRenderer& debug) {
+        char line[160];
+        float y = 600.0f;
+        size_t markerCount = MarkerRegistry::Count();
+        for (size_t id = 0; id < markerCount; ++id) {
+            if (!m_stats[id].isCounter) continue;
+            std::snprintf(line, sizeof(line), "%s: %u", MarkerRegistry::GetName(static_cast<uint16_t>(id)),
+                          m_stats[id].lastCount);
+            debug.DrawText(line, {10.0f, y}, {0.8f, 0.8f, 0.8f, 1.0f});
+            y += 18.0f;
+        }
     }
-}
\ No newline at end of file
+};
+
+// Resolves a string literal to its registry slot; the hash is a template
+// argument so it can never be computed at runtime
+#define PROFILER_CONCAT_INNER(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_INNER(a, b)
+#define PROFILER_MARKER_ID(name)                                              \
+    ([]() -> uint16_t {                                                       \
+        static const uint16_t slot = ProfilerSystem::MarkerRegistry::Register( \
+            std::integral_constant<uint32_t,                                  \
+                ProfilerSystem::HashMarkerName(name)>::value, name);          \
+        return slot;                                                          \
+    }())
+
+// Helper macros for scoped profiling
+#if TETRIS_PROFILER_LEVEL >= 1
+    #define PROFILE_SCOPE(name) \
+        ProfilerSystem::ScopedMarker PROFILER_CONCAT(scopedMarker, __LINE__)( \
+            ProfilerSystem::Active(), PROFILER_MARKER_ID(name))
+#else
+    #define PROFILE_SCOPE(name) ((void)0)
+#endif
+
+// Adds `value` to the named per-frame counter
+#if TETRIS_PROFILER_LEVEL >= 1
+    #define PROFILE_COUNT(name, value)                                                      \
+        do {                                                                                \
+            if (ProfilerSystem* profiler = ProfilerSystem::Active()) {                      \
+                profiler->AddCount(PROFILER_MARKER_ID(name), static_cast<uint32_t>(value)); \
+            }                                                                               \
+        } while (0)
+#else
+    #define PROFILE_COUNT(name, value) ((void)0)
+#endif
+
+#if TETRIS_PROFILER_LEVEL >= 2
+    #define PROFILE_SCOPE_GPU(name) \
+        ProfilerSystem::ScopedMarker PROFILER_CONCAT(scopedMarker, __LINE__)( \
+            ProfilerSystem::Active(), PROFILER_MARKER_ID(name), true)
+#else
+    #define PROFILE_SCOPE_GPU(name) PROFILE_SCOPE(name)
+#endif
@@ -1,7 +1,20 @@
-void Render() {
-    // Clear the back buffer
-    float ClearColor[4] = { 0.0f, 0.2f, 0.4f, 1.0f };
-    g_pImmediateContext->ClearRenderTargetView(g_pRenderTargetView, ClearColor);
+// Handles created once at startup for the grid meshes; cubes go through
+// BoardRenderer
+struct BlockRenderResources {
+    BufferHandle constantBuffer;   // ConstantBuffer, BufferUsage::Default
+    PipelineHandle pipeline;       // opaque triangles, depth test and write
+    BufferHandle gridVertexBuffer; // MesherConfig::MAX_QUADS * 4 GridMesher::Vertex, BufferUsage::Dynamic
+    BufferHandle gridIndexBuffer;  // GridMesher::WriteQuadIndices for MAX_QUADS quads
+    BufferHandle faceVertexBuffer; // FaceMeshConfig::VERTEX_BUFFER_BYTES, BufferUsage::Default
+};
+
+// Clears the frame, hands the camera to `boardRenderer` and binds the grid
+// pipeline; returns the constant buffer contents with an identity world
+// matrix
+static ConstantBuffer BeginBlockFrame(RenderBackend& backend, const BlockRenderResources& resources,
+                                      BoardRenderer& boardRenderer) {
+    // Clear the back buffer and depth
+    backend.BeginFrame(ClearDesc{});
 
     // Setup matrices
     XMMATRIX world = XMMatrixIdentity();
@@ -12,90 +25,80 @@ void Render() {
     );
     XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, WINDOW_WIDTH / (FLOAT)WINDOW_HEIGHT, 0.01f, 100.0f);
 
-    // Setup depth stencil state
-    ID3D11DepthStencilState* pDSState = nullptr;
-    D3D11_DEPTH_STENCIL_DESC dsDesc = {};
-    dsDesc.DepthEnable = TRUE;
-    dsDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
-    dsDesc.DepthFunc = D3D11_COMPARISON_LESS;
-    g_pd3dDevice->CreateDepthStencilState(&dsDesc, &pDSState);
-    g_pImmediateContext->OMSetDepthStencilState(pDSState, 1);
-
-    // Create depth stencil texture
-    ID3D11Texture2D* pDepthStencil = nullptr;
-    D3D11_TEXTURE2D_DESC descDepth = {};
-    descDepth.Width = WINDOW_WIDTH;
-    descDepth.Height = WINDOW_HEIGHT;
-    descDepth.MipLevels = 1;
-    descDepth.ArraySize = 1;
-    descDepth.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
-    descDepth.SampleDesc.Count = 1;
-    descDepth.SampleDesc.Quality = 0;
-    descDepth.Usage = D3D11_USAGE_DEFAULT;
-    descDepth.BindFlags = D3D11_BIND_DEPTH_STENCIL;
-    g_pd3dDevice->CreateTexture2D(&descDepth, nullptr, &pDepthStencil);
-
-    // Create depth stencil view
-    ID3D11DepthStencilView* pDSV = nullptr;
-    g_pd3dDevice->CreateDepthStencilView(pDepthStencil, nullptr, &pDSV);
-    g_pImmediateContext->OMSetRenderTargets(1, &g_pRenderTargetView, pDSV);
-    g_pImmediateContext->ClearDepthStencilView(pDSV, D3D11_CLEAR_DEPTH, 1.0f, 0);
-
     // Update constant buffer
     ConstantBuffer cb;
     cb.mWorld = XMMatrixTranspose(world);
     cb.mView = XMMatrixTranspose(view);
     cb.mProjection = XMMatrixTranspose(projection);
-    g_pImmediateContext->UpdateSubresource(g_pConstantBuffer, 0, nullptr, &cb, 0, 0);
 
-    // Set vertex buffer
-    UINT stride = sizeof(Vertex);
-    UINT offset = 0;
-    g_pImmediateContext->IASetVertexBuffers(0, 1, &g_pVertexBuffer, &stride, &offset);
-    g_pImmediateContext->IASetIndexBuffer(g_pIndexBuffer, DXGI_FORMAT_R16_UINT, 0);
-    g_pImmediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    BoardRenderer::Camera camera;
+    XMStoreFloat4x4(&camera.view, cb.mView);
+    XMStoreFloat4x4(&camera.projection, cb.mProjection);
+    boardRenderer.SetCamera(camera);
+    boardRenderer.BeginFrame();
 
-    // Set shaders and constant buffers
-    g_pImmediateContext->VSSetShader(g_pVertexShader, nullptr, 0);
-    g_pImmediateContext->VSSetConstantBuffers(0, 1, &g_pConstantBuffer);
-    g_pImmediateContext->PSSetShader(g_pPixelShader, nullptr, 0);
-    g_pImmediateContext->IASetInputLayout(g_pVertexLayout);
-
-    // Render game grid
-    for (int x = 0; x < GRID_WIDTH; x++) {
-        for (int y = 0; y < GRID_HEIGHT; y++) {
-            for (int z = 0; z < GRID_DEPTH; z++) {
-                if (g_gameGrid[x][y][z]) {
-                    world = XMMatrixTranslation(
-                        x - GRID_WIDTH/2.0f,
-                        y,
-                        z - GRID_DEPTH/2.0f
-                    );
-                    cb.mWorld = XMMatrixTranspose(world);
-                    g_pImmediateContext->UpdateSubresource(g_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-                    g_pImmediateContext->DrawIndexed(36, 0, 0);
-                }
-            }
-        }
-    }
+    // Set pipeline (shaders, depth state, topology)
+    backend.SetPipeline(resources.pipeline);
+    backend.SetConstantBuffer(0, resources.constantBuffer);
+    return cb;
+}
 
+// Draws the falling piece as one instanced batch and presents the frame
+static void EndBlockFrame(RenderBackend& backend, BoardRenderer& boardRenderer) {
     // Render current piece
-    for (const auto& block : g_currentPiece.blocks) {
-        world = XMMatrixTranslation(
-            g_currentPiece.position.x + block.x - GRID_WIDTH/2.0f,
-            g_currentPiece.position.y + block.y,
-            g_currentPiece.position.z + block.z - GRID_DEPTH/2.0f
-        );
-        cb.mWorld = XMMatrixTranspose(world);
-        g_pImmediateContext->UpdateSubresource(g_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-        g_pImmediateContext->DrawIndexed(36, 0, 0);
+    boardRenderer.SubmitBlocks(g_currentPiece.blocks, g_currentPiece.position, g_currentPiece.color,
+                               BoardRenderer::Style::Solid);
+    boardRenderer.EndFrame();
+
+    // Present the frame
+    backend.EndFrame();
+}
+
+void Render(RenderBackend& backend, const BlockRenderResources& resources, BoardRenderer& boardRenderer,
+            const GridMesher& gridMesher) {
+    ConstantBuffer cb = BeginBlockFrame(backend, resources, boardRenderer);
+
+    // Render game grid: the mesher's quads are already in world space, so
+    // the whole grid is one draw with the identity world matrix
+    backend.UpdateBufferFrom(resources.constantBuffer, cb);
+    const std::span<GridMesher::Vertex> gridVertices =
+        backend.MapAs<GridMesher::Vertex>(resources.gridVertexBuffer, MapMode::WriteDiscard);
+    const uint32_t gridQuads = gridMesher.WriteVertices(gridVertices);
+    backend.Unmap(resources.gridVertexBuffer);
+    if (gridQuads > 0) {
+        backend.SetVertexBuffer(0, resources.gridVertexBuffer, sizeof(GridMesher::Vertex));
+        backend.SetIndexBuffer(resources.gridIndexBuffer, IndexFormat::UInt16);
+        backend.DrawIndexed(gridQuads * 6);
     }
 
-    // Cleanup depth stencil resources
-    if (pDSV) pDSV->Release();
-    if (pDepthStencil) pDepthStencil->Release();
-    if (pDSState) pDSState->Release();
+    EndBlockFrame(backend, boardRenderer);
+}
 
-    // Present the frame
-    g_pSwapChain->Present(0, 0);
-}
\ No newline at end of file
+// Every cube, locked or falling, as an instance; only the layers `state`
+// changed since the last frame are re-uploaded
+void Render(RenderBackend& backend, const BlockRenderResources& resources, BoardRenderer& boardRenderer,
+            const GameState& state) {
+    BeginBlockFrame(backend, resources, boardRenderer);
+    boardRenderer.SubmitGrid(state);
+    EndBlockFrame(backend, boardRenderer);
+}
+
+// Alternative grid path: only faces that changed since the last frame are
+// uploaded, and each layer is drawn from its slice at its height
+void Render(RenderBackend& backend, const BlockRenderResources& resources, BoardRenderer& boardRenderer,
+            BoardFaceMesh& faceMesh) {
+    ConstantBuffer cb = BeginBlockFrame(backend, resources, boardRenderer);
+
+    faceMesh.Upload(backend, resources.faceVertexBuffer);
+    backend.SetVertexBuffer(0, resources.faceVertexBuffer, sizeof(BoardFaceMesh::Vertex));
+    backend.SetIndexBuffer(resources.gridIndexBuffer, IndexFormat::UInt16);
+    for (int y = 0; y < GRID_HEIGHT; y++) {
+        const BoardFaceMesh::LayerRange range = faceMesh.GetLayerRange(y);
+        if (range.quadCount == 0) continue;
+        cb.mWorld = XMMatrixTranspose(XMMatrixTranslation(0.0f, float(y), 0.0f));
+        backend.UpdateBufferFrom(resources.constantBuffer, cb);
+        backend.DrawIndexed(range.quadCount * 6, 0, static_cast<int32_t>(range.firstQuad * 4));
+    }
+
+    EndBlockFrame(backend, boardRenderer);
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// The slice of a graphics API the renderers use: buffers, pipeline state,
+// maps and draws. D3D11RenderBackend drives the GPU; NullRenderBackend
+// records the calls instead, so everything that builds a frame (culling,
+// sorting, instance packing) runs and can be measured without one.
+//
+// Resources are plain handles; 0 is never a valid one.
+enum class BufferHandle : uint32_t { Invalid = 0 };
+enum class PipelineHandle : uint32_t { Invalid = 0 };
+
+enum class BufferKind : uint8_t {
+    Vertex,   // per-vertex or per-instance data
+    Index,
+    Constant
+};
+
+enum class BufferUsage : uint8_t {
+    Immutable, // contents fixed at creation
+    Default,   // replaced with UpdateBuffer
+    Dynamic    // written through Map every frame
+};
+
+struct BufferDesc {
+    BufferKind kind = BufferKind::Vertex;
+    BufferUsage usage = BufferUsage::Dynamic;
+    uint32_t byteWidth = 0;
+    uint32_t stride = 0; // bytes per element, 0 for constant buffers
+};
+
+enum class BlendMode : uint8_t { Opaque, Alpha, Additive };
+enum class DepthMode : uint8_t { Disabled, TestOnly, TestWrite };
+enum class Topology : uint8_t { TriangleList, TriangleStrip, LineList, PointList };
+enum class IndexFormat : uint8_t { UInt16, UInt32 };
+enum class MapMode : uint8_t { WriteDiscard, WriteNoOverwrite };
+
+struct PipelineDesc {
+    uint32_t shader = 0; // program id the backend was given, e.g. by ShaderSystem
+    BlendMode blend = BlendMode::Opaque;
+    DepthMode depth = DepthMode::TestWrite;
+    Topology topology = Topology::TriangleList;
+};
+
+struct ClearDesc {
+    std::array<float, 4> color = {0.0f, 0.2f, 0.4f, 1.0f};
+    float depth = 1.0f;
+};
+
+class RenderBackend {
+public:
+    virtual ~RenderBackend() = default;
+
+    // Returns BufferHandle::Invalid on failure. Immutable buffers need
+    // `initialData`; for the others it is optional.
+    virtual BufferHandle CreateBuffer(const BufferDesc& desc, std::span<const std::byte> initialData = {}) = 0;
+    virtual void DestroyBuffer(BufferHandle buffer) = 0;
+    virtual PipelineHandle CreatePipeline(const PipelineDesc& desc) = 0;
+    virtual void DestroyPipeline(PipelineHandle pipeline) = 0;
+
+    // Write access to a Dynamic buffer until Unmap; empty on failure
+    virtual std::span<std::byte> Map(BufferHandle buffer, MapMode mode) = 0;
+    virtual void Unmap(BufferHandle buffer) = 0;
+    // Replaces `data.size()` bytes of a Default buffer starting at
+    // `offset`; constant buffers are always replaced whole from 0
+    virtual void UpdateBuffer(BufferHandle buffer, std::span<const std::byte> data, uint32_t offset = 0) = 0;
+
+    // Clears the back buffer and depth; EndFrame presents
+    virtual void BeginFrame(const ClearDesc& clear) = 0;
+    virtual void EndFrame() = 0;
+
+    virtual void SetPipeline(PipelineHandle pipeline) = 0;
+    virtual void SetVertexBuffer(uint32_t slot, BufferHandle buffer, uint32_t stride, uint32_t offset = 0) = 0;
+    virtual void SetIndexBuffer(BufferHandle buffer, IndexFormat format) = 0;
+    virtual void SetConstantBuffer(uint32_t slot, BufferHandle buffer) = 0; // every shader stage
+
+    virtual void Draw(uint32_t vertexCount, uint32_t firstVertex = 0) = 0;
+    virtual void DrawInstanced(uint32_t vertexCount, uint32_t instanceCount,
+                               uint32_t firstVertex = 0, uint32_t firstInstance = 0) = 0;
+    virtual void DrawIndexed(uint32_t indexCount, uint32_t firstIndex = 0, int32_t baseVertex = 0) = 0;
+    virtual void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex = 0,
+                                      int32_t baseVertex = 0, uint32_t firstInstance = 0) = 0;
+
+    // Typed views over the calls above
+    template<typename T>
+    std::span<T> MapAs(BufferHandle buffer, MapMode mode) {
+        const std::span<std::byte> bytes = Map(buffer, mode);
+        return {reinterpret_cast<T*>(bytes.data()), bytes.size() / sizeof(T)};
+    }
+
+    template<typename T>
+    void UpdateBufferFrom(BufferHandle buffer, const T& value) {
+        UpdateBuffer(buffer, std::as_bytes(std::span<const T>(&value, 1)));
+    }
+};
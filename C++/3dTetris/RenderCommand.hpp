@@ -0,0 +1,81 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <span>
+#include <utility>
+
+// Draw command recorded by RenderPipeline::Submit. Kept free of any graphics
+// API so sorting and batching can be benchmarked headless.
+struct RenderCommand {
+    uint64_t sortKey;
+    uint32_t meshId;
+    uint32_t materialId;
+    uint32_t instanceOffset;
+    uint32_t instanceCount;
+};
+
+struct RenderSortConfig {
+    static constexpr uint32_t DIGIT_BITS = 8;
+    static constexpr uint32_t BUCKETS = 1u << DIGIT_BITS;
+    static constexpr uint32_t PASSES = 64 / DIGIT_BITS;
+    static constexpr size_t RADIX_THRESHOLD = 64; // fewer commands are sorted by comparison
+};
+
+// Orders commands to minimize state changes (see RenderPipeline::CalculateSortKey).
+// An LSD radix sort over the key's bytes, stable, with the ping-pong copy
+// taken from `scratch`. Every byte's histogram is built in one read, and a
+// byte that is the same for the whole batch (the high pipeline and shader
+// bytes usually are) costs no pass.
+inline void SortRenderCommands(std::span<RenderCommand> commands,
+                               std::pmr::memory_resource* scratch = std::pmr::get_default_resource()) {
+    const size_t count = commands.size();
+    if (count < RenderSortConfig::RADIX_THRESHOLD) {
+        // Insertion sort: stable, like the radix path, and needs no scratch
+        for (size_t i = 1; i < count; ++i) {
+            const RenderCommand command = commands[i];
+            size_t j = i;
+            for (; j > 0 && commands[j - 1].sortKey > command.sortKey; --j) commands[j] = commands[j - 1];
+            commands[j] = command;
+        }
+        return;
+    }
+
+    std::array<std::array<uint32_t, RenderSortConfig::BUCKETS>, RenderSortConfig::PASSES> histograms = {};
+    for (const RenderCommand& command : commands) {
+        uint64_t key = command.sortKey;
+        for (auto& histogram : histograms) {
+            ++histogram[key & (RenderSortConfig::BUCKETS - 1)];
+            key >>= RenderSortConfig::DIGIT_BITS;
+        }
+    }
+
+    const size_t bytes = count * sizeof(RenderCommand);
+    auto* buffer = static_cast<RenderCommand*>(scratch->allocate(bytes, alignof(RenderCommand)));
+    RenderCommand* src = commands.data();
+    RenderCommand* dst = buffer;
+
+    for (uint32_t pass = 0; pass < RenderSortConfig::PASSES; ++pass) {
+        auto& histogram = histograms[pass];
+        const uint32_t shift = pass * RenderSortConfig::DIGIT_BITS;
+        if (histogram[(src[0].sortKey >> shift) & (RenderSortConfig::BUCKETS - 1)] == count) {
+            continue; // every key has the same byte here
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t& bucket : histogram) {
+            const uint32_t size = bucket;
+            bucket = offset;
+            offset += size;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            dst[histogram[(src[i].sortKey >> shift) & (RenderSortConfig::BUCKETS - 1)]++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+
+    // An odd number of passes leaves the result in the scratch copy
+    if (src != commands.data()) std::memcpy(commands.data(), src, bytes);
+    scratch->deallocate(buffer, bytes, alignof(RenderCommand));
+}
@@ -1,10 +1,30 @@
 #pragma once
-#include <DirectXMath.h>
+#include "MathTypes.hpp"
 #include <vector>
+#include <algorithm>
 #include <array>
 #include <span>
+#include <cassert>
+#include <cstring>
+#include <memory>
 #include <memory_resource>
+#include "JobSystem.hpp"
+#include "RenderBackend.hpp"
+#include "RenderCommand.hpp"
 
+using namespace DirectX;
+
+// Instanced draws recorded during the frame, sorted by state and issued
+// in EndFrame from one instance buffer.
+//
+// Recording goes into buckets: a producer running on its own thread takes
+// a bucket no one else writes to, so producers never contend. Inside a
+// ParallelFor that is JobSystem::ThreadIndex(), not the chunk index. EndFrame lays the buckets end to end by a prefix sum of
+// their sizes and copies them into the instance buffer in parallel.
+//
+// Content that rarely changes (the locked board) lives in static ranges
+// instead: fixed slices of a persistent Default buffer, uploaded only when
+// their instances change and drawn by SubmitStatic without copying.
 class RenderPipeline {
 public:
     // Structured buffer for instance data
@@ -14,155 +34,333 @@ public:
         XMFLOAT4 userData;
     };
 
-    // Command sorting and batching
-    struct RenderCommand {
-        uint64_t sortKey;
-        uint32_t meshId;
-        uint32_t materialId;
-        uint32_t instanceOffset;
-        uint32_t instanceCount;
+    // Geometry shared by every instance drawn with it
+    struct Mesh {
+        BufferHandle vertices;
+        BufferHandle indices;
+        uint32_t vertexStride;
+        uint32_t indexCount;
+        IndexFormat indexFormat = IndexFormat::UInt16;
     };
 
+    // Pipeline state and shader for a set of instances; materials that
+    // share a pipeline and shader are drawn next to each other
+    struct Material {
+        PipelineHandle pipeline;
+        uint16_t shaderId;
+    };
+
+    // Command sorting and batching
+    using RenderCommand = ::RenderCommand;
+
     static constexpr size_t MAX_INSTANCES_PER_BATCH = 1024;
+    static constexpr size_t MAX_INSTANCES_PER_FRAME = 64 * 1024; // further instances are dropped
     static constexpr size_t FRAME_COUNT = 3; // Triple buffering
+    static constexpr uint32_t INSTANCE_SLOT = 1; // vertex buffer slot of the instance stream
+    static constexpr size_t RESERVED_COMMANDS = 4096; // per frame; larger frames grow the list and sort on the heap
+    static constexpr size_t FRAME_SCRATCH_BYTES = RESERVED_COMMANDS * sizeof(RenderCommand);
+    static constexpr uint32_t MAX_BUCKETS = JobSystem::JobConfig::MAX_WORKERS + 1; // a ParallelFor's threads
+    static constexpr uint32_t MERGE_CHUNK = 4096; // instances copied per job in EndFrame
+    static constexpr uint32_t MAX_STATIC_INSTANCES = 4096; // across every static range
+    static constexpr uint32_t MAX_STATIC_RANGES = 256;
+    static constexpr uint32_t INVALID_RANGE = ~0u;
+
+    explicit RenderPipeline(RenderBackend& backend)
+        : m_backend(backend)
+        , m_currentFrame(0)
+        , m_frameScratch(std::make_unique<std::byte[]>(FRAME_COUNT * FRAME_SCRATCH_BYTES))
+        , m_frameAllocator{MakeFrameAllocator(0), MakeFrameAllocator(1), MakeFrameAllocator(2)} {
 
-    RenderPipeline(ID3D11Device* device, ID3D11DeviceContext* context)
-        : m_device(device)
-        , m_context(context)
-        , m_currentFrame(0) {
-        
         CreateBuffers();
     }
 
+    ~RenderPipeline() {
+        for (BufferHandle buffer : m_instanceBuffers) {
+            m_backend.DestroyBuffer(buffer);
+        }
+        m_backend.DestroyBuffer(m_staticInstanceBuffer);
+    }
+
+    RenderPipeline(const RenderPipeline&) = delete;
+    RenderPipeline& operator=(const RenderPipeline&) = delete;
+
+    // Ids for Submit; they are part of the sort key, so at most 64k of each
+    uint32_t AddMesh(const Mesh& mesh) {
+        m_meshes.push_back(mesh);
+        return static_cast<uint32_t>(m_meshes.size() - 1);
+    }
+
+    uint32_t AddMaterial(const Material& material) {
+        m_materials.push_back(material);
+        return static_cast<uint32_t>(m_materials.size() - 1);
+    }
+
+    // Reserves `capacity` instances of the static buffer for draws of
+    // `meshId` with `materialId`; returns INVALID_RANGE when it is full
+    uint32_t AddStaticRange(uint32_t meshId, uint32_t materialId, uint32_t capacity) {
+        if (m_staticRanges.size() >= MAX_STATIC_RANGES || capacity > MAX_STATIC_INSTANCES - m_staticInstanceCount) {
+            return INVALID_RANGE;
+        }
+        m_staticRanges.push_back({meshId, materialId, m_staticInstanceCount, capacity, 0});
+        m_staticInstanceCount += capacity;
+        return static_cast<uint32_t>(m_staticRanges.size() - 1);
+    }
+
+    // Replaces a range's instances (up to its capacity) and uploads them;
+    // returns the bytes sent
+    uint32_t UpdateStaticRange(uint32_t range, std::span<const InstanceData> instances) {
+        StaticRange& r = m_staticRanges[range];
+        instances = instances.first(std::min<size_t>(instances.size(), r.capacity));
+        r.count = static_cast<uint32_t>(instances.size());
+        if (instances.empty()) return 0;
+        m_backend.UpdateBuffer(m_staticInstanceBuffer, std::as_bytes(instances),
+                               static_cast<uint32_t>(r.first * sizeof(InstanceData)));
+        return static_cast<uint32_t>(instances.size_bytes());
+    }
+
+    // Draws a static range's current instances this frame; call from the
+    // thread that calls EndFrame
+    void SubmitStatic(uint32_t range) {
+        const StaticRange& r = m_staticRanges[range];
+        if (r.count == 0) return;
+        m_staticCommands.push_back({
+            CalculateSortKey(m_materials[r.materialId], r.materialId, r.meshId),
+            r.meshId,
+            r.materialId,
+            r.first | STATIC_INSTANCE,
+            r.count
+        });
+    }
+
     void BeginFrame() {
         m_currentFrame = (m_currentFrame + 1) % FRAME_COUNT;
         m_commands[m_currentFrame].clear();
-        m_instanceData[m_currentFrame].clear();
-        
+        m_staticCommands.clear();
+        for (Bucket& bucket : m_buckets) {
+            bucket.commands.clear();
+            bucket.instances.clear();
+        }
+
         // Reset memory pools
         m_frameAllocator[m_currentFrame].release();
     }
 
-    template<typename T>
-    void Submit(const MeshView<T>& mesh,
-               const Material& material,
-               std::span<const InstanceData> instances) {
-        
+    // Records into `bucket` (< MAX_BUCKETS, else dropped); calls for
+    // different buckets may run concurrently
+    void Submit(uint32_t meshId, uint32_t materialId, std::span<const InstanceData> instances, uint32_t bucket = 0) {
+        assert(bucket < MAX_BUCKETS && "one bucket per thread; see JobSystem::ThreadIndex");
+        if (bucket >= MAX_BUCKETS) return;
+        auto& instanceData = m_buckets[bucket].instances;
+        auto& commands = m_buckets[bucket].commands;
+        instances = instances.first(std::min(instances.size(), MAX_INSTANCES_PER_FRAME - instanceData.size()));
+        const uint64_t sortKey = CalculateSortKey(m_materials[materialId], materialId, meshId);
+
         // Split into batches if needed
-        for (size_t offset = 0; offset < instances.size(); 
+        for (size_t offset = 0; offset < instances.size();
              offset += MAX_INSTANCES_PER_BATCH) {
-            
+
             size_t batchSize = std::min(
                 MAX_INSTANCES_PER_BATCH,
                 instances.size() - offset
             );
 
-            // Add instances to buffer
-            size_t instanceOffset = m_instanceData[m_currentFrame].size();
-            m_instanceData[m_currentFrame].insert(
-                m_instanceData[m_currentFrame].end(),
+            // Add instances to the bucket; offsets are bucket-local until
+            // EndFrame merges
+            size_t instanceOffset = instanceData.size();
+            instanceData.insert(
+                instanceData.end(),
                 instances.begin() + offset,
                 instances.begin() + offset + batchSize
             );
 
             // Create render command
-            uint64_t sortKey = CalculateSortKey(material, mesh);
-            m_commands[m_currentFrame].push_back({
+            commands.push_back({
                 sortKey,
-                mesh.GetId(),
-                material.GetId(),
+                meshId,
+                materialId,
                 static_cast<uint32_t>(instanceOffset),
                 static_cast<uint32_t>(batchSize)
             });
         }
     }
 
-    void EndFrame() {
+    // Merges the buckets, sorts and draws; `jobs` spreads the instance copy
+    void EndFrame(JobSystem* jobs = nullptr) {
+        // Each bucket's place in the merged arrays; instances past
+        // MAX_INSTANCES_PER_FRAME are dropped
+        std::array<uint32_t, MAX_BUCKETS + 1> instanceBase;
+        std::array<uint32_t, MAX_BUCKETS + 1> commandBase;
+        instanceBase[0] = 0;
+        commandBase[0] = 0;
+        for (uint32_t b = 0; b < MAX_BUCKETS; ++b) {
+            const size_t instances = std::min(m_buckets[b].instances.size(), MAX_INSTANCES_PER_FRAME - instanceBase[b]);
+            instanceBase[b + 1] = instanceBase[b] + static_cast<uint32_t>(instances);
+            commandBase[b + 1] = commandBase[b] + static_cast<uint32_t>(m_buckets[b].commands.size());
+        }
+        const uint32_t instanceCount = instanceBase[MAX_BUCKETS];
+        const uint32_t staticBase = commandBase[MAX_BUCKETS];
+        if (staticBase + m_staticCommands.size() == 0) return;
+
+        auto& commands = m_commands[m_currentFrame];
+        commands.resize(staticBase + m_staticCommands.size());
+        std::copy(m_staticCommands.begin(), m_staticCommands.end(), commands.begin() + staticBase);
+        for (uint32_t b = 0; b < MAX_BUCKETS; ++b) {
+            const uint32_t kept = instanceBase[b + 1] - instanceBase[b];
+            RenderCommand* out = commands.data() + commandBase[b];
+            for (const RenderCommand& cmd : m_buckets[b].commands) {
+                *out = cmd;
+                out->instanceOffset += instanceBase[b];
+                out->instanceCount = std::min(cmd.instanceCount, kept - std::min(kept, cmd.instanceOffset));
+                ++out;
+            }
+        }
+
         // Sort commands for optimal rendering
-        std::sort(m_commands[m_currentFrame].begin(),
-                 m_commands[m_currentFrame].end(),
-                 [](const RenderCommand& a, const RenderCommand& b) {
-                     return a.sortKey < b.sortKey;
-                 });
-
-        // Update instance buffer
-        D3D11_MAPPED_SUBRESOURCE mapped;
-        m_context->Map(m_instanceBuffers[m_currentFrame].Get(), 
-                      0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
-        
-        memcpy(mapped.pData,
-               m_instanceData[m_currentFrame].data(),
-               m_instanceData[m_currentFrame].size() * sizeof(InstanceData));
-        
-        m_context->Unmap(m_instanceBuffers[m_currentFrame].Get(), 0);
+        SortRenderCommands(commands, &m_frameAllocator[m_currentFrame]);
+
+        // Update instance buffer: each chunk of the merged range copies from
+        // the buckets it overlaps. A frame of static draws alone sends nothing.
+        const BufferHandle instanceBuffer = m_instanceBuffers[m_currentFrame];
+        if (instanceCount > 0) {
+            const std::span<std::byte> mapped = m_backend.Map(instanceBuffer, MapMode::WriteDiscard);
+            if (mapped.size() < instanceCount * sizeof(InstanceData)) {
+                if (!mapped.empty()) m_backend.Unmap(instanceBuffer);
+                return;
+            }
+            auto* dst = reinterpret_cast<InstanceData*>(mapped.data());
+            auto copy = [&](uint32_t, uint32_t begin, uint32_t end) {
+                uint32_t b = static_cast<uint32_t>(
+                    std::upper_bound(instanceBase.begin(), instanceBase.end(), begin) - instanceBase.begin()) - 1;
+                for (uint32_t i = begin; i < end; ++b) {
+                    const uint32_t last = std::min(end, instanceBase[b + 1]);
+                    if (last == i) continue; // empty bucket
+                    std::memcpy(dst + i, m_buckets[b].instances.data() + (i - instanceBase[b]),
+                                (last - i) * sizeof(InstanceData));
+                    i = last;
+                }
+            };
+            if (jobs) {
+                jobs->ParallelFor(instanceCount, MERGE_CHUNK, copy);
+            } else {
+                copy(0, 0, instanceCount);
+            }
+            m_backend.Unmap(instanceBuffer);
+        }
 
         // Execute commands
         uint32_t currentMesh = ~0u;
         uint32_t currentMaterial = ~0u;
+        BufferHandle currentInstances = BufferHandle::Invalid;
+
+        for (const auto& cmd : commands) {
+            if (cmd.instanceCount == 0) continue;
+            const Mesh& mesh = m_meshes[cmd.meshId];
+
+            // Bind the instance stream the command reads
+            const bool isStatic = (cmd.instanceOffset & STATIC_INSTANCE) != 0;
+            const BufferHandle instances = isStatic ? m_staticInstanceBuffer : instanceBuffer;
+            if (instances != currentInstances) {
+                m_backend.SetVertexBuffer(INSTANCE_SLOT, instances, sizeof(InstanceData));
+                currentInstances = instances;
+            }
 
-        for (const auto& cmd : m_commands[m_currentFrame]) {
             // Bind mesh if changed
             if (cmd.meshId != currentMesh) {
-                BindMesh(cmd.meshId);
+                m_backend.SetVertexBuffer(0, mesh.vertices, mesh.vertexStride);
+                m_backend.SetIndexBuffer(mesh.indices, mesh.indexFormat);
                 currentMesh = cmd.meshId;
             }
 
             // Bind material if changed
             if (cmd.materialId != currentMaterial) {
-                BindMaterial(cmd.materialId);
+                m_backend.SetPipeline(m_materials[cmd.materialId].pipeline);
                 currentMaterial = cmd.materialId;
             }
 
             // Draw instances
-            m_context->DrawIndexedInstanced(
-                GetMeshIndexCount(cmd.meshId),
+            m_backend.DrawIndexedInstanced(
+                mesh.indexCount,
                 cmd.instanceCount,
                 0,
                 0,
-                cmd.instanceOffset
+                cmd.instanceOffset & ~STATIC_INSTANCE
             );
         }
     }
 
 private:
-    ID3D11Device* m_device;
-    ID3D11DeviceContext* m_context;
+    RenderBackend& m_backend;
     uint32_t m_currentFrame;
 
+    std::vector<Mesh> m_meshes;
+    std::vector<Material> m_materials;
+
+    // What one producer recorded this frame; aligned so producers on
+    // different threads do not share a cache line
+    struct alignas(64) Bucket {
+        std::vector<RenderCommand> commands;
+        std::vector<InstanceData> instances;
+    };
+    std::array<Bucket, MAX_BUCKETS> m_buckets;
+
+    // Instances [first, first + count) of the static buffer, of at most
+    // `capacity`
+    struct StaticRange {
+        uint32_t meshId;
+        uint32_t materialId;
+        uint32_t first;
+        uint32_t capacity;
+        uint32_t count;
+    };
+    static constexpr uint32_t STATIC_INSTANCE = 1u << 31; // instanceOffset flag: read the static buffer
+    static_assert(MAX_STATIC_INSTANCES < STATIC_INSTANCE && MAX_INSTANCES_PER_FRAME < STATIC_INSTANCE);
+    BufferHandle m_staticInstanceBuffer = BufferHandle::Invalid;
+    std::vector<StaticRange> m_staticRanges;
+    uint32_t m_staticInstanceCount = 0; // reserved by AddStaticRange
+    std::vector<RenderCommand> m_staticCommands; // SubmitStatic since BeginFrame
+
     // Per-frame resources
-    std::array<ComPtr<ID3D11Buffer>, FRAME_COUNT> m_instanceBuffers;
-    std::array<std::vector<RenderCommand>, FRAME_COUNT> m_commands;
-    std::array<std::vector<InstanceData>, FRAME_COUNT> m_instanceData;
+    std::array<BufferHandle, FRAME_COUNT> m_instanceBuffers;
+    std::array<std::vector<RenderCommand>, FRAME_COUNT> m_commands; // merged
+    std::unique_ptr<std::byte[]> m_frameScratch; // FRAME_SCRATCH_BYTES per frame
     std::array<std::pmr::monotonic_buffer_resource, FRAME_COUNT> m_frameAllocator;
 
+    static_assert(FRAME_COUNT == 3, "m_frameAllocator is initialized one frame at a time");
+    std::pmr::monotonic_buffer_resource MakeFrameAllocator(size_t frame) {
+        return std::pmr::monotonic_buffer_resource(m_frameScratch.get() + frame * FRAME_SCRATCH_BYTES,
+                                                   FRAME_SCRATCH_BYTES);
+    }
+
     void CreateBuffers() {
-        D3D11_BUFFER_DESC desc = {};
-        desc.Usage = D3D11_USAGE_DYNAMIC;
-        desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-        desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-        desc.MiscFlags = 0;
-        desc.StructureByteStride = sizeof(InstanceData);
-        desc.ByteWidth = sizeof(InstanceData) * MAX_INSTANCES_PER_BATCH;
+        BufferDesc desc;
+        desc.kind = BufferKind::Vertex;
+        desc.usage = BufferUsage::Dynamic;
+        desc.stride = sizeof(InstanceData);
+        desc.byteWidth = static_cast<uint32_t>(sizeof(InstanceData) * MAX_INSTANCES_PER_FRAME);
 
         for (uint32_t i = 0; i < FRAME_COUNT; ++i) {
-            m_device->CreateBuffer(&desc, nullptr, &m_instanceBuffers[i]);
-            
-            // Initialize frame allocators
-            static constexpr size_t FRAME_MEMORY = 1024 * 1024; // 1MB per frame
-            m_frameAllocator[i] = std::pmr::monotonic_buffer_resource(
-                FRAME_MEMORY
-            );
+            m_instanceBuffers[i] = m_backend.CreateBuffer(desc);
+            m_commands[i].reserve(RESERVED_COMMANDS);
         }
+
+        desc.usage = BufferUsage::Default;
+        desc.byteWidth = static_cast<uint32_t>(sizeof(InstanceData) * MAX_STATIC_INSTANCES);
+        m_staticInstanceBuffer = m_backend.CreateBuffer(desc);
+        m_staticRanges.reserve(MAX_STATIC_RANGES);
+        m_staticCommands.reserve(MAX_STATIC_RANGES);
+        // The single-threaded path never grows; other buckets grow on
+        // first use
+        m_buckets[0].instances.reserve(MAX_INSTANCES_PER_FRAME);
     }
 
-    uint64_t CalculateSortKey(const Material& material, const MeshView<>& mesh) {
+    static uint64_t CalculateSortKey(const Material& material, uint32_t materialId, uint32_t meshId) {
         // Optimal sort key for minimizing state changes:
         // | PSO (16) | Shader (16) | Material (16) | Mesh (16) |
         uint64_t key = 0;
-        key |= uint64_t(material.GetPipelineId()) << 48;
-        key |= uint64_t(material.GetShaderId()) << 32;
-        key |= uint64_t(material.GetId()) << 16;
-        key |= uint64_t(mesh.GetId());
+        key |= uint64_t(static_cast<uint32_t>(material.pipeline) & 0xFFFF) << 48;
+        key |= uint64_t(material.shaderId) << 32;
+        key |= uint64_t(materialId & 0xFFFF) << 16;
+        key |= uint64_t(meshId & 0xFFFF);
         return key;
     }
-};
\ No newline at end of file
+};
@@ -0,0 +1,114 @@
+#pragma once
+#include "RenderBackend.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// FNV-1a over `size` bytes
+inline uint64_t HashDescBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Hash and equality of a descriptor by its bytes, for plain C structs such
+// as the D3D11_*_DESC types. Padding is hashed too, so zero the descriptor
+// (ZeroMemory) before setting its fields.
+template<typename Desc>
+struct BytewiseDescTraits {
+    static_assert(std::is_trivially_copyable_v<Desc>, "descriptors are compared byte for byte");
+
+    static uint64_t Hash(const Desc& desc) { return HashDescBytes(&desc, sizeof(Desc)); }
+    static bool Equal(const Desc& a, const Desc& b) { return std::memcmp(&a, &b, sizeof(Desc)) == 0; }
+};
+
+// PipelineDesc has padding, so it is hashed field by field
+struct PipelineDescTraits {
+    static uint64_t Hash(const PipelineDesc& desc) {
+        const uint64_t packed = uint64_t(desc.shader) << 24 | uint64_t(desc.blend) << 16 |
+                                uint64_t(desc.depth) << 8 | uint64_t(desc.topology);
+        return HashDescBytes(&packed, sizeof(packed));
+    }
+    static bool Equal(const PipelineDesc& a, const PipelineDesc& b) {
+        return a.shader == b.shader && a.blend == b.blend && a.depth == b.depth && a.topology == b.topology;
+    }
+};
+
+// Objects made from a descriptor (pipeline states, render targets) kept
+// for reuse: Acquire hands back the object created for an equal descriptor
+// and only calls the factory the first time. Objects live until evicted,
+// e.g. targets of the old size after a resize.
+//
+// Caches hold tens of entries, so lookup is a scan over the stored hashes
+// and a hit never allocates.
+template<typename Desc, typename Resource, typename Traits = BytewiseDescTraits<Desc>>
+class ResourceCache {
+public:
+    struct CacheStats {
+        uint32_t hits;
+        uint32_t misses;    // factory calls
+        uint32_t evictions;
+    };
+
+    // `create(desc, resource)` fills `resource` and returns false on
+    // failure, in which case nothing is cached and Acquire returns nullptr.
+    // The pointer stays valid until the next Acquire or eviction.
+    template<typename Create>
+    Resource* Acquire(const Desc& desc, Create&& create) {
+        const uint64_t hash = Traits::Hash(desc);
+        for (Entry& entry : m_entries) {
+            if (entry.hash == hash && Traits::Equal(entry.desc, desc)) {
+                ++m_stats.hits;
+                return std::addressof(entry.resource);
+            }
+        }
+
+        ++m_stats.misses;
+        Resource resource{};
+        if (!create(desc, resource)) return nullptr;
+        m_entries.push_back({hash, desc, std::move(resource)});
+        return std::addressof(m_entries.back().resource);
+    }
+
+    // Drops every entry whose descriptor matches `predicate`; returns how
+    // many were dropped
+    template<typename Predicate>
+    uint32_t EvictIf(Predicate&& predicate) {
+        uint32_t evicted = 0;
+        for (size_t i = 0; i < m_entries.size();) {
+            if (predicate(m_entries[i].desc)) {
+                if (i + 1 < m_entries.size()) m_entries[i] = std::move(m_entries.back());
+                m_entries.pop_back();
+                ++evicted;
+            } else {
+                ++i;
+            }
+        }
+        m_stats.evictions += evicted;
+        return evicted;
+    }
+
+    void Clear() {
+        m_stats.evictions += static_cast<uint32_t>(m_entries.size());
+        m_entries.clear();
+    }
+
+    size_t GetSize() const { return m_entries.size(); }
+    const CacheStats& GetStats() const { return m_stats; }
+
+private:
+    struct Entry {
+        uint64_t hash;
+        Desc desc;
+        Resource resource;
+    };
+
+    std::vector<Entry> m_entries;
+    CacheStats m_stats{};
+};
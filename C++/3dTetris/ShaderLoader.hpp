@@ -4,87 +4,11 @@
 #include <fstream>
 #include <sstream>
 #include <filesystem>
+#include "ShaderPreprocessor.hpp"
 
 class ShaderLoader {
 public:
-    struct ShaderPreprocessor {
-        static constexpr std::array<std::string_view, 2> INCLUDE_DIRECTIVES = {
-            "#include",
-            "#pragma include"
-        };
-
-        struct IncludeHandler {
-            std::filesystem::path basePath;
-            std::unordered_set<std::string> includedFiles;
-            
-            std::optional<std::string> ResolveInclude(
-                const std::string& includePath,
-                const std::filesystem::path& currentFile) {
-                
-                auto fullPath = ResolvePath(includePath, currentFile);
-                if (includedFiles.contains(fullPath.string())) {
-                    return std::nullopt; // Already included
-                }
-                
-                includedFiles.insert(fullPath.string());
-                return LoadFile(fullPath);
-            }
-
-            std::filesystem::path ResolvePath(
-                const std::string& includePath,
-                const std::filesystem::path& currentFile) {
-                if (includePath[0] == '/') {
-                    return basePath / includePath.substr(1);
-                }
-                return currentFile.parent_path() / includePath;
-            }
-        };
-
-        static std::string PreprocessShader(
-            const std::string& source,
-            const std::filesystem::path& sourcePath,
-            IncludeHandler& includeHandler) {
-            
-            std::stringstream output;
-            std::stringstream input(source);
-            std::string line;
-
-            while (std::getline(input, line)) {
-                bool isInclude = false;
-                std::string includePath;
-
-                for (const auto& directive : INCLUDE_DIRECTIVES) {
-                    if (line.starts_with(directive)) {
-                        isInclude = true;
-                        includePath = ExtractIncludePath(line);
-                        break;
-                    }
-                }
-
-                if (isInclude && !includePath.empty()) {
-                    if (auto included = includeHandler.ResolveInclude(
-                            includePath, sourcePath)) {
-                        output << *included << '\n';
-                    }
-                } else {
-                    output << line << '\n';
-                }
-            }
-
-            return output.str();
-        }
-
-    private:
-        static std::string ExtractIncludePath(const std::string& line) {
-            size_t start = line.find('"');
-            if (start == std::string::npos) return "";
-            
-            size_t end = line.find('"', start + 1);
-            if (end == std::string::npos) return "";
-            
-            return line.substr(start + 1, end - start - 1);
-        }
-    };
+    using ShaderPreprocessor = ::ShaderPreprocessor;
 
     struct ShaderCache {
         struct CacheEntry {
@@ -158,14 +82,14 @@ public:
         
         try {
             // Load source
-            auto source = LoadFile(path);
+            auto source = ShaderPreprocessor::LoadFile(path);
             if (!source) {
                 return "Failed to load shader file";
             }
 
             // Preprocess includes
-            IncludeHandler includeHandler{path.parent_path()};
-            auto preprocessed = PreprocessShader(*source, path, includeHandler);
+            ShaderPreprocessor::IncludeHandler includeHandler{path.parent_path()};
+            auto preprocessed = ShaderPreprocessor::PreprocessShader(*source, path, includeHandler);
 
             // Apply permutation defines
             auto finalSource = preprocessed + variant.macros;
@@ -211,14 +135,4 @@ public:
         }
     }
 
-private:
-    static std::optional<std::string> LoadFile(
-        const std::filesystem::path& path) {
-        std::ifstream file(path);
-        if (!file) return std::nullopt;
-
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        return buffer.str();
-    }
 };
\ No newline at end of file
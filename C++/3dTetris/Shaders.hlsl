@@ -74,6 +74,48 @@ float4 PS_Main(VS_OUTPUT input) : SV_Target {
     return float4(finalColor, input.Color.a);
 }
 
+// Instanced block shaders (BoardRenderer): per-vertex position and colour
+// in slot 0, RenderPipeline::InstanceData in slot 1
+cbuffer BlockCamera : register(b0) {
+    matrix BlockView;
+    matrix BlockProjection;
+}
+
+struct BlockVS_Input {
+    float3 Position : POSITION;
+    float4 Color : COLOR;
+    float4 World0 : INSTANCE_WORLD0;
+    float4 World1 : INSTANCE_WORLD1;
+    float4 World2 : INSTANCE_WORLD2;
+    float4 World3 : INSTANCE_WORLD3;
+    float4 InstanceColor : INSTANCE_COLOR;
+    float4 UserData : INSTANCE_DATA;
+};
+
+struct BlockVS_Output {
+    float4 Position : SV_POSITION;
+    float3 WorldPos : POSITION;
+    float4 Color : COLOR0;
+};
+
+BlockVS_Output VS_Instanced(BlockVS_Input input) {
+    BlockVS_Output output;
+    float4x4 world = float4x4(input.World0, input.World1, input.World2, input.World3);
+    float4 worldPos = mul(float4(input.Position, 1.0f), world);
+    output.WorldPos = worldPos.xyz;
+    output.Position = mul(worldPos, mul(BlockView, BlockProjection));
+    output.Color = input.Color * input.InstanceColor;
+    return output;
+}
+
+// Flat PS_Main diffuse, with the face normal taken from screen derivatives
+float4 PS_Block(BlockVS_Output input) : SV_Target {
+    float3 normal = normalize(cross(ddx(input.WorldPos), ddy(input.WorldPos)));
+    float3 lightDir = normalize(float3(1.0f, 1.0f, -1.0f));
+    float diffuseStrength = max(dot(normal, lightDir), 0.0f);
+    return float4((0.2f + 0.8f * diffuseStrength) * input.Color.rgb, input.Color.a);
+}
+
 // Particle vertex shader
 struct ParticleVS_Input {
     float3 Position : POSITION;
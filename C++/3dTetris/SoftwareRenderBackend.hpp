@@ -0,0 +1,658 @@
+#pragma once
+#include "RenderBackend.hpp"
+#include "RenderPipeline.hpp"
+#include "ParticleLanes.hpp"
+#include "JobSystem.hpp"
+#include <algorithm>
+#include <bit>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <memory_resource>
+#include <vector>
+
+// RenderBackend that rasterizes on the CPU into an RGBA8 + float depth
+// image, for thumbnails and golden images on machines without a GPU.
+//
+// Draws are transformed and set up as they are issued, and each triangle is
+// binned into the screen tiles it touches. EndFrame then runs one job per
+// tile: clear, then every binned triangle in submission order, eight pixels
+// at a time with ParticleLanes. Tiles own disjoint pixels, so workers never
+// share a cache line of the image and blending order is preserved.
+//
+// There is no shader compiler; a shader id registered with RegisterProgram
+// selects one of the built-in programs below.
+class SoftwareRenderBackend final : public RenderBackend {
+public:
+    struct SoftwareConfig {
+        static constexpr uint32_t TILE_SIZE = 64;  // pixels, a multiple of the 8 lanes
+        static constexpr uint32_t MAX_VERTEX_SLOTS = 4;
+        static constexpr float NEAR_W = 1e-3f;     // triangles with a vertex closer than this are dropped, not clipped
+        static constexpr float AMBIENT = 0.2f;     // Shaders.hlsl PS_Main lighting
+        static constexpr float DIFFUSE = 0.8f;
+        static constexpr size_t INITIAL_TRIANGLE_CAPACITY = 16 * 1024; // per frame, grows if exceeded
+    };
+
+    enum class Program : uint8_t {
+        // Indexed or plain triangles: float3 position at the start of each
+        // slot 0 vertex, RenderPipeline::InstanceData in
+        // RenderPipeline::INSTANCE_SLOT. Flat shaded with the PS_Main light;
+        // a float4 colour after the position, when the stride has room for
+        // one, tints the instance colour by the triangle's first vertex.
+        InstancedMesh,
+        // Points: a ParticleInstance per slot 0 vertex, drawn as a
+        // camera-facing square of side `size` rotated by `rotation`
+        Particles
+    };
+
+    // Constant buffer slot 0 for both programs: view and projection,
+    // transposed for HLSL as ParticleSystem uploads them
+    struct Camera {
+        XMFLOAT4X4 view;
+        XMFLOAT4X4 projection;
+    };
+
+    struct FrameStats {
+        uint32_t draws;
+        uint32_t skippedDraws;  // unregistered program, missing buffers or camera
+        uint32_t triangles;     // set up and binned
+        uint32_t culled;        // back facing, behind the camera or off screen
+        uint32_t binEntries;    // triangle-tile pairs rasterized
+    };
+
+    SoftwareRenderBackend(uint32_t width, uint32_t height, JobSystem* jobs = nullptr,
+                          std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : m_jobs(jobs), m_upstream(upstream) {
+        m_triangles.reserve(SoftwareConfig::INITIAL_TRIANGLE_CAPACITY);
+        Resize(width, height);
+    }
+
+    ~SoftwareRenderBackend() override { ReleaseDepth(); }
+
+    SoftwareRenderBackend(const SoftwareRenderBackend&) = delete;
+    SoftwareRenderBackend& operator=(const SoftwareRenderBackend&) = delete;
+
+    void RegisterProgram(uint32_t shader, Program program) {
+        if (shader >= m_programs.size()) m_programs.resize(shader + 1, NO_PROGRAM);
+        m_programs[shader] = static_cast<uint8_t>(program);
+    }
+
+    // Reallocates the image; call outside a frame
+    void Resize(uint32_t width, uint32_t height) {
+        ReleaseDepth();
+        m_width = width;
+        m_height = height;
+        m_stride = (width + 7) & ~7u;
+        m_tilesX = (width + SoftwareConfig::TILE_SIZE - 1) / SoftwareConfig::TILE_SIZE;
+        m_tilesY = (height + SoftwareConfig::TILE_SIZE - 1) / SoftwareConfig::TILE_SIZE;
+        m_color.assign(size_t(m_stride) * height, 0);
+        m_depth = static_cast<float*>(m_upstream->allocate(DepthBytes(), DEPTH_ALIGNMENT));
+        std::fill(m_depth, m_depth + size_t(m_stride) * height, 1.0f);
+        m_bins.resize(size_t(m_tilesX) * m_tilesY);
+    }
+
+    BufferHandle CreateBuffer(const BufferDesc& desc, std::span<const std::byte> initialData = {}) override {
+        if (desc.byteWidth == 0 || (desc.usage == BufferUsage::Immutable && initialData.empty())) {
+            return BufferHandle::Invalid;
+        }
+
+        uint32_t index;
+        if (!m_freeBuffers.empty()) {
+            index = m_freeBuffers.back();
+            m_freeBuffers.pop_back();
+        } else {
+            index = static_cast<uint32_t>(m_buffers.size());
+            m_buffers.emplace_back();
+        }
+
+        Buffer& buffer = m_buffers[index];
+        buffer.desc = desc;
+        buffer.data.assign(desc.byteWidth, std::byte{0});
+        if (!initialData.empty()) {
+            std::memcpy(buffer.data.data(), initialData.data(), std::min<size_t>(initialData.size(), desc.byteWidth));
+        }
+        buffer.live = true;
+        return static_cast<BufferHandle>(index + 1);
+    }
+
+    void DestroyBuffer(BufferHandle handle) override {
+        Buffer* buffer = Find(handle);
+        if (!buffer) return;
+        buffer->live = false;
+        buffer->data = {};
+        m_freeBuffers.push_back(static_cast<uint32_t>(handle) - 1);
+    }
+
+    PipelineHandle CreatePipeline(const PipelineDesc& desc) override {
+        m_pipelines.push_back(desc);
+        return static_cast<PipelineHandle>(m_pipelines.size());
+    }
+
+    void DestroyPipeline(PipelineHandle) override {
+        // Pipelines are plain descriptions; handles stay valid
+    }
+
+    std::span<std::byte> Map(BufferHandle handle, MapMode) override {
+        Buffer* buffer = Find(handle);
+        if (!buffer || buffer->desc.usage != BufferUsage::Dynamic) return {};
+        return buffer->data;
+    }
+
+    void Unmap(BufferHandle) override {}
+
+    void UpdateBuffer(BufferHandle handle, std::span<const std::byte> data, uint32_t offset = 0) override {
+        Buffer* buffer = Find(handle);
+        if (!buffer || buffer->desc.usage != BufferUsage::Default || offset > buffer->data.size() ||
+            data.size() > buffer->data.size() - offset || data.empty()) return;
+        std::memcpy(buffer->data.data() + offset, data.data(), data.size());
+    }
+
+    void BeginFrame(const ClearDesc& clear) override {
+        m_clearColor = PackColor(clear.color[0], clear.color[1], clear.color[2], clear.color[3]);
+        m_clearDepth = clear.depth;
+        m_triangles.clear();
+        for (auto& bin : m_bins) bin.clear();
+        m_stats = {};
+        m_hasPipeline = false;
+    }
+
+    // Rasterizes every tile; the image is complete when this returns
+    void EndFrame() override {
+        const auto rasterizeTiles = [this](uint32_t, uint32_t begin, uint32_t end) {
+            for (uint32_t tile = begin; tile < end; ++tile) RasterizeTile(tile);
+        };
+        const uint32_t tileCount = static_cast<uint32_t>(m_bins.size());
+        if (m_jobs) {
+            m_jobs->ParallelFor(tileCount, 1, rasterizeTiles);
+        } else {
+            rasterizeTiles(0, 0, tileCount);
+        }
+        for (const auto& bin : m_bins) m_stats.binEntries += static_cast<uint32_t>(bin.size());
+        m_lastStats = m_stats;
+        ++m_frameCount;
+    }
+
+    void SetPipeline(PipelineHandle handle) override {
+        const auto index = static_cast<uint32_t>(handle);
+        m_hasPipeline = index != 0 && index <= m_pipelines.size();
+        if (m_hasPipeline) m_pipeline = m_pipelines[index - 1];
+    }
+
+    void SetVertexBuffer(uint32_t slot, BufferHandle buffer, uint32_t stride, uint32_t offset = 0) override {
+        if (slot < SoftwareConfig::MAX_VERTEX_SLOTS) m_vertexStreams[slot] = {buffer, stride, offset};
+    }
+
+    void SetIndexBuffer(BufferHandle buffer, IndexFormat format) override {
+        m_indexBuffer = buffer;
+        m_indexFormat = format;
+    }
+
+    void SetConstantBuffer(uint32_t slot, BufferHandle buffer) override {
+        if (slot == 0) m_cameraBuffer = buffer;
+    }
+
+    void Draw(uint32_t vertexCount, uint32_t firstVertex = 0) override {
+        DrawInstanced(vertexCount, 1, firstVertex, 0);
+    }
+
+    void DrawInstanced(uint32_t vertexCount, uint32_t instanceCount,
+                       uint32_t firstVertex = 0, uint32_t firstInstance = 0) override {
+        Submit(vertexCount, instanceCount, firstVertex, 0, firstInstance, false);
+    }
+
+    void DrawIndexed(uint32_t indexCount, uint32_t firstIndex = 0, int32_t baseVertex = 0) override {
+        DrawIndexedInstanced(indexCount, 1, firstIndex, baseVertex, 0);
+    }
+
+    void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex = 0,
+                              int32_t baseVertex = 0, uint32_t firstInstance = 0) override {
+        Submit(indexCount, instanceCount, firstIndex, baseVertex, firstInstance, true);
+    }
+
+    uint32_t GetWidth() const { return m_width; }
+    uint32_t GetHeight() const { return m_height; }
+    // Pixels per image row, the width rounded up to the lane count
+    uint32_t GetStride() const { return m_stride; }
+    // R, G, B, A bytes in memory order; rows are GetStride() pixels apart
+    std::span<const uint32_t> GetColor() const { return m_color; }
+    std::span<const float> GetDepth() const { return {m_depth, size_t(m_stride) * m_height}; }
+    const FrameStats& GetLastFrameStats() const { return m_lastStats; }
+    uint64_t GetFrameCount() const { return m_frameCount; }
+
+    // Copies the last frame into `out` as tightly packed rows
+    void ReadPixels(std::span<uint32_t> out) const {
+        for (uint32_t y = 0; y < m_height && size_t(y + 1) * m_width <= out.size(); ++y) {
+            std::copy_n(&m_color[size_t(y) * m_stride], m_width, &out[size_t(y) * m_width]);
+        }
+    }
+
+    static uint32_t PackColor(float r, float g, float b, float a) {
+        const auto channel = [](float c) { return static_cast<uint32_t>(std::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f); };
+        return channel(r) | (channel(g) << 8) | (channel(b) << 16) | (channel(a) << 24);
+    }
+
+private:
+    static constexpr size_t DEPTH_ALIGNMENT = 64; // aligned lane loads at any row
+    static constexpr uint8_t NO_PROGRAM = 0xFF;
+
+    struct Buffer {
+        BufferDesc desc;
+        std::vector<std::byte> data;
+        bool live = false;
+    };
+
+    struct ColoredVertex {
+        XMFLOAT3 position;
+        XMFLOAT4 color;
+    };
+
+    struct VertexStream {
+        BufferHandle buffer = BufferHandle::Invalid;
+        uint32_t stride = 0;
+        uint32_t offset = 0;
+    };
+
+    // Row-vector matrix, v' = v * m as in DirectXMath
+    struct Matrix {
+        float m[4][4];
+
+        static Matrix FromTransposed(const XMFLOAT4X4& t) {
+            Matrix r;
+            const float* f = &t._11;
+            for (int row = 0; row < 4; ++row)
+                for (int col = 0; col < 4; ++col) r.m[row][col] = f[col * 4 + row];
+            return r;
+        }
+
+        static Matrix From(const XMFLOAT4X4& t) {
+            Matrix r;
+            std::memcpy(r.m, &t._11, sizeof(r.m));
+            return r;
+        }
+
+        Matrix operator*(const Matrix& b) const {
+            Matrix r;
+            for (int row = 0; row < 4; ++row)
+                for (int col = 0; col < 4; ++col)
+                    r.m[row][col] = m[row][0] * b.m[0][col] + m[row][1] * b.m[1][col] +
+                                    m[row][2] * b.m[2][col] + m[row][3] * b.m[3][col];
+            return r;
+        }
+
+        XMFLOAT4 Transform(float x, float y, float z, float w = 1.0f) const {
+            return {x * m[0][0] + y * m[1][0] + z * m[2][0] + w * m[3][0],
+                    x * m[0][1] + y * m[1][1] + z * m[2][1] + w * m[3][1],
+                    x * m[0][2] + y * m[1][2] + z * m[2][2] + w * m[3][2],
+                    x * m[0][3] + y * m[1][3] + z * m[2][3] + w * m[3][3]};
+        }
+    };
+
+    // A screen-space triangle ready for any tile. Edge i is
+    // a[i] * x + b[i] * y + c[i], positive inside; `bias` makes top-left
+    // edges inclusive so shared edges are drawn exactly once.
+    struct Triangle {
+        float a[3], b[3], c[3], bias[3];
+        float za, zb, zc;            // depth plane
+        int32_t minX, minY, maxX, maxY; // pixel bounds, max exclusive
+        float red, green, blue, alpha;
+        uint32_t packed;
+        BlendMode blend;
+        DepthMode depth;
+    };
+
+    JobSystem* m_jobs;
+    std::pmr::memory_resource* m_upstream;
+
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    uint32_t m_stride = 0;
+    uint32_t m_tilesX = 0;
+    uint32_t m_tilesY = 0;
+    std::vector<uint32_t> m_color;
+    float* m_depth = nullptr;
+    uint32_t m_clearColor = 0;
+    float m_clearDepth = 1.0f;
+
+    std::vector<Buffer> m_buffers;
+    std::vector<uint32_t> m_freeBuffers;
+    std::vector<PipelineDesc> m_pipelines;
+    std::vector<uint8_t> m_programs;
+
+    PipelineDesc m_pipeline;
+    bool m_hasPipeline = false;
+    std::array<VertexStream, SoftwareConfig::MAX_VERTEX_SLOTS> m_vertexStreams = {};
+    BufferHandle m_indexBuffer = BufferHandle::Invalid;
+    IndexFormat m_indexFormat = IndexFormat::UInt16;
+    BufferHandle m_cameraBuffer = BufferHandle::Invalid;
+
+    std::vector<Triangle> m_triangles;
+    std::vector<std::vector<uint32_t>> m_bins; // triangle indices per tile, row-major tiles
+    std::vector<XMFLOAT3> m_worldScratch;       // one instance's transformed vertices
+    std::vector<XMFLOAT4> m_clipScratch;
+
+    FrameStats m_stats = {};
+    FrameStats m_lastStats = {};
+    uint64_t m_frameCount = 0;
+
+    size_t DepthBytes() const { return sizeof(float) * size_t(m_stride) * m_height; }
+
+    void ReleaseDepth() {
+        if (m_depth) m_upstream->deallocate(m_depth, DepthBytes(), DEPTH_ALIGNMENT);
+        m_depth = nullptr;
+    }
+
+    Buffer* Find(BufferHandle handle) {
+        const auto index = static_cast<uint32_t>(handle);
+        if (index == 0 || index > m_buffers.size() || !m_buffers[index - 1].live) return nullptr;
+        return &m_buffers[index - 1];
+    }
+
+    // Element `i` of a bound stream, or nullptr past its end
+    template<typename T>
+    const T* Fetch(const VertexStream& stream, const Buffer& buffer, uint32_t i) const {
+        const size_t at = stream.offset + size_t(i) * stream.stride;
+        if (at + sizeof(T) > buffer.data.size()) return nullptr;
+        return reinterpret_cast<const T*>(buffer.data.data() + at);
+    }
+
+    void Submit(uint32_t count, uint32_t instanceCount, uint32_t first, int32_t baseVertex,
+                uint32_t firstInstance, bool indexed) {
+        ++m_stats.draws;
+        const Buffer* cameraBuffer = Find(m_cameraBuffer);
+        const uint8_t program = m_hasPipeline && m_pipeline.shader < m_programs.size()
+                                    ? m_programs[m_pipeline.shader] : NO_PROGRAM;
+        if (program == NO_PROGRAM || !cameraBuffer || cameraBuffer->data.size() < sizeof(Camera)) {
+            ++m_stats.skippedDraws;
+            return;
+        }
+
+        Camera camera;
+        std::memcpy(&camera, cameraBuffer->data.data(), sizeof(Camera));
+        const Matrix view = Matrix::FromTransposed(camera.view);
+        const Matrix projection = Matrix::FromTransposed(camera.projection);
+
+        if (static_cast<Program>(program) == Program::Particles) {
+            DrawParticles(view, projection, first, count);
+        } else if (m_pipeline.topology == Topology::TriangleList) {
+            DrawMesh(view * projection, count, instanceCount, first, baseVertex, firstInstance, indexed);
+        } else {
+            ++m_stats.skippedDraws;
+        }
+    }
+
+    void DrawMesh(const Matrix& viewProjection, uint32_t count, uint32_t instanceCount, uint32_t first,
+                  int32_t baseVertex, uint32_t firstInstance, bool indexed) {
+        const VertexStream& vertexStream = m_vertexStreams[0];
+        const VertexStream& instanceStream = m_vertexStreams[RenderPipeline::INSTANCE_SLOT];
+        const Buffer* vertices = Find(vertexStream.buffer);
+        const Buffer* instances = Find(instanceStream.buffer);
+        const Buffer* indices = indexed ? Find(m_indexBuffer) : nullptr;
+        if (!vertices || !instances || (indexed && !indices) || vertexStream.stride < sizeof(XMFLOAT3)) {
+            ++m_stats.skippedDraws;
+            return;
+        }
+
+        // Vertex i of the draw, or ~0u when it reads past a buffer
+        const uint32_t indexSize = m_indexFormat == IndexFormat::UInt16 ? 2 : 4;
+        const auto vertexOf = [&](uint32_t i) -> uint32_t {
+            if (!indexed) return first + i;
+            const size_t at = size_t(first + i) * indexSize;
+            if (at + indexSize > indices->data.size()) return ~0u;
+            uint32_t index = 0;
+            std::memcpy(&index, indices->data.data() + at, indexSize);
+            return static_cast<uint32_t>(int64_t(index) + baseVertex);
+        };
+
+        if (count < 3) return;
+
+        // Transform only the vertices the draw references, once per instance
+        uint32_t low = ~0u, high = 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            const uint32_t v = vertexOf(i);
+            if (v == ~0u || !Fetch<XMFLOAT3>(vertexStream, *vertices, v)) return;
+            low = std::min(low, v);
+            high = std::max(high, v);
+        }
+        m_worldScratch.resize(high - low + 1);
+        m_clipScratch.resize(high - low + 1);
+
+        const bool vertexColors = vertexStream.stride >= sizeof(XMFLOAT3) + sizeof(XMFLOAT4);
+        const XMFLOAT3 light = Normalize({1.0f, 1.0f, -1.0f});
+        for (uint32_t instance = firstInstance; instance < firstInstance + instanceCount; ++instance) {
+            const auto* data = Fetch<RenderPipeline::InstanceData>(instanceStream, *instances, instance);
+            if (!data) break;
+            const Matrix world = Matrix::From(data->world);
+            const Matrix worldViewProjection = world * viewProjection;
+
+            for (uint32_t v = low; v <= high; ++v) {
+                const XMFLOAT3& p = *Fetch<XMFLOAT3>(vertexStream, *vertices, v);
+                const XMFLOAT4 w = world.Transform(p.x, p.y, p.z);
+                m_worldScratch[v - low] = {w.x, w.y, w.z};
+                m_clipScratch[v - low] = worldViewProjection.Transform(p.x, p.y, p.z);
+            }
+
+            for (uint32_t i = 0; i + 2 < count; i += 3) {
+                const uint32_t v0 = vertexOf(i) - low, v1 = vertexOf(i + 1) - low, v2 = vertexOf(i + 2) - low;
+                const XMFLOAT3& p0 = m_worldScratch[v0];
+                const XMFLOAT3& p1 = m_worldScratch[v1];
+                const XMFLOAT3& p2 = m_worldScratch[v2];
+                const XMFLOAT3 normal = Normalize(Cross({p1.x - p0.x, p1.y - p0.y, p1.z - p0.z},
+                                                        {p2.x - p0.x, p2.y - p0.y, p2.z - p0.z}));
+                const float diffuse = std::max(normal.x * light.x + normal.y * light.y + normal.z * light.z, 0.0f);
+                const float shade = SoftwareConfig::AMBIENT + SoftwareConfig::DIFFUSE * diffuse;
+
+                XMFLOAT4 tint = data->color;
+                if (const auto* colored = vertexColors ? Fetch<ColoredVertex>(vertexStream, *vertices, v0 + low) : nullptr) {
+                    const XMFLOAT4& color = colored->color;
+                    tint = {tint.x * color.x, tint.y * color.y, tint.z * color.z, tint.w * color.w};
+                }
+
+                const XMFLOAT4 clip[3] = {m_clipScratch[v0], m_clipScratch[v1], m_clipScratch[v2]};
+                SetupTriangle(clip, tint.x * shade, tint.y * shade, tint.z * shade, tint.w, true);
+            }
+        }
+    }
+
+    void DrawParticles(const Matrix& view, const Matrix& projection, uint32_t first, uint32_t count) {
+        const VertexStream& stream = m_vertexStreams[0];
+        const Buffer* particles = Find(stream.buffer);
+        if (!particles) {
+            ++m_stats.skippedDraws;
+            return;
+        }
+
+        for (uint32_t i = first; i < first + count; ++i) {
+            const ParticleInstance* p = Fetch<ParticleInstance>(stream, *particles, i);
+            if (!p) break;
+
+            // Expand in view space like the particle geometry shader
+            const XMFLOAT4 center = view.Transform(p->position.x, p->position.y, p->position.z);
+            const float half = p->size * 0.5f;
+            const float c = std::cos(p->rotation) * half;
+            const float s = std::sin(p->rotation) * half;
+            const float dx[4] = {-c + s, c + s, c - s, -c - s};
+            const float dy[4] = {-s - c, s - c, s + c, -s + c};
+            XMFLOAT4 corners[4];
+            for (int k = 0; k < 4; ++k) {
+                corners[k] = projection.Transform(center.x + dx[k], center.y + dy[k], center.z);
+            }
+
+            const XMFLOAT4 lower[3] = {corners[0], corners[1], corners[2]};
+            const XMFLOAT4 upper[3] = {corners[0], corners[2], corners[3]};
+            SetupTriangle(lower, p->color.x, p->color.y, p->color.z, p->color.w, false);
+            SetupTriangle(upper, p->color.x, p->color.y, p->color.z, p->color.w, false);
+        }
+    }
+
+    void SetupTriangle(const XMFLOAT4 (&clip)[3], float r, float g, float b, float alpha, bool cullBack) {
+        if (clip[0].w < SoftwareConfig::NEAR_W || clip[1].w < SoftwareConfig::NEAR_W ||
+            clip[2].w < SoftwareConfig::NEAR_W) {
+            ++m_stats.culled;
+            return;
+        }
+
+        // Pixel coordinates, y down, pixel centres at +0.5
+        float x[3], y[3], z[3];
+        for (int i = 0; i < 3; ++i) {
+            const float invW = 1.0f / clip[i].w;
+            x[i] = (clip[i].x * invW * 0.5f + 0.5f) * m_width;
+            y[i] = (0.5f - clip[i].y * invW * 0.5f) * m_height;
+            z[i] = clip[i].z * invW;
+        }
+
+        // Clockwise on screen is front facing, as D3D11's default
+        float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+        if (area <= 0.0f) {
+            if (cullBack || area == 0.0f) {
+                ++m_stats.culled;
+                return;
+            }
+            std::swap(x[1], x[2]);
+            std::swap(y[1], y[2]);
+            std::swap(z[1], z[2]);
+            area = -area;
+        }
+
+        Triangle t;
+        t.minX = std::max(static_cast<int32_t>(std::floor(std::min({x[0], x[1], x[2]}))), 0);
+        t.minY = std::max(static_cast<int32_t>(std::floor(std::min({y[0], y[1], y[2]}))), 0);
+        t.maxX = std::min(static_cast<int32_t>(std::ceil(std::max({x[0], x[1], x[2]}))), static_cast<int32_t>(m_width));
+        t.maxY = std::min(static_cast<int32_t>(std::ceil(std::max({y[0], y[1], y[2]}))), static_cast<int32_t>(m_height));
+        if (t.minX >= t.maxX || t.minY >= t.maxY) {
+            ++m_stats.culled;
+            return;
+        }
+
+        for (int i = 0; i < 3; ++i) {
+            const int j = (i + 1) % 3;
+            t.a[i] = y[i] - y[j];
+            t.b[i] = x[j] - x[i];
+            t.c[i] = -(t.a[i] * x[i] + t.b[i] * y[i]);
+            const bool topLeft = t.a[i] > 0.0f || (t.a[i] == 0.0f && t.b[i] > 0.0f);
+            t.bias[i] = topLeft ? -FLT_MIN : 0.0f;
+        }
+
+        // Barycentric depth, each vertex weighted by the edge opposite it,
+        // folded into one plane over x and y
+        const float invArea = 1.0f / area;
+        t.za = (t.a[1] * z[0] + t.a[2] * z[1] + t.a[0] * z[2]) * invArea;
+        t.zb = (t.b[1] * z[0] + t.b[2] * z[1] + t.b[0] * z[2]) * invArea;
+        t.zc = (t.c[1] * z[0] + t.c[2] * z[1] + t.c[0] * z[2]) * invArea;
+
+        t.red = r;
+        t.green = g;
+        t.blue = b;
+        t.alpha = alpha;
+        t.packed = PackColor(r, g, b, alpha);
+        t.blend = m_pipeline.blend;
+        t.depth = m_pipeline.depth;
+
+        const uint32_t index = static_cast<uint32_t>(m_triangles.size());
+        m_triangles.push_back(t);
+        ++m_stats.triangles;
+        BinTriangle(t, index);
+    }
+
+    // Adds the triangle to every tile in its bounds that some part of it covers
+    void BinTriangle(const Triangle& t, uint32_t index) {
+        const uint32_t tile = SoftwareConfig::TILE_SIZE;
+        const uint32_t firstX = t.minX / tile, lastX = (t.maxX - 1) / tile;
+        const uint32_t firstY = t.minY / tile, lastY = (t.maxY - 1) / tile;
+        for (uint32_t ty = firstY; ty <= lastY; ++ty) {
+            for (uint32_t tx = firstX; tx <= lastX; ++tx) {
+                // Outside one edge at the tile corner where that edge is largest
+                bool outside = false;
+                for (int i = 0; i < 3 && !outside; ++i) {
+                    const float cornerX = float((t.a[i] > 0.0f ? tx + 1 : tx) * tile);
+                    const float cornerY = float((t.b[i] > 0.0f ? ty + 1 : ty) * tile);
+                    outside = t.a[i] * cornerX + t.b[i] * cornerY + t.c[i] < 0.0f;
+                }
+                if (!outside) m_bins[ty * m_tilesX + tx].push_back(index);
+            }
+        }
+    }
+
+    void RasterizeTile(uint32_t tile) {
+        using namespace ParticleLanes;
+        alignas(32) static constexpr float LANE_OFFSETS[8] = {0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f};
+
+        const int32_t tileX0 = static_cast<int32_t>((tile % m_tilesX) * SoftwareConfig::TILE_SIZE);
+        const int32_t tileY0 = static_cast<int32_t>((tile / m_tilesX) * SoftwareConfig::TILE_SIZE);
+        const int32_t tileX1 = std::min<int32_t>(tileX0 + SoftwareConfig::TILE_SIZE, m_stride);
+        const int32_t tileY1 = std::min<int32_t>(tileY0 + SoftwareConfig::TILE_SIZE, m_height);
+
+        for (int32_t y = tileY0; y < tileY1; ++y) {
+            std::fill(&m_color[size_t(y) * m_stride + tileX0], &m_color[size_t(y) * m_stride + tileX1], m_clearColor);
+            std::fill(&m_depth[size_t(y) * m_stride + tileX0], &m_depth[size_t(y) * m_stride + tileX1], m_clearDepth);
+        }
+
+        const F8 laneOffsets = Load(LANE_OFFSETS);
+        const F8 nearPlane = Splat(-FLT_MIN); // z >= 0
+        for (const uint32_t index : m_bins[tile]) {
+            const Triangle& t = m_triangles[index];
+            const int32_t x0 = std::max(t.minX, tileX0) & ~7;
+            const int32_t x1 = std::min(t.maxX, tileX1);
+            const int32_t y0 = std::max(t.minY, tileY0);
+            const int32_t y1 = std::min(t.maxY, tileY1);
+            const F8 a0 = Splat(t.a[0]), a1 = Splat(t.a[1]), a2 = Splat(t.a[2]);
+            const F8 bias0 = Splat(t.bias[0]), bias1 = Splat(t.bias[1]), bias2 = Splat(t.bias[2]);
+            const F8 za = Splat(t.za);
+
+            for (int32_t y = y0; y < y1; ++y) {
+                const float py = float(y) + 0.5f;
+                const F8 row0 = Splat(t.b[0] * py + t.c[0]);
+                const F8 row1 = Splat(t.b[1] * py + t.c[1]);
+                const F8 row2 = Splat(t.b[2] * py + t.c[2]);
+                const F8 rowZ = Splat(t.zb * py + t.zc);
+                uint32_t* colorRow = &m_color[size_t(y) * m_stride];
+                float* depthRow = &m_depth[size_t(y) * m_stride];
+
+                for (int32_t x = x0; x < x1; x += 8) {
+                    const F8 px = Splat(float(x)) + laneOffsets;
+                    F8 covered = Less(bias0, a0 * px + row0) & Less(bias1, a1 * px + row1) &
+                                 Less(bias2, a2 * px + row2);
+                    if (MoveMask(covered) == 0) continue;
+
+                    if (t.depth != DepthMode::Disabled) {
+                        const F8 z = za * px + rowZ;
+                        const F8 stored = Load(depthRow + x);
+                        covered = covered & Less(z, stored) & Less(nearPlane, z);
+                        if (t.depth == DepthMode::TestWrite) Store(depthRow + x, Select(covered, z, stored));
+                    }
+
+                    uint32_t mask = MoveMask(covered);
+                    if (t.blend == BlendMode::Opaque) {
+                        if (mask == 0xFF) {
+                            std::fill_n(colorRow + x, 8, t.packed);
+                            continue;
+                        }
+                        for (; mask; mask &= mask - 1) colorRow[x + std::countr_zero(mask)] = t.packed;
+                    } else {
+                        for (; mask; mask &= mask - 1) {
+                            uint32_t& pixel = colorRow[x + std::countr_zero(mask)];
+                            pixel = Blend(t, pixel);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    static uint32_t Blend(const Triangle& t, uint32_t destination) {
+        const float keep = t.blend == BlendMode::Additive ? 1.0f : 1.0f - t.alpha;
+        const auto channel = [&](float source, int shift) {
+            return source * t.alpha + float((destination >> shift) & 0xFF) * (1.0f / 255.0f) * keep;
+        };
+        return PackColor(channel(t.red, 0), channel(t.green, 8), channel(t.blue, 16), t.alpha);
+    }
+
+    static XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b) {
+        return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+    }
+
+    static XMFLOAT3 Normalize(const XMFLOAT3& v) {
+        const float length = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+        const float scale = length > 0.0f ? 1.0f / length : 0.0f;
+        return {v.x * scale, v.y * scale, v.z * scale};
+    }
+};
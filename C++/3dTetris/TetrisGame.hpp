@@ -117,7 +117,7 @@ private:
             int x = m_currentPiece.position.x + block.x;
             int y = m_currentPiece.position.y + block.y;
             int z = m_currentPiece.position.z + block.z;
-            m_gameState.grid[x][y][z] = true;
+            m_gameState.SetCell(x, y, z, static_cast<uint8_t>(m_currentPiece.type + 1));
         }
 
         CheckLines();
@@ -125,39 +125,7 @@ private:
     }
 
     void CheckLines() {
-        int linesCleared = 0;
-
-        for (int y = 0; y < GRID_HEIGHT; y++) {
-            bool layerComplete = true;
-            
-            for (int x = 0; x < GRID_WIDTH && layerComplete; x++) {
-                for (int z = 0; z < GRID_DEPTH && layerComplete; z++) {
-                    if (!m_gameState.grid[x][y][z]) {
-                        layerComplete = false;
-                    }
-                }
-            }
-
-            if (layerComplete) {
-                linesCleared++;
-                
-                for (int y2 = y; y2 < GRID_HEIGHT - 1; y2++) {
-                    for (int x = 0; x < GRID_WIDTH; x++) {
-                        for (int z = 0; z < GRID_DEPTH; z++) {
-                            m_gameState.grid[x][y2][z] = m_gameState.grid[x][y2 + 1][z];
-                        }
-                    }
-                }
-
-                for (int x = 0; x < GRID_WIDTH; x++) {
-                    for (int z = 0; z < GRID_DEPTH; z++) {
-                        m_gameState.grid[x][GRID_HEIGHT - 1][z] = false;
-                    }
-                }
-
-                y--;
-            }
-        }
+        int linesCleared = m_gameState.ClearFullLayers();
 
         if (linesCleared > 0) {
             m_gameState.linesCleared += linesCleared;
@@ -179,42 +147,17 @@ private:
     }
 
     void SpawnNewPiece() {
-        static const std::vector<std::vector<XMFLOAT3>> PIECES = {
-            // I Piece
-            {{0,0,0}, {1,0,0}, {2,0,0}, {3,0,0}},
-            // L Piece
-            {{0,0,0}, {1,0,0}, {2,0,0}, {2,1,0}},
-            // J Piece
-            {{0,0,0}, {1,0,0}, {2,0,0}, {0,1,0}},
-            // O Piece
-            {{0,0,0}, {1,0,0}, {0,1,0}, {1,1,0}},
-            // S Piece
-            {{1,0,0}, {2,0,0}, {0,1,0}, {1,1,0}},
-            // T Piece
-            {{1,0,0}, {0,1,0}, {1,1,0}, {2,1,0}},
-            // Z Piece
-            {{0,0,0}, {1,0,0}, {1,1,0}, {2,1,0}}
-        };
-
-        static const std::vector<XMFLOAT4> COLORS = {
-            {1.0f, 0.0f, 0.0f, 1.0f},  // Red
-            {0.0f, 1.0f, 0.0f, 1.0f},  // Green
-            {0.0f, 0.0f, 1.0f, 1.0f},  // Blue
-            {1.0f, 1.0f, 0.0f, 1.0f},  // Yellow
-            {1.0f, 0.0f, 1.0f, 1.0f},  // Magenta
-            {0.0f, 1.0f, 1.0f, 1.0f},  // Cyan
-            {1.0f, 0.5f, 0.0f, 1.0f}   // Orange
-        };
-
         // Current piece becomes next piece
         m_currentPiece = m_nextPiece;
 
         // Generate new next piece
-        std::uniform_int_distribution<int> pieceDistribution(0, PIECES.size() - 1);
+        std::uniform_int_distribution<int> pieceDistribution(
+            0, static_cast<int>(GameState::PIECE_TEMPLATES.size()) - 1);
         int pieceIndex = pieceDistribution(m_rng);
         
-        m_nextPiece.blocks = PIECES[pieceIndex];
-        m_nextPiece.color = COLORS[pieceIndex];
+        m_nextPiece.blocks = GameState::PIECE_TEMPLATES[pieceIndex].blocks;
+        m_nextPiece.color = GameState::PIECE_COLORS[pieceIndex];
+        m_nextPiece.type = pieceIndex;
         m_nextPiece.position = XMFLOAT3(GRID_WIDTH/2 - 1, GRID_HEIGHT - 1, GRID_DEPTH/2 - 1);
 
         // Check for game over
@@ -225,12 +168,14 @@ private:
     }
 
     void ResetGame() {
+        // A fresh state starts its grid generation at 0; carry it on so
+        // caches built from the old board see every layer change
+        const uint64_t gridGeneration = m_gameState.gridGeneration;
         m_gameState = GameState();
+        m_gameState.gridGeneration = gridGeneration;
+        m_gameState.MarkLayersDirty(GameState::ALL_LAYERS);
         m_previousLevel = 0;
         
-        // Clear grid
-        memset(m_gameState.grid, 0, sizeof(m_gameState.grid));
-        
         // Generate first pieces
         SpawnNewPiece();
         SpawnNewPiece();
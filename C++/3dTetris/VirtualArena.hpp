@@ -0,0 +1,248 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+
+#if defined(_WIN32)
+    #include <Windows.h>
+#else
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+// Thin wrappers over the OS reserve/commit calls shared by the arenas below
+namespace VirtualMemory {
+    constexpr size_t AlignUp(size_t value, size_t alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    // Reserves address space without backing it. `alignment` of 0 keeps the
+    // OS default; larger values over-reserve and trim to align the base.
+    inline std::byte* Reserve(size_t size, size_t alignment = 0) {
+#if defined(_WIN32)
+        (void)alignment; // Windows reservations are already 64KB aligned
+        return static_cast<std::byte*>(VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS));
+#else
+        void* region = mmap(nullptr, size + alignment, PROT_NONE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (region == MAP_FAILED) return nullptr;
+
+        auto address = reinterpret_cast<uintptr_t>(region);
+        auto aligned = alignment ? AlignUp(address, alignment) : address;
+        const size_t head = aligned - address;
+        if (head != 0) munmap(region, head);
+        if (alignment - head != 0) {
+            munmap(reinterpret_cast<void*>(aligned + size), alignment - head);
+        }
+        return reinterpret_cast<std::byte*>(aligned);
+#endif
+    }
+
+    // Safe to call concurrently and on already committed pages
+    inline bool Commit(std::byte* address, size_t size) {
+#if defined(_WIN32)
+        return VirtualAlloc(address, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+        return mprotect(address, size, PROT_READ | PROT_WRITE) == 0;
+#endif
+    }
+
+    inline void Decommit(std::byte* address, size_t size) {
+#if defined(_WIN32)
+        VirtualFree(address, size, MEM_DECOMMIT);
+#else
+        madvise(address, size, MADV_DONTNEED);
+        mprotect(address, size, PROT_NONE);
+#endif
+    }
+
+    inline void Release(std::byte* address, size_t size) {
+#if defined(_WIN32)
+        (void)size;
+        VirtualFree(address, 0, MEM_RELEASE);
+#else
+        munmap(address, size);
+#endif
+    }
+}
+
+// Bump allocator over a reserved virtual address range. Pages are committed
+// as the arena grows and handed back after a sustained period of low use, so
+// a large reservation costs nothing until it is touched. Running past the
+// reservation is counted and throws instead of falling back to the heap.
+class VirtualArena : public std::pmr::memory_resource {
+public:
+    struct ArenaConfig {
+        static constexpr size_t COMMIT_GRANULARITY = 64 * 1024;       // 64KB
+        static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;     // 2MB
+        static constexpr uint32_t DECOMMIT_FRAMES = 300;               // ~5s at 60fps
+        static constexpr size_t DECOMMIT_RATIO = 4; // trim when use < committed / 4
+    };
+
+    struct ArenaDesc {
+        const char* name;
+        size_t reserveSize;     // virtual range, never exceeded
+        size_t minCommit;       // kept committed even when idle
+        bool hugePages = false; // see Reserve() for what this means on each OS
+    };
+
+    struct ArenaStats {
+        size_t used;
+        size_t committed;
+        size_t reserved;
+        size_t highWater;       // largest `used` since creation
+        size_t recentHighWater; // largest `used` in the current decommit window
+        uint32_t overflowCount;
+        size_t overflowBytes;   // size of the largest rejected request
+    };
+
+    explicit VirtualArena(const ArenaDesc& desc) : m_desc(desc) {
+        m_granularity = desc.hugePages ? ArenaConfig::HUGE_PAGE_SIZE
+                                       : ArenaConfig::COMMIT_GRANULARITY;
+        m_reserved = AlignUp(desc.reserveSize, m_granularity);
+        Reserve();
+        Commit(AlignUp(desc.minCommit, m_granularity));
+    }
+
+    ~VirtualArena() override { Release(); }
+
+    VirtualArena(const VirtualArena&) = delete;
+    VirtualArena& operator=(const VirtualArena&) = delete;
+
+    // Drops every allocation. Called once per frame for transient arenas;
+    // this is also where idle pages are returned to the OS.
+    void Reset() {
+        m_recentHighWater = std::max(m_recentHighWater, m_used);
+        m_used = 0;
+
+        if (m_recentHighWater * ArenaConfig::DECOMMIT_RATIO < m_committed) {
+            if (++m_lowUseFrames >= ArenaConfig::DECOMMIT_FRAMES) {
+                Decommit(m_recentHighWater + m_recentHighWater / 2);
+                m_lowUseFrames = 0;
+                m_recentHighWater = 0;
+            }
+        } else {
+            m_lowUseFrames = 0;
+            m_recentHighWater = 0;
+        }
+    }
+
+    const char* GetName() const { return m_desc.name; }
+    size_t Used() const { return m_used; }
+
+    ArenaStats GetStats() const {
+        return {
+            m_used,
+            m_committed,
+            m_reserved,
+            m_highWater,
+            std::max(m_recentHighWater, m_used),
+            m_overflowCount,
+            m_overflowBytes
+        };
+    }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        const size_t offset = AlignUp(m_used, alignment);
+        const size_t end = offset + bytes;
+
+        // Out of reservation: counted in GetStats() and thrown, never
+        // served from anywhere else
+        if (end > m_committed && !Commit(end)) {
+            m_overflowCount++;
+            m_overflowBytes = std::max(m_overflowBytes, bytes);
+            throw std::bad_alloc();
+        }
+
+        m_used = end;
+        m_highWater = std::max(m_highWater, m_used);
+        return m_base + offset;
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {
+        // Memory is reclaimed by Reset()
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+private:
+    ArenaDesc m_desc;
+    std::byte* m_base = nullptr;
+    size_t m_granularity = 0;
+    size_t m_reserved = 0;
+    size_t m_committed = 0;
+    size_t m_used = 0;
+    size_t m_highWater = 0;
+    size_t m_recentHighWater = 0;
+    uint32_t m_lowUseFrames = 0;
+    uint32_t m_overflowCount = 0;
+    size_t m_overflowBytes = 0;
+    bool m_largePagesPinned = false;
+
+    static constexpr size_t AlignUp(size_t value, size_t alignment) {
+        return VirtualMemory::AlignUp(value, alignment);
+    }
+
+    void Reserve() {
+#if defined(_WIN32)
+        // Windows large pages cannot be committed lazily: the whole range is
+        // committed and locked up front. Only an arena that keeps its whole
+        // reservation committed anyway gets them; a lazily grown one would
+        // pin memory it is not using.
+        if (m_desc.hugePages) {
+            const size_t largePage = m_desc.minCommit >= m_desc.reserveSize ? GetLargePageMinimum() : 0;
+            if (largePage != 0) {
+                m_reserved = AlignUp(m_reserved, largePage);
+                m_base = static_cast<std::byte*>(VirtualAlloc(nullptr, m_reserved,
+                    MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE));
+                if (m_base) {
+                    m_committed = m_reserved;
+                    m_largePagesPinned = true;
+                    return;
+                }
+            }
+            m_granularity = ArenaConfig::COMMIT_GRANULARITY;
+        }
+        m_base = VirtualMemory::Reserve(m_reserved);
+#else
+        // Align the base so transparent huge pages can back the whole range
+        m_base = VirtualMemory::Reserve(m_reserved, m_desc.hugePages ? ArenaConfig::HUGE_PAGE_SIZE : 0);
+    #if defined(MADV_HUGEPAGE)
+        if (m_base && m_desc.hugePages) madvise(m_base, m_reserved, MADV_HUGEPAGE);
+    #endif
+#endif
+        if (!m_base) m_reserved = 0;
+    }
+
+    bool Commit(size_t required) {
+        if (!m_base || required > m_reserved) return false;
+        if (required <= m_committed) return true;
+
+        const size_t size = std::min(AlignUp(required, m_granularity), m_reserved);
+        if (!VirtualMemory::Commit(m_base + m_committed, size - m_committed)) return false;
+
+        m_committed = size;
+        return true;
+    }
+
+    // Returns committed pages above `keep` (never below minCommit) to the OS
+    void Decommit(size_t keep) {
+        keep = AlignUp(std::max(keep, m_desc.minCommit), m_granularity);
+        if (keep >= m_committed || m_largePagesPinned) return;
+
+        VirtualMemory::Decommit(m_base + keep, m_committed - keep);
+        m_committed = keep;
+    }
+
+    void Release() {
+        if (!m_base) return;
+        VirtualMemory::Release(m_base, m_reserved);
+        m_base = nullptr;
+        m_committed = 0;
+    }
+};
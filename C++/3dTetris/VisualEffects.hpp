@@ -1,23 +1,43 @@
 #pragma once
-#include <DirectXMath.h>
-#include <vector>
+#include "MathTypes.hpp"
+#include "GameState.h"
+#include "ParticleEngine.hpp"
+#include <array>
 #include <random>
 
 using namespace DirectX;
 
-struct Particle {
-    XMFLOAT3 position;
-    XMFLOAT3 velocity;
-    XMFLOAT4 color;
-    float life;
-    float size;
-    float rotation;
-    float rotationSpeed;
-};
-
 class VisualEffects {
 public:
-    VisualEffects() : m_rng(std::random_device{}()) {}
+    struct EffectsConfig {
+        // Yellow sparkles thrown up from every cell of the cleared layer,
+        // cooling to orange as they fade
+        static constexpr ParticleEffectDesc LINE_CLEAR = {{
+            .burst = 1, .lifeMin = 1.5f, .lifeMax = 1.5f,
+            .baseVelocity = {0.0f, 5.0f, 0.0f}, .velocityJitter = {5.0f, 0.0f, 5.0f},
+            .colorStart = {1.0f, 1.0f, 0.3f, 1.0f}, .colorEnd = {1.0f, 0.5f, 0.1f, 0.0f},
+            .sizeMin = 0.1f, .sizeMax = 0.1f, .sizeEnd = 0.5f, .rotationSpeedMin = -10.0f, .rotationSpeedMax = 10.0f
+        }, EffectPriority::High};
+
+        // Blue sparks where a piece lands
+        static constexpr ParticleEffectDesc PIECE_LOCK = {{
+            .burst = 20, .lifeMin = 0.5f, .lifeMax = 0.5f, .velocityJitter = {3.0f, 3.0f, 3.0f},
+            .colorStart = {0.3f, 0.3f, 1.0f, 1.0f}, .colorEnd = {0.3f, 0.3f, 1.0f, 0.0f},
+            .sizeMin = 0.05f, .sizeMax = 0.05f, .sizeEnd = 0.5f, .rotationSpeedMin = -5.0f, .rotationSpeedMax = 5.0f
+        }, EffectPriority::Normal};
+
+        // Red explosion from the middle of the well that swells and darkens
+        static constexpr ParticleEffectDesc GAME_OVER = {{
+            .burst = 100, .lifeMin = 2.0f, .lifeMax = 2.0f, .velocityJitter = {8.0f, 8.0f, 8.0f},
+            .colorStart = {1.0f, 0.2f, 0.2f, 1.0f}, .colorEnd = {0.4f, 0.05f, 0.05f, 0.0f},
+            .sizeMin = 0.15f, .sizeMax = 0.15f, .sizeEnd = 2.0f, .rotationSpeedMin = -15.0f, .rotationSpeedMax = 15.0f
+        }, EffectPriority::Critical};
+    };
+
+    // Gameplay-facing effects: screen shake plus the particle bursts, which
+    // all go to the shared engine
+    explicit VisualEffects(ParticleEngine& particles)
+        : m_particles(particles), m_rng(std::random_device{}()) {}
 
     void Update(float deltaTime) {
         // Update screen shake
@@ -28,115 +48,39 @@ public:
             std::uniform_real_distribution<float> shakeDist(-m_screenShake, m_screenShake);
             m_shakeOffset = XMFLOAT3(shakeDist(m_rng), shakeDist(m_rng), shakeDist(m_rng));
         }
-
-        // Update particles
-        for (auto it = m_particles.begin(); it != m_particles.end();) {
-            it->life -= deltaTime;
-            if (it->life <= 0.0f) {
-                it = m_particles.erase(it);
-                continue;
-            }
-
-            // Update position
-            it->position.x += it->velocity.x * deltaTime;
-            it->position.y += it->velocity.y * deltaTime;
-            it->position.z += it->velocity.z * deltaTime;
-
-            // Apply gravity
-            it->velocity.y -= 9.8f * deltaTime;
-
-            // Update rotation
-            it->rotation += it->rotationSpeed * deltaTime;
-
-            ++it;
-        }
     }
 
     void EmitLineClear(int y) {
         m_screenShake = 0.3f;
-        
-        std::uniform_real_distribution<float> velDist(-5.0f, 5.0f);
-        std::uniform_real_distribution<float> rotDist(-10.0f, 10.0f);
-        
+
+        std::array<XMFLOAT3, GameState::GRID_WIDTH * GameState::GRID_DEPTH> cells;
         for (int x = 0; x < GameState::GRID_WIDTH; x++) {
             for (int z = 0; z < GameState::GRID_DEPTH; z++) {
-                EmitParticle(
-                    XMFLOAT3(x - GameState::GRID_WIDTH/2.0f, y, z - GameState::GRID_DEPTH/2.0f),
-                    XMFLOAT3(velDist(m_rng), 5.0f, velDist(m_rng)),
-                    XMFLOAT4(1.0f, 1.0f, 0.3f, 1.0f),  // Yellow sparkle
-                    1.5f,  // Life
-                    0.1f,  // Size
-                    rotDist(m_rng)  // Rotation speed
-                );
+                cells[x * GameState::GRID_DEPTH + z] =
+                    XMFLOAT3(x - GameState::GRID_WIDTH/2.0f, static_cast<float>(y), z - GameState::GRID_DEPTH/2.0f);
             }
         }
+        m_particles.Emit(EffectsConfig::LINE_CLEAR, cells);
     }
 
     void EmitPieceLock(const XMFLOAT3& position) {
         m_screenShake = 0.1f;
-        
-        std::uniform_real_distribution<float> velDist(-3.0f, 3.0f);
-        std::uniform_real_distribution<float> rotDist(-5.0f, 5.0f);
-        
-        for (int i = 0; i < 20; i++) {
-            EmitParticle(
-                position,
-                XMFLOAT3(velDist(m_rng), velDist(m_rng), velDist(m_rng)),
-                XMFLOAT4(0.3f, 0.3f, 1.0f, 1.0f),  // Blue spark
-                0.5f,  // Life
-                0.05f,  // Size
-                rotDist(m_rng)  // Rotation speed
-            );
-        }
+        m_particles.Emit(EffectsConfig::PIECE_LOCK, position);
     }
 
     void EmitGameOver() {
         m_screenShake = 0.5f;
-        
-        std::uniform_real_distribution<float> velDist(-8.0f, 8.0f);
-        std::uniform_real_distribution<float> rotDist(-15.0f, 15.0f);
-        
-        for (int i = 0; i < 100; i++) {
-            EmitParticle(
-                XMFLOAT3(0.0f, GameState::GRID_HEIGHT/2.0f, 0.0f),
-                XMFLOAT3(velDist(m_rng), velDist(m_rng), velDist(m_rng)),
-                XMFLOAT4(1.0f, 0.2f, 0.2f, 1.0f),  // Red explosion
-                2.0f,  // Life
-                0.15f,  // Size
-                rotDist(m_rng)  // Rotation speed
-            );
-        }
+        m_particles.Emit(EffectsConfig::GAME_OVER, XMFLOAT3(0.0f, GameState::GRID_HEIGHT/2.0f, 0.0f));
     }
 
-    const std::vector<Particle>& GetParticles() const { return m_particles; }
     const XMFLOAT3& GetShakeOffset() const { return m_shakeOffset; }
 
 private:
-    std::vector<Particle> m_particles;
-    std::mt19937 m_rng;
+    ParticleEngine& m_particles;
+    std::mt19937 m_rng; // screen shake
     float m_screenShake = 0.0f;
     XMFLOAT3 m_shakeOffset = {0, 0, 0};
 
-    void EmitParticle(const XMFLOAT3& position, const XMFLOAT3& velocity, 
-                     const XMFLOAT4& color, float life, float size, float rotSpeed) {
-        if (m_particles.size() >= 1000) return;  // Particle limit
-        
-        Particle p;
-        p.position = position;
-        p.velocity = velocity;
-        p.color = color;
-        p.life = life;
-        p.size = size;
-        p.rotation = 0.0f;  // Start at 0 rotation
-        p.rotationSpeed = rotSpeed;
-        
-        // Add fade out effect based on life
-        std::uniform_real_distribution<float> fadeDist(0.8f, 1.0f);
-        p.color.w = fadeDist(m_rng);
-        
-        m_particles.push_back(p);
-    }
-
     // Helper function to blend colors
     XMFLOAT4 BlendColors(const XMFLOAT4& color1, const XMFLOAT4& color2, float blend) {
         return XMFLOAT4(
@@ -0,0 +1,363 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <numeric>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../AllocationTracker.hpp"
+
+// Minimal micro-benchmark harness. Each benchmark body is calibrated to run
+// long enough per sample to swamp timer resolution, then sampled repeatedly;
+// medians are compared against a stored JSON baseline.
+namespace Bench {
+    struct BenchConfig {
+        static constexpr int DEFAULT_SAMPLES = 30;
+        static constexpr int DEFAULT_WARMUP = 3;
+        static constexpr double DEFAULT_MIN_SAMPLE_MS = 5.0;
+        static constexpr double DEFAULT_THRESHOLD = 0.10; // 10% slower fails
+        static constexpr uint64_t MAX_ITERATIONS = 1ull << 30;
+    };
+
+    // Keeps the optimizer from discarding a value or hoisting work out of the loop
+    template<typename T>
+    inline void DoNotOptimize(const T& value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+        static volatile const void* sink;
+        sink = &value;
+        _ReadWriteBarrier();
+#else
+        asm volatile("" : : "r,m"(value) : "memory");
+#endif
+    }
+
+    // Whether a benchmark's timed body may touch the global heap. Forbidden
+    // bodies are checked by --zero-alloc.
+    enum class HeapUse { Forbidden, Allowed };
+
+    struct Options {
+        int samples = BenchConfig::DEFAULT_SAMPLES;
+        int warmup = BenchConfig::DEFAULT_WARMUP;
+        double minSampleMs = BenchConfig::DEFAULT_MIN_SAMPLE_MS;
+        double threshold = BenchConfig::DEFAULT_THRESHOLD;
+        std::string filter;
+        std::string jsonOut;
+        std::string baseline;
+        AllocationTracker::SteadyStatePolicy zeroAlloc = AllocationTracker::SteadyStatePolicy::Off;
+        bool list = false;
+    };
+
+    // All times are nanoseconds per iteration
+    struct Result {
+        std::string name;
+        uint64_t iterations;
+        int samples;
+        double median;
+        double mean;
+        double min;
+        double p90;
+        double stddev;
+        double mad;
+    };
+
+    class Registry {
+    public:
+        // Runs `iterations` calls of the body and returns elapsed nanoseconds
+        using RunFn = std::function<double(uint64_t iterations)>;
+
+        static Registry& Get() {
+            static Registry registry;
+            return registry;
+        }
+
+        // Setup happens in the caller; only the body is timed
+        template<typename Body>
+        void Add(std::string name, Body body, HeapUse heap = HeapUse::Forbidden) {
+            m_entries.push_back({std::move(name), heap, [body](uint64_t iterations) mutable {
+                auto start = std::chrono::steady_clock::now();
+                for (uint64_t i = 0; i < iterations; ++i) {
+                    body();
+                }
+                auto end = std::chrono::steady_clock::now();
+                return std::chrono::duration<double, std::nano>(end - start).count();
+            }});
+        }
+
+        std::vector<Result> Run(const Options& options) {
+            // Heap allocations are attributed to the running benchmark
+            AllocationTracker::SetMarkerNameResolver(&EntryName);
+            AllocationTracker::EnableSteadyStateCheck(options.zeroAlloc, 0);
+
+            std::vector<Result> results;
+            for (size_t index = 0; index < m_entries.size(); ++index) {
+                auto& entry = m_entries[index];
+                if (!options.filter.empty() &&
+                    entry.name.find(options.filter) == std::string::npos) {
+                    continue;
+                }
+                if (options.list) {
+                    std::printf("%s\n", entry.name.c_str());
+                    continue;
+                }
+                results.push_back(Measure(entry, static_cast<uint16_t>(index), options));
+                PrintResult(results.back());
+            }
+            return results;
+        }
+
+    private:
+        struct Entry {
+            std::string name;
+            HeapUse heap;
+            RunFn run;
+        };
+
+        std::vector<Entry> m_entries;
+
+        static const char* EntryName(uint16_t index) {
+            const auto& entries = Get().m_entries;
+            return index < entries.size() ? entries[index].name.c_str() : "<unknown>";
+        }
+
+        static Result Measure(Entry& entry, uint16_t index, const Options& options) {
+            const uint64_t iterations = Calibrate(entry, options.minSampleMs);
+
+            for (int i = 0; i < options.warmup; ++i) {
+                entry.run(iterations);
+            }
+
+            // Calibration and warm-up have grown any lazily sized buffers, so
+            // from here on a body that forbids heap use must not allocate
+            std::vector<double> samples(std::max(options.samples, 1));
+            AllocationTracker::PushScope(index);
+            {
+                std::optional<AllocationTracker::SteadyStateScope> steadyState;
+                if (entry.heap == HeapUse::Forbidden) steadyState.emplace();
+                for (auto& sample : samples) {
+                    sample = entry.run(iterations) / static_cast<double>(iterations);
+                    AllocationTracker::AdvanceSteadyStateFrame();
+                }
+            }
+            AllocationTracker::PopScope();
+
+            return Summarize(entry.name, iterations, samples);
+        }
+
+        // Doubles the iteration count until one sample takes minSampleMs
+        static uint64_t Calibrate(Entry& entry, double minSampleMs) {
+            const double targetNs = minSampleMs * 1e6;
+            uint64_t iterations = 1;
+            while (iterations < BenchConfig::MAX_ITERATIONS) {
+                double elapsed = entry.run(iterations);
+                if (elapsed >= targetNs) break;
+
+                // Jump close to the target once the timing is meaningful
+                double scale = elapsed > 1e5 ? targetNs / elapsed * 1.1 : 10.0;
+                iterations = static_cast<uint64_t>(
+                    std::ceil(iterations * std::clamp(scale, 1.5, 10.0)));
+            }
+            return std::min(iterations, BenchConfig::MAX_ITERATIONS);
+        }
+
+        static double Percentile(const std::vector<double>& sorted, double p) {
+            double rank = p * (sorted.size() - 1);
+            size_t lo = static_cast<size_t>(rank);
+            size_t hi = std::min(lo + 1, sorted.size() - 1);
+            return sorted[lo] + (sorted[hi] - sorted[lo]) * (rank - lo);
+        }
+
+        static Result Summarize(const std::string& name, uint64_t iterations,
+                                std::vector<double> samples) {
+            std::sort(samples.begin(), samples.end());
+
+            Result result = {};
+            result.name = name;
+            result.iterations = iterations;
+            result.samples = static_cast<int>(samples.size());
+            result.median = Percentile(samples, 0.5);
+            result.min = samples.front();
+            result.p90 = Percentile(samples, 0.9);
+            result.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+
+            double variance = 0.0;
+            for (double s : samples) variance += (s - result.mean) * (s - result.mean);
+            result.stddev = std::sqrt(variance / samples.size());
+
+            std::vector<double> deviations;
+            deviations.reserve(samples.size());
+            for (double s : samples) deviations.push_back(std::abs(s - result.median));
+            std::sort(deviations.begin(), deviations.end());
+            result.mad = Percentile(deviations, 0.5);
+            return result;
+        }
+
+        static void PrintResult(const Result& r) {
+            std::printf("%-36s %12.2f ns  (min %10.2f  p90 %10.2f  mad %5.1f%%)  x%llu\n",
+                        r.name.c_str(), r.median, r.min, r.p90,
+                        r.median > 0.0 ? r.mad / r.median * 100.0 : 0.0,
+                        static_cast<unsigned long long>(r.iterations));
+        }
+    };
+
+    inline bool WriteJson(const std::string& path, const std::vector<Result>& results) {
+        FILE* out = std::fopen(path.c_str(), "w");
+        if (!out) return false;
+
+        std::fprintf(out, "{\n  \"version\": 1,\n  \"unit\": \"ns/op\",\n  \"benchmarks\": [");
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result& r = results[i];
+            std::fprintf(out,
+                "%s\n    {\"name\": \"%s\", \"iterations\": %llu, \"samples\": %d, "
+                "\"median\": %.3f, \"mean\": %.3f, \"min\": %.3f, \"p90\": %.3f, "
+                "\"stddev\": %.3f, \"mad\": %.3f}",
+                i == 0 ? "" : ",", r.name.c_str(),
+                static_cast<unsigned long long>(r.iterations), r.samples,
+                r.median, r.mean, r.min, r.p90, r.stddev, r.mad);
+        }
+        std::fprintf(out, "\n  ]\n}\n");
+        std::fclose(out);
+        return true;
+    }
+
+    // Reads name -> median from a file written by WriteJson. Only understands
+    // that flat layout, which is all the baselines ever contain.
+    inline std::unordered_map<std::string, double> ReadBaseline(const std::string& path) {
+        std::unordered_map<std::string, double> medians;
+        std::ifstream file(path);
+        if (!file) return medians;
+
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        const std::string text = buffer.str();
+
+        auto readString = [&](size_t keyPos) -> std::string {
+            size_t open = text.find('"', text.find(':', keyPos));
+            size_t close = text.find('"', open + 1);
+            if (open == std::string::npos || close == std::string::npos) return {};
+            return text.substr(open + 1, close - open - 1);
+        };
+        auto readNumber = [&](size_t keyPos) -> double {
+            size_t colon = text.find(':', keyPos);
+            return colon == std::string::npos ? 0.0 : std::strtod(text.c_str() + colon + 1, nullptr);
+        };
+
+        size_t pos = 0;
+        while ((pos = text.find("\"name\"", pos)) != std::string::npos) {
+            size_t objectEnd = text.find('}', pos);
+            size_t medianPos = text.find("\"median\"", pos);
+            if (medianPos != std::string::npos && medianPos < objectEnd) {
+                medians[readString(pos)] = readNumber(medianPos);
+            }
+            pos = objectEnd == std::string::npos ? text.size() : objectEnd;
+        }
+        return medians;
+    }
+
+    // Prints the delta for every benchmark in the baseline; returns the
+    // number of benchmarks whose median got slower by more than threshold
+    inline int CompareToBaseline(const std::vector<Result>& results,
+                                 const std::unordered_map<std::string, double>& baseline,
+                                 double threshold) {
+        int regressions = 0;
+        std::printf("\n%-36s %12s %12s %9s\n", "benchmark", "baseline", "current", "delta");
+        for (const auto& r : results) {
+            auto it = baseline.find(r.name);
+            if (it == baseline.end() || it->second <= 0.0) {
+                std::printf("%-36s %12s %12.2f %9s\n", r.name.c_str(), "-", r.median, "new");
+                continue;
+            }
+
+            double delta = r.median / it->second - 1.0;
+            bool regressed = delta > threshold;
+            regressions += regressed;
+            std::printf("%-36s %12.2f %12.2f %+8.1f%%%s\n", r.name.c_str(),
+                        it->second, r.median, delta * 100.0, regressed ? "  REGRESSION" : "");
+        }
+        return regressions;
+    }
+
+    inline bool ParseArgs(int argc, char** argv, Options& options) {
+        for (int i = 1; i < argc; ++i) {
+            std::string flag = argv[i];
+            if (flag == "--list") {
+                options.list = true;
+                continue;
+            }
+            if (i + 1 >= argc) return false;
+
+            const char* value = argv[++i];
+            if (flag == "--filter") options.filter = value;
+            else if (flag == "--json") options.jsonOut = value;
+            else if (flag == "--baseline") options.baseline = value;
+            else if (flag == "--samples") options.samples = std::atoi(value);
+            else if (flag == "--warmup") options.warmup = std::atoi(value);
+            else if (flag == "--min-sample-ms") options.minSampleMs = std::strtod(value, nullptr);
+            else if (flag == "--threshold") options.threshold = std::strtod(value, nullptr);
+            else if (flag == "--zero-alloc") {
+                options.zeroAlloc = AllocationTracker::ParsePolicy(value);
+                if (options.zeroAlloc == AllocationTracker::SteadyStatePolicy::Off) return false;
+            }
+            else return false;
+        }
+        return options.samples > 0 && options.minSampleMs > 0.0;
+    }
+
+    // Returns the process exit code: 0 ok, 1 regression or steady-state heap
+    // allocation, 2 usage or I/O error
+    inline int Main(int argc, char** argv) {
+        Options options;
+        if (!ParseArgs(argc, argv, options)) {
+            std::fprintf(stderr,
+                "usage: %s [--filter text] [--samples n] [--warmup n] [--min-sample-ms ms]\n"
+                "       [--json out.json] [--baseline baseline.json] [--threshold 0.10] [--list]\n"
+                "       [--zero-alloc report|trace|abort]\n",
+                argv[0]);
+            return 2;
+        }
+#if !TETRIS_TRACK_ALLOCATIONS
+        if (options.zeroAlloc != AllocationTracker::SteadyStatePolicy::Off) {
+            std::fprintf(stderr, "--zero-alloc needs a build with TETRIS_TRACK_ALLOCATIONS=1\n");
+            return 2;
+        }
+#endif
+
+        auto results = Registry::Get().Run(options);
+        if (options.list) return 0;
+
+        if (!options.jsonOut.empty() && !WriteJson(options.jsonOut, results)) {
+            std::fprintf(stderr, "failed to write %s\n", options.jsonOut.c_str());
+            return 2;
+        }
+
+        int exitCode = 0;
+        if (options.zeroAlloc != AllocationTracker::SteadyStatePolicy::Off) {
+            std::printf("\n");
+            std::fflush(stdout);
+            if (AllocationTracker::WriteSteadyStateReport(stdout) > 0) exitCode = 1;
+        }
+
+        if (!options.baseline.empty()) {
+            auto baseline = ReadBaseline(options.baseline);
+            if (baseline.empty()) {
+                std::fprintf(stderr, "failed to read baseline %s\n", options.baseline.c_str());
+                return 2;
+            }
+            int regressions = CompareToBaseline(results, baseline, options.threshold);
+            if (regressions > 0) {
+                std::printf("\n%d benchmark(s) regressed by more than %.0f%%\n",
+                            regressions, options.threshold * 100.0);
+                exitCode = 1;
+            }
+        }
+        return exitCode;
+    }
+}
@@ -0,0 +1,832 @@
+// TetrisBench - headless benchmarks for the per-frame hot paths.
+//
+//   TetrisBench [--filter text] [--json out.json] [--baseline baseline.json]
+//               [--threshold 0.10] [--samples n] [--min-sample-ms ms] [--list]
+//               [--zero-alloc report|trace|abort]
+//
+// Exits with 1 when any median is slower than the baseline by more than the
+// threshold, or with --zero-alloc when a timed body hit the global heap, so
+// it can gate CI directly.
+#include "Benchmark.hpp"
+#include "../BoardFaceMesh.hpp"
+#include "../BoardRenderer.hpp"
+#include "../GameState.hpp"
+#include "../GridMesher.hpp"
+#include "../ParticleCollision.hpp"
+#include "../ParticleDepthSort.hpp"
+#include "../PoolAllocator.hpp"
+#include "../NullRenderBackend.hpp"
+#include "../PieceMecahnics.hpp"
+#include "../RenderCommand.hpp"
+#include "../RenderPipeline.hpp"
+#include "../ShaderPreprocessor.hpp"
+#include "../SoftwareRenderBackend.hpp"
+#include "../VisualEffects.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <filesystem>
+#include <memory>
+#include <memory_resource>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+
+namespace {
+    constexpr uint32_t BENCH_SEED = 0x7e7215;
+    constexpr uint32_t PARTICLE_STRESS_COUNT = 1u << 20;
+    constexpr uint32_t PARTICLE_EMIT_COUNT = 10000;
+    constexpr uint32_t PARTICLE_SORT_COUNT = 1u << 17;
+    constexpr uint32_t THUMBNAIL_WIDTH = 320;
+    constexpr uint32_t THUMBNAIL_HEIGHT = 240;
+    constexpr uint32_t THUMBNAIL_PARTICLES = 2000;
+
+    // A mid-game board: the lower half mostly filled, with a few holes
+    GameState::GridType MakeMidGameGrid(std::mt19937& rng) {
+        GameState::GridType grid{};
+        std::bernoulli_distribution filled(0.7);
+        for (int x = 0; x < GameState::GRID_WIDTH; x++) {
+            for (int y = 0; y < GameState::GRID_HEIGHT / 2; y++) {
+                for (int z = 0; z < GameState::GRID_DEPTH; z++) {
+                    grid[x][y][z] = filled(rng);
+                }
+            }
+        }
+        return grid;
+    }
+
+    // The same board coloured in 2x2 clumps, roughly as locked pieces leave it
+    GameState::ColorGridType MakeMidGameColors(std::mt19937& rng) {
+        const GameState::GridType grid = MakeMidGameGrid(rng);
+        GameState::ColorGridType colors{};
+        for (int x = 0; x < GameState::GRID_WIDTH; x++) {
+            for (int y = 0; y < GameState::GRID_HEIGHT; y++) {
+                for (int z = 0; z < GameState::GRID_DEPTH; z++) {
+                    if (grid[x][y][z]) colors[x][y][z] = static_cast<uint8_t>(1 + (x / 2 + z / 2 * 3 + y) % 7);
+                }
+            }
+        }
+        return colors;
+    }
+
+    // DirectXMath's XMMatrixLookAtLH and XMMatrixPerspectiveFovLH, stored
+    // transposed the way shaders read them
+    SoftwareRenderBackend::Camera MakeBoardCamera(float aspect) {
+        const XMFLOAT3 eye(0.0f, 14.0f, -16.0f), target(0.0f, 5.0f, 0.0f);
+        XMFLOAT3 f(target.x - eye.x, target.y - eye.y, target.z - eye.z);
+        const float fLength = std::sqrt(f.x * f.x + f.y * f.y + f.z * f.z);
+        f = XMFLOAT3(f.x / fLength, f.y / fLength, f.z / fLength);
+        XMFLOAT3 r(f.z, 0.0f, -f.x); // up (0, 1, 0) x forward
+        const float rLength = std::sqrt(r.x * r.x + r.z * r.z);
+        r = XMFLOAT3(r.x / rLength, 0.0f, r.z / rLength);
+        const XMFLOAT3 u(f.y * r.z - f.z * r.y, f.z * r.x - f.x * r.z, f.x * r.y - f.y * r.x);
+        const auto dot = [&](const XMFLOAT3& a) { return a.x * eye.x + a.y * eye.y + a.z * eye.z; };
+
+        const float nearZ = 0.1f, farZ = 100.0f;
+        const float yScale = 1.0f / std::tan(XM_PIDIV4 / 2.0f), xScale = yScale / aspect;
+        return {XMFLOAT4X4(r.x, r.y, r.z, -dot(r),
+                           u.x, u.y, u.z, -dot(u),
+                           f.x, f.y, f.z, -dot(f),
+                           0.0f, 0.0f, 0.0f, 1.0f),
+                XMFLOAT4X4(xScale, 0.0f, 0.0f, 0.0f,
+                           0.0f, yScale, 0.0f, 0.0f,
+                           0.0f, 0.0f, farZ / (farZ - nearZ), -nearZ * farZ / (farZ - nearZ),
+                           0.0f, 0.0f, 1.0f, 0.0f)};
+    }
+
+    // The board frame: a mid-game grid plus a falling piece, its ghost and a
+    // held piece, drawn as cube instances through BoardRenderer
+    class BoardScene {
+    public:
+        BoardScene(RenderBackend& backend, uint32_t shader) : m_renderer(backend, shader) {
+            const SoftwareRenderBackend::Camera camera = MakeBoardCamera(float(THUMBNAIL_WIDTH) / THUMBNAIL_HEIGHT);
+            m_renderer.SetCamera({camera.view, camera.projection});
+
+            std::mt19937 gridRng(BENCH_SEED), colorRng(BENCH_SEED);
+            m_state.grid = MakeMidGameGrid(gridRng);
+            m_state.colors = MakeMidGameColors(colorRng);
+            m_state.MarkLayersDirty(GameState::ALL_LAYERS);
+        }
+
+        // Locks or clears one cell of the top layer, as a piece lock would
+        void ToggleCell() {
+            constexpr int TOP = GameState::GRID_HEIGHT - 1;
+            m_state.SetCell(0, TOP, 0, m_state.colors[0][TOP][0] == 0 ? 1 : 0);
+        }
+
+        const BoardRenderer& GetRenderer() const { return m_renderer; }
+
+        // Draws into the backend's current frame
+        void Render() {
+            const auto& piece = GameState::PIECE_TEMPLATES[5];
+            const XMFLOAT3 position(2.0f, GameState::GRID_HEIGHT - 2.0f, 2.0f);
+            const XMFLOAT4& color = GameState::PIECE_COLORS[5];
+
+            m_renderer.BeginFrame();
+            m_renderer.SubmitGrid(m_state);
+            m_renderer.SubmitBlocks(piece.blocks, position, color, BoardRenderer::Style::Solid);
+            if (const auto ghost = PieceMechanics::GetGhostPosition(piece, m_state.grid, position)) {
+                m_renderer.SubmitBlocks(piece.blocks, *ghost, color, BoardRenderer::Style::Ghost);
+            }
+            m_renderer.SubmitBlocks(GameState::PIECE_TEMPLATES[0].blocks, XMFLOAT3(-5.0f, GameState::GRID_HEIGHT - 2.0f, 0.0f),
+                                    GameState::PIECE_COLORS[0], BoardRenderer::Style::Solid);
+            m_renderer.EndFrame();
+        }
+
+    private:
+        BoardRenderer m_renderer;
+        GameState m_state;
+    };
+
+    // Every instance the backend's last frame drew, as (pipeline, position,
+    // colour), sorted so two frames compare equal whatever their draw order
+    using DrawnInstance = std::tuple<uint32_t, float, float, float, float, float, float, float>;
+    std::vector<DrawnInstance> CollectDrawnInstances(const NullRenderBackend& backend) {
+        std::vector<DrawnInstance> drawn;
+        uint32_t instanceBuffer = 0;
+        for (const NullRenderBackend::Command& command : backend.GetCommands()) {
+            if (command.type == NullRenderBackend::CommandType::SetVertexBuffer &&
+                command.slot == RenderPipeline::INSTANCE_SLOT) {
+                instanceBuffer = command.handle;
+            }
+            if (command.type != NullRenderBackend::CommandType::DrawIndexed) continue;
+            const auto* instances = reinterpret_cast<const RenderPipeline::InstanceData*>(
+                backend.GetBufferData(BufferHandle(instanceBuffer)).data());
+            for (uint32_t i = 0; i < command.instanceCount; i++) {
+                const RenderPipeline::InstanceData& instance = instances[command.firstInstance + i];
+                drawn.emplace_back(command.handle, instance.world._41, instance.world._42, instance.world._43,
+                                   instance.color.x, instance.color.y, instance.color.z, instance.color.w);
+            }
+        }
+        std::sort(drawn.begin(), drawn.end());
+        return drawn;
+    }
+
+    void RegisterGameplayBenchmarks() {
+        auto& registry = Bench::Registry::Get();
+        std::mt19937 rng(BENCH_SEED);
+        const auto grid = MakeMidGameGrid(rng);
+
+        // Every placement of every piece in the well, tested in turn
+        struct Probe {
+            const GameState::PieceTemplate* piece;
+            XMFLOAT3 position;
+        };
+        std::vector<Probe> probes;
+        for (const auto& piece : GameState::PIECE_TEMPLATES) {
+            for (int x = 0; x < GameState::GRID_WIDTH; x++) {
+                for (int y = 0; y < GameState::GRID_HEIGHT; y++) {
+                    for (int z = 0; z < GameState::GRID_DEPTH; z++) {
+                        probes.push_back({&piece, XMFLOAT3(float(x), float(y), float(z))});
+                    }
+                }
+            }
+        }
+        std::shuffle(probes.begin(), probes.end(), rng);
+
+        registry.Add("Collision.IsValidPosition", [grid, probes, i = size_t(0)]() mutable {
+            const Probe& probe = probes[i++ % probes.size()];
+            Bench::DoNotOptimize(PieceMechanics::IsValidPosition(*probe.piece, grid, probe.position));
+        });
+
+        registry.Add("Rotation.TryRotation", [grid, probes, i = size_t(0)]() mutable {
+            const Probe& probe = probes[i++ % probes.size()];
+            Bench::DoNotOptimize(PieceMechanics::TryRotation(
+                *probe.piece, static_cast<int>(i & 3), grid, probe.position));
+        });
+
+        // Spawn height over the mid-game board, so the drop scans ~6 layers
+        registry.Add("Ghost.GetGhostPosition", [grid, i = size_t(0)]() mutable {
+            const auto& piece = GameState::PIECE_TEMPLATES[i % GameState::PIECE_TEMPLATES.size()];
+            XMFLOAT3 spawn(float(i % 3), GameState::GRID_HEIGHT - 2.0f, float(i / 3 % 3));
+            i++;
+            Bench::DoNotOptimize(PieceMechanics::GetGhostPosition(piece, grid, spawn));
+        });
+
+        // Worst realistic case: four full layers interleaved with partial ones
+        GameState cleared;
+        cleared.grid = grid;
+        for (int y : {0, 2, 3, 5}) {
+            for (auto& column : cleared.grid) {
+                column[y].fill(true);
+            }
+        }
+        registry.Add("LineClear.ClearFullLayers", [cleared]() mutable {
+            GameState state = cleared;
+            Bench::DoNotOptimize(state.ClearFullLayers());
+            Bench::DoNotOptimize(state.grid);
+        });
+    }
+
+    void RegisterEffectBenchmarks() {
+        auto& registry = Bench::Registry::Get();
+
+        // A thousand particles from ten game-over bursts; refilled whenever
+        // they expire
+        auto engine = std::make_shared<ParticleEngine>(nullptr, BENCH_SEED);
+        registry.Add("Particles.Update", [engine, effects = std::make_shared<VisualEffects>(*engine)]() {
+            if (engine->GetParticles().Empty()) {
+                for (int i = 0; i < 10; i++) effects->EmitGameOver();
+            }
+            effects->Update(1.0f / 60.0f);
+            engine->Update(1.0f / 60.0f);
+            Bench::DoNotOptimize(engine->GetParticles().Count());
+        });
+
+        // Every effect firing every frame while frames run long: the budget
+        // shrinks to its floor, so the cost levels off instead of growing
+        // with the number of effects
+        auto stormEngine = std::make_shared<ParticleEngine>(nullptr, BENCH_SEED);
+        registry.Add("Particles.EffectStorm",
+            [stormEngine, effects = std::make_shared<VisualEffects>(*stormEngine)]() {
+                for (int y = 0; y < 4; y++) effects->EmitLineClear(y);
+                for (int i = 0; i < 8; i++) effects->EmitPieceLock(XMFLOAT3(0.0f, 2.0f * i, 0.0f));
+                effects->EmitGameOver();
+                stormEngine->Update(1.0f / 30.0f);
+                Bench::DoNotOptimize(stormEngine->GetStats().live);
+            });
+
+        // One batched spawn of 10k particles into an emptied storage
+        auto emitStorage = std::make_shared<ParticleStorage>(PARTICLE_EMIT_COUNT);
+        registry.Add("Particles.Emit10K", [emitStorage, emitter = ParticleEmitter(BENCH_SEED)]() mutable {
+            constexpr EmitterDesc burst = {
+                .burst = PARTICLE_EMIT_COUNT, .lifeMin = 1.0f, .lifeMax = 2.0f,
+                .coneSpread = 0.5f, .speedMin = 2.0f, .speedMax = 5.0f,
+                .colorStart = {1.0f, 0.6f, 0.5f, 1.0f}, .colorEnd = {0.5f, 0.8f, 1.0f, 1.0f},
+                .sizeMin = 0.05f, .sizeMax = 0.15f, .rotationSpeedMin = -5.0f, .rotationSpeedMax = 5.0f
+            };
+            emitStorage->Clear();
+            Bench::DoNotOptimize(emitter.Emit(*emitStorage, burst, XMFLOAT3(0.0f, 6.0f, 0.0f)));
+        });
+
+        // Back-to-front order for 128k particles scattered around the well,
+        // gathered into an instance buffer the way ParticleSystem uploads it
+        auto sortStorage = std::make_shared<ParticleStorage>(PARTICLE_SORT_COUNT);
+        {
+            std::mt19937 rng(BENCH_SEED);
+            std::uniform_real_distribution<float> spread(-20.0f, 20.0f);
+            while (!sortStorage->Full()) {
+                sortStorage->Emit({{spread(rng), spread(rng), spread(rng)}, {0.0f, 0.0f, 0.0f},
+                                   {1.0f, 1.0f, 1.0f, 1.0f}, 1.0f, 0.1f, 0.0f, 0.0f});
+            }
+        }
+
+        // The order must be a permutation running back to front; depths are
+        // quantized to 16-bit keys, so neighbours may be inverted by at most
+        // one key step. Sorting on workers must give the same order.
+        {
+            const XMFLOAT3 eye(0.0f, 5.0f, -30.0f), forward(0.0f, -0.164399f, 0.986394f);
+            const uint32_t count = sortStorage->Count();
+            const auto x = sortStorage->GetColumn(ParticleStorage::PositionX);
+            const auto y = sortStorage->GetColumn(ParticleStorage::PositionY);
+            const auto z = sortStorage->GetColumn(ParticleStorage::PositionZ);
+            std::vector<float> depths(count);
+            for (uint32_t i = 0; i < count; i++) {
+                depths[i] = (x[i] - eye.x) * forward.x + (y[i] - eye.y) * forward.y + (z[i] - eye.z) * forward.z;
+            }
+            const auto [nearest, farthest] = std::minmax_element(depths.begin(), depths.end());
+            const float keyStep = (*farthest - *nearest) / float((1u << ParticleDepthSort::SortConfig::KEY_BITS) - 1);
+
+            ParticleDepthSort serial(PARTICLE_SORT_COUNT), parallel(PARTICLE_SORT_COUNT);
+            JobSystem checkJobs(3);
+            serial.Sort(*sortStorage, eye, forward);
+            parallel.Sort(*sortStorage, eye, forward, &checkJobs);
+            const auto order = serial.GetOrder();
+            std::vector<bool> seen(count);
+            for (uint32_t k = 0; k < order.size(); k++) {
+                if (order[k] >= count || seen[order[k]]) {
+                    throw std::runtime_error("Particles.DepthSort128K: order is not a permutation");
+                }
+                seen[order[k]] = true;
+                if (k > 0 && depths[order[k]] > depths[order[k - 1]] + keyStep * 1.01f + 1e-5f) {
+                    throw std::runtime_error("Particles.DepthSort128K: order is not back to front");
+                }
+            }
+            if (order.size() != count || !std::ranges::equal(order, parallel.GetOrder())) {
+                throw std::runtime_error("Particles.DepthSort128K: parallel sort gave a different order");
+            }
+        }
+        registry.Add("Particles.DepthSort128K",
+            [sortStorage, sort = std::make_shared<ParticleDepthSort>(PARTICLE_SORT_COUNT),
+             instances = std::make_shared<std::vector<ParticleInstance>>(PARTICLE_SORT_COUNT)]() {
+                sort->Sort(*sortStorage, XMFLOAT3(0.0f, 5.0f, -30.0f), XMFLOAT3(0.0f, -0.164399f, 0.986394f));
+                Bench::DoNotOptimize(sortStorage->WriteInstances(*instances, sort->GetOrder()));
+            });
+
+        // The same particles tested against the board camera's frustum
+        auto culler = std::make_shared<FrustumCuller>();
+        {
+            const SoftwareRenderBackend::Camera camera = MakeBoardCamera(float(THUMBNAIL_WIDTH) / THUMBNAIL_HEIGHT);
+            culler->SetTransposedViewProjection(camera.view, camera.projection);
+
+            // Every bit must match a plain per-sphere plane test; spheres
+            // within rounding of a plane may go either way
+            const auto x = sortStorage->GetColumn(ParticleStorage::PositionX);
+            const auto y = sortStorage->GetColumn(ParticleStorage::PositionY);
+            const auto z = sortStorage->GetColumn(ParticleStorage::PositionZ);
+            const auto radius = sortStorage->GetColumn(ParticleStorage::Size);
+            const uint32_t count = sortStorage->Count();
+            std::vector<uint8_t> visible((count + 7) / 8);
+            const uint32_t visibleCount = culler->CullSpheres(x.data(), y.data(), z.data(), radius.data(),
+                                                              count, visible.data());
+            uint32_t expectedCount = 0;
+            for (uint32_t i = 0; i < count; i++) {
+                float margin = INFINITY;
+                for (const XMFLOAT4& plane : culler->GetPlanes()) {
+                    margin = std::min(margin, plane.x * x[i] + plane.y * y[i] + plane.z * z[i] + plane.w + radius[i]);
+                }
+                expectedCount += margin >= 0.0f;
+                if (FrustumCuller::IsVisible(visible.data(), i) != (margin >= 0.0f) && std::abs(margin) > 1e-4f) {
+                    throw std::runtime_error("Particles.Cull128K: a sphere disagrees with the plane test");
+                }
+            }
+            uint32_t bitCount = 0;
+            for (uint8_t bits : visible) bitCount += std::popcount(bits);
+            if (bitCount != visibleCount || visibleCount == 0 || visibleCount == count ||
+                std::max(visibleCount, expectedCount) - std::min(visibleCount, expectedCount) > count / 1000) {
+                throw std::runtime_error("Particles.Cull128K: visible count disagrees with the plane test");
+            }
+        }
+        registry.Add("Particles.Cull128K",
+            [sortStorage, culler, visible = std::make_shared<std::vector<uint8_t>>(PARTICLE_SORT_COUNT / 8)]() {
+                Bench::DoNotOptimize(culler->CullSpheres(
+                    sortStorage->GetColumn(ParticleStorage::PositionX).data(),
+                    sortStorage->GetColumn(ParticleStorage::PositionY).data(),
+                    sortStorage->GetColumn(ParticleStorage::PositionZ).data(),
+                    sortStorage->GetColumn(ParticleStorage::Size).data(),
+                    sortStorage->Count(), visible->data()));
+            });
+
+        // Particles raining into a mid-game board: integrate, then bounce
+        // off the floor, walls and locked blocks. Lives are long enough that
+        // none die, so every sample sees the full count.
+        auto rainStorage = std::make_shared<ParticleStorage>(PARTICLE_SORT_COUNT);
+        auto collider = std::make_shared<ParticleCollider>();
+        {
+            std::mt19937 rng(BENCH_SEED);
+            collider->SetGrid(MakeMidGameGrid(rng));
+            std::uniform_real_distribution<float> across(-3.5f, 2.5f);
+            std::uniform_real_distribution<float> height(0.0f, 12.0f);
+            std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+            while (!rainStorage->Full()) {
+                rainStorage->Emit({{across(rng), height(rng), across(rng)}, {unit(rng), unit(rng), unit(rng)},
+                                   {1.0f, 1.0f, 1.0f, 1.0f}, 1e9f, 0.1f, 0.0f, 0.0f});
+            }
+        }
+        registry.Add("Particles.Collide128K", [rainStorage, collider]() {
+            rainStorage->Update(1.0f / 60.0f);
+            collider->Collide(*rainStorage, {});
+            Bench::DoNotOptimize(rainStorage->Count());
+        });
+
+        // A million particles with staggered lifetimes, so every frame
+        // integrates the full set and compacts a slice of it, then packs the
+        // survivors into an instance buffer the way ParticleSystem fills its
+        // vertex buffer
+        auto storage = std::make_shared<ParticleStorage>(PARTICLE_STRESS_COUNT);
+        auto instances = std::make_shared<std::vector<ParticleInstance>>(PARTICLE_STRESS_COUNT);
+        registry.Add("Particles.Update1M", [storage, instances, rng = std::mt19937(BENCH_SEED)]() mutable {
+            if (storage->Count() < PARTICLE_STRESS_COUNT / 2) {
+                std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+                std::uniform_real_distribution<float> lifetime(0.5f, 2.5f);
+                while (!storage->Full()) {
+                    storage->Emit({{0.0f, 6.0f, 0.0f}, {unit(rng), unit(rng) + 2.0f, unit(rng)},
+                                   {1.0f, 1.0f, 1.0f, 1.0f}, lifetime(rng), 0.1f, 0.0f, unit(rng)});
+                }
+            }
+            storage->Update(1.0f / 60.0f, {ParticleStorage::StorageConfig::DEFAULT_GRAVITY, 0.5f});
+            Bench::DoNotOptimize(storage->WriteInstances(*instances));
+        });
+
+        // The same work split across every hardware thread
+        auto jobs = std::make_shared<JobSystem>();
+        auto parallelStorage = std::make_shared<ParticleStorage>(PARTICLE_STRESS_COUNT);
+        auto parallelInstances = std::make_shared<std::vector<ParticleInstance>>(PARTICLE_STRESS_COUNT);
+        registry.Add("Particles.Update1M.Parallel",
+            [jobs, parallelStorage, parallelInstances, rng = std::mt19937(BENCH_SEED)]() mutable {
+                auto& particles = *parallelStorage;
+                if (particles.Count() < PARTICLE_STRESS_COUNT / 2) {
+                    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+                    std::uniform_real_distribution<float> lifetime(0.5f, 2.5f);
+                    while (!particles.Full()) {
+                        particles.Emit({{0.0f, 6.0f, 0.0f}, {unit(rng), unit(rng) + 2.0f, unit(rng)},
+                                        {1.0f, 1.0f, 1.0f, 1.0f}, lifetime(rng), 0.1f, 0.0f, unit(rng)});
+                    }
+                }
+                particles.Update(1.0f / 60.0f, {ParticleStorage::StorageConfig::DEFAULT_GRAVITY, 0.5f}, *jobs);
+                Bench::DoNotOptimize(particles.WriteInstances(*parallelInstances, jobs.get()));
+            });
+    }
+
+    void RegisterRenderBenchmarks() {
+        auto& registry = Bench::Registry::Get();
+        std::mt19937_64 rng(BENCH_SEED);
+
+        // A frame's worth of commands: keys random in every byte (no radix
+        // pass can be skipped), and keys laid out like CalculateSortKey
+        // output for a few pipelines, shaders and meshes
+        std::vector<RenderCommand> commands(4096);
+        for (uint32_t i = 0; i < commands.size(); i++) {
+            commands[i] = {rng(), i % 64, i % 16, i, 1};
+        }
+        std::vector<RenderCommand> pipelineCommands(commands.size());
+        for (uint32_t i = 0; i < pipelineCommands.size(); i++) {
+            const uint32_t mesh = rng() % 64;
+            const uint32_t material = rng() % 16;
+            const uint64_t key = uint64_t(material % 4 + 1) << 48 | uint64_t(material % 2 + 1) << 32 |
+                                 uint64_t(material) << 16 | mesh;
+            pipelineCommands[i] = {key, mesh, material, i, 1};
+        }
+
+        // Scratch comes from a frame-style arena, as in RenderPipeline::EndFrame
+        const auto addSort = [&](const char* name, const std::vector<RenderCommand>& input) {
+            // Must order exactly as a stable comparison sort, ties included,
+            // on the radix path and on the short-batch path
+            for (const size_t count : {input.size(), RenderSortConfig::RADIX_THRESHOLD - 1}) {
+                std::vector<RenderCommand> sorted(input.begin(), input.begin() + count), expected = sorted;
+                SortRenderCommands(sorted);
+                std::stable_sort(expected.begin(), expected.end(),
+                                 [](const RenderCommand& a, const RenderCommand& b) { return a.sortKey < b.sortKey; });
+                if (!std::equal(sorted.begin(), sorted.end(), expected.begin(),
+                                [](const RenderCommand& a, const RenderCommand& b) {
+                                    return a.sortKey == b.sortKey && a.instanceOffset == b.instanceOffset;
+                                })) {
+                    throw std::runtime_error(std::string(name) + ": order differs from std::stable_sort");
+                }
+            }
+
+            registry.Add(name,
+                [input, sorted = std::vector<RenderCommand>(input.size()),
+                 scratch = std::vector<std::byte>(input.size() * sizeof(RenderCommand))]() mutable {
+                    std::copy(input.begin(), input.end(), sorted.begin());
+                    std::pmr::monotonic_buffer_resource frame(scratch.data(), scratch.size(),
+                                                              std::pmr::null_memory_resource());
+                    SortRenderCommands(sorted, &frame);
+                    Bench::DoNotOptimize(sorted.data());
+                });
+        };
+        addSort("Render.SortCommands", commands);
+        addSort("Render.SortCommands.PipelineKeys", pipelineCommands);
+
+        // Locked blocks to quads: a whole mid-game board, and a lock that
+        // touches two layers and is then undone
+        std::mt19937 boardRng(BENCH_SEED);
+        const auto board = MakeMidGameColors(boardRng);
+        registry.Add("Render.GreedyMesh.Rebuild",
+            [board, mesher = std::make_shared<GridMesher>(),
+             vertices = std::vector<GridMesher::Vertex>(GridMesher::MesherConfig::MAX_QUADS * 4)]() mutable {
+                *mesher = GridMesher{};
+                mesher->Update(board);
+                Bench::DoNotOptimize(mesher->WriteVertices(vertices));
+            });
+
+        auto locked = board;
+        for (const XMFLOAT3& block : GameState::PIECE_TEMPLATES[1].blocks) {
+            locked[int(block.x) + 1][int(block.y) + GameState::GRID_HEIGHT / 2][int(block.z) + 2] = 2;
+        }
+        auto lockMesher = std::make_shared<GridMesher>();
+        lockMesher->Update(board);
+        registry.Add("Render.GreedyMesh.Lock",
+            [board, locked, lockMesher,
+             vertices = std::vector<GridMesher::Vertex>(GridMesher::MesherConfig::MAX_QUADS * 4)]() mutable {
+                uint32_t rebuilt = lockMesher->Update(locked);
+                rebuilt += lockMesher->Update(board);
+                Bench::DoNotOptimize(rebuilt + lockMesher->WriteVertices(vertices));
+            });
+
+        // The same lock on the face mesh, including the sub-range uploads
+        // to a persistent buffer
+        auto faceBackend = std::make_shared<NullRenderBackend>();
+        const BufferHandle faceBuffer = faceBackend->CreateBuffer(
+            {BufferKind::Vertex, BufferUsage::Default, BoardFaceMesh::FaceMeshConfig::VERTEX_BUFFER_BYTES,
+             sizeof(BoardFaceMesh::Vertex)});
+        auto faceMesh = std::make_shared<BoardFaceMesh>();
+        faceMesh->Rebuild(board);
+        faceMesh->Upload(*faceBackend, faceBuffer);
+        std::array<BoardFaceMesh::Cell, 4> lockCells{};
+        for (size_t i = 0; i < lockCells.size(); i++) {
+            const XMFLOAT3& block = GameState::PIECE_TEMPLATES[1].blocks[i];
+            lockCells[i] = {int(block.x) + 1, int(block.y) + GameState::GRID_HEIGHT / 2, int(block.z) + 2};
+        }
+        registry.Add("Render.FaceMesh.Lock",
+            [board, locked, lockCells, faceMesh, faceBackend, faceBuffer]() {
+                faceBackend->BeginFrame({});
+                faceMesh->UpdateCells(locked, lockCells);
+                uint32_t bytes = faceMesh->Upload(*faceBackend, faceBuffer);
+                faceMesh->UpdateCells(board, lockCells);
+                bytes += faceMesh->Upload(*faceBackend, faceBuffer);
+                faceBackend->EndFrame();
+                Bench::DoNotOptimize(bytes);
+            });
+
+        // Every call must reach the backend intact
+        auto backend = std::make_shared<NullRenderBackend>();
+        auto scene = std::make_shared<BoardScene>(*backend, 0);
+        const auto renderFrame = [backend, scene]() {
+            backend->BeginFrame({});
+            scene->Render();
+            backend->EndFrame();
+        };
+        renderFrame();
+        if (backend->GetLastFrameStats().invalidCalls != 0 || backend->GetLastFrameStats().draws == 0) {
+            throw std::runtime_error("Render.Frame: null backend rejected the frame");
+        }
+        renderFrame();
+        if (scene->GetRenderer().GetGridUploadBytes() != 0 || backend->GetLastFrameStats().bytesUpdated != 0) {
+            throw std::runtime_error("Render.Frame: an unchanged board was uploaded again");
+        }
+
+        // The board's static ranges only re-upload dirty layers; across
+        // locks, clears, resets and a replaced state a long-lived renderer
+        // must draw exactly what a fresh one draws
+        {
+            GameState state;
+            NullRenderBackend liveBackend;
+            BoardRenderer liveRenderer(liveBackend, 0);
+            std::mt19937 cellRng(BENCH_SEED);
+            const auto drawBoard = [&](NullRenderBackend& target, BoardRenderer& renderer) {
+                target.BeginFrame({});
+                renderer.BeginFrame();
+                renderer.SubmitGrid(state);
+                renderer.SubmitBlocks(GameState::PIECE_TEMPLATES[2].blocks, XMFLOAT3(1.0f, 10.0f, 1.0f),
+                                      GameState::PIECE_COLORS[2], BoardRenderer::Style::Ghost);
+                renderer.EndFrame();
+                auto drawn = CollectDrawnInstances(target);
+                target.EndFrame();
+                return drawn;
+            };
+            const auto randomCell = [&]() {
+                state.SetCell(cellRng() % GameState::GRID_WIDTH, cellRng() % GameState::GRID_HEIGHT,
+                              cellRng() % GameState::GRID_DEPTH, static_cast<uint8_t>(1 + cellRng() % 7));
+            };
+            for (uint32_t frame = 0; frame < 96; frame++) {
+                if (frame % 32 == 31) {
+                    state = GameState(); // the generation starts over
+                    randomCell();
+                } else if (frame % 16 == 15) {
+                    state.Reset();
+                } else if (frame % 8 == 7) {
+                    const int y = static_cast<int>(cellRng() % GameState::GRID_HEIGHT);
+                    for (int x = 0; x < GameState::GRID_WIDTH; x++) {
+                        for (int z = 0; z < GameState::GRID_DEPTH; z++) state.SetCell(x, y, z, 1);
+                    }
+                    state.ClearFullLayers();
+                } else if (frame % 4 != 3) {
+                    randomCell();
+                }
+
+                NullRenderBackend freshBackend;
+                BoardRenderer freshRenderer(freshBackend, 0);
+                if (drawBoard(liveBackend, liveRenderer) != drawBoard(freshBackend, freshRenderer)) {
+                    throw std::runtime_error("Render.Frame: static ranges differ from a rebuilt board");
+                }
+            }
+        }
+
+        registry.Add("Render.Frame", [renderFrame, backend]() {
+            renderFrame();
+            Bench::DoNotOptimize(backend->GetLastFrameStats().vertices);
+        });
+
+        // The same frame after a lock: one layer rebuilt and re-uploaded
+        auto lockBackend = std::make_shared<NullRenderBackend>();
+        auto lockScene = std::make_shared<BoardScene>(*lockBackend, 0);
+        registry.Add("Render.Frame.Lock", [lockBackend, lockScene]() {
+            lockScene->ToggleCell();
+            lockBackend->BeginFrame({});
+            lockScene->Render();
+            lockBackend->EndFrame();
+            Bench::DoNotOptimize(lockBackend->GetLastFrameStats().bytesUpdated);
+        });
+
+        // Eight producers recording 8K instances each in draws of 64, merged
+        // into one instance buffer: all on the calling thread into one
+        // bucket, then one producer per job, each into its thread's bucket
+        struct ProducerFrame {
+            NullRenderBackend backend;
+            RenderPipeline pipeline{backend};
+            std::vector<uint32_t> meshes;
+            std::vector<uint32_t> materials;
+            std::array<std::vector<RenderPipeline::InstanceData>, 8> scratch;
+
+            ProducerFrame() {
+                const PipelineHandle opaque = backend.CreatePipeline({1, BlendMode::Opaque, DepthMode::TestWrite});
+                const PipelineHandle alpha = backend.CreatePipeline({1, BlendMode::Alpha, DepthMode::TestOnly});
+                const BufferHandle vertices = backend.CreateBuffer({BufferKind::Vertex, BufferUsage::Immutable, 8 * 28, 28});
+                const BufferHandle indices = backend.CreateBuffer({BufferKind::Index, BufferUsage::Immutable, 36 * 2, 2});
+                for (uint32_t i = 0; i < 4; i++) meshes.push_back(pipeline.AddMesh({vertices, indices, 28, 36}));
+                for (uint32_t i = 0; i < 16; i++) {
+                    materials.push_back(pipeline.AddMaterial({i % 4 == 0 ? alpha : opaque, 1}));
+                }
+                for (auto& instances : scratch) instances.resize(64);
+            }
+
+            void Record(uint32_t producer, uint32_t bucket) {
+                auto& instances = scratch[producer];
+                for (uint32_t draw = 0; draw < 128; draw++) {
+                    for (uint32_t i = 0; i < instances.size(); i++) {
+                        const float x = float(i % 8), y = float(draw), z = float(producer);
+                        instances[i] = {XMFLOAT4X4(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, x, y, z, 1),
+                                        XMFLOAT4(x / 8, y / 128, z / 8, 1), XMFLOAT4(0, 0, 0, 0)};
+                    }
+                    pipeline.Submit(meshes[(producer + draw) % meshes.size()],
+                                    materials[(producer * 7 + draw) % materials.size()], instances, bucket);
+                }
+            }
+        };
+
+        // Buckets only change where instances are recorded: spreading the
+        // producers over buckets, serially or on workers, must draw what
+        // recording them all into bucket 0 draws
+        {
+            const auto drawProducers = [](ProducerFrame& frame, JobSystem* jobs, const auto& record) {
+                frame.backend.BeginFrame({});
+                frame.pipeline.BeginFrame();
+                record(frame);
+                frame.pipeline.EndFrame(jobs);
+                auto drawn = CollectDrawnInstances(frame.backend);
+                frame.backend.EndFrame();
+                return drawn;
+            };
+            JobSystem checkJobs(3);
+            ProducerFrame serial, bucketed, parallel;
+            const auto expected = drawProducers(serial, nullptr, [](ProducerFrame& frame) {
+                for (uint32_t producer = 0; producer < 8; producer++) frame.Record(producer, 0);
+            });
+            const auto spread = drawProducers(bucketed, nullptr, [](ProducerFrame& frame) {
+                for (uint32_t producer = 0; producer < 8; producer++) frame.Record(producer, producer);
+            });
+            const auto threaded = drawProducers(parallel, &checkJobs, [&](ProducerFrame& frame) {
+                checkJobs.ParallelFor(8, 1, [&](uint32_t chunk, uint32_t, uint32_t) {
+                    frame.Record(chunk, JobSystem::ThreadIndex());
+                });
+            });
+            if (expected.empty() || spread != expected || threaded != expected) {
+                throw std::runtime_error("Render.Pipeline.Record8: bucketed recording drew a different frame");
+            }
+        }
+
+        auto producers = std::make_shared<ProducerFrame>();
+        registry.Add("Render.Pipeline.Record8",
+            [producers]() {
+                producers->backend.BeginFrame({});
+                producers->pipeline.BeginFrame();
+                for (uint32_t producer = 0; producer < 8; producer++) producers->Record(producer, 0);
+                producers->pipeline.EndFrame();
+                producers->backend.EndFrame();
+                Bench::DoNotOptimize(producers->backend.GetLastFrameStats().draws);
+            });
+        auto parallelProducers = std::make_shared<ProducerFrame>();
+        auto recordJobs = std::make_shared<JobSystem>();
+        registry.Add("Render.Pipeline.Record8.Parallel",
+            [producers = parallelProducers, recordJobs]() {
+                producers->backend.BeginFrame({});
+                producers->pipeline.BeginFrame();
+                recordJobs->ParallelFor(8, 1, [&](uint32_t chunk, uint32_t, uint32_t) {
+                    producers->Record(chunk, JobSystem::ThreadIndex());
+                });
+                producers->pipeline.EndFrame(recordJobs.get());
+                producers->backend.EndFrame();
+                Bench::DoNotOptimize(producers->backend.GetLastFrameStats().draws);
+            });
+
+        // The same frame plus a burst of particles, rasterized into a
+        // spectator thumbnail
+        constexpr uint32_t MESH_SHADER = 1, PARTICLE_SHADER = 2;
+        auto jobs = std::make_shared<JobSystem>();
+        auto software = std::make_shared<SoftwareRenderBackend>(THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT, jobs.get());
+        software->RegisterProgram(MESH_SHADER, SoftwareRenderBackend::Program::InstancedMesh);
+        software->RegisterProgram(PARTICLE_SHADER, SoftwareRenderBackend::Program::Particles);
+        auto softwareScene = std::make_shared<BoardScene>(*software, MESH_SHADER);
+
+        const PipelineHandle particlePipeline =
+            software->CreatePipeline({PARTICLE_SHADER, BlendMode::Additive, DepthMode::TestOnly, Topology::PointList});
+        const BufferHandle particles = software->CreateBuffer(
+            {BufferKind::Vertex, BufferUsage::Dynamic, THUMBNAIL_PARTICLES * sizeof(ParticleInstance), sizeof(ParticleInstance)});
+        {
+            std::mt19937 particleRng(BENCH_SEED);
+            std::uniform_real_distribution<float> spread(-3.0f, 3.0f);
+            for (ParticleInstance& p : software->MapAs<ParticleInstance>(particles, MapMode::WriteDiscard)) {
+                p = {XMFLOAT3(spread(particleRng), 9.0f + spread(particleRng), spread(particleRng)), 0.15f,
+                     XMFLOAT4(1.0f, 0.6f, 0.2f, 0.5f), spread(particleRng)};
+            }
+            software->Unmap(particles);
+        }
+
+        const auto rasterizeFrame = [jobs, software, softwareScene, particlePipeline, particles]() {
+            software->BeginFrame({});
+            softwareScene->Render();
+            software->SetPipeline(particlePipeline);
+            software->SetVertexBuffer(0, particles, sizeof(ParticleInstance));
+            software->Draw(THUMBNAIL_PARTICLES);
+            software->EndFrame();
+        };
+        rasterizeFrame();
+        const auto& stats = software->GetLastFrameStats();
+        if (stats.skippedDraws != 0 || stats.triangles == 0) {
+            throw std::runtime_error("Render.SoftwareFrame: software backend skipped the frame");
+        }
+        registry.Add("Render.SoftwareFrame320x240", [rasterizeFrame, software]() {
+            rasterizeFrame();
+            Bench::DoNotOptimize(software->GetColor().data());
+        });
+    }
+
+    void RegisterMemoryBenchmarks() {
+        auto& registry = Bench::Registry::Get();
+
+        // Timed items in a slot map, the way DebugRenderer keeps its lines
+        // and text: filled, overrun and half removed, every handle must
+        // still resolve to its own item and removed handles to nothing
+        struct TimedItem {
+            uint32_t id;
+            float duration;
+        };
+        constexpr uint32_t MAP_ITEMS = 1024;
+        auto items = std::make_shared<SlotMap<TimedItem>>("BenchItems", MAP_ITEMS);
+        {
+            std::mt19937 rng(BENCH_SEED);
+            std::vector<std::pair<SlotHandle, uint32_t>> handles;
+            for (uint32_t i = 0; i < MAP_ITEMS; i++) handles.emplace_back(items->Emplace(TimedItem{i, 1.0f}), i);
+            if (!items->Full() || items->Emplace(TimedItem{}) || items->GetStats().failed != 1) {
+                throw std::runtime_error("Memory.SlotMap: a full map accepted an item");
+            }
+            std::shuffle(handles.begin(), handles.end(), rng);
+            for (uint32_t i = 0; i < MAP_ITEMS / 2; i++) items->Remove(handles[i].first);
+            for (uint32_t i = 0; i < MAP_ITEMS; i++) {
+                const TimedItem* item = items->Get(handles[i].first);
+                if ((i < MAP_ITEMS / 2) != (item == nullptr) || (item && item->id != handles[i].second)) {
+                    throw std::runtime_error("Memory.SlotMap: a handle resolved to the wrong item");
+                }
+            }
+            while (items->Emplace(TimedItem{0, 1.0f})) {}
+            for (uint32_t i = 0; i < MAP_ITEMS / 2; i++) {
+                if (items->Contains(handles[i].first)) throw std::runtime_error("Memory.SlotMap: a stale handle was reused");
+            }
+            if (items->Size() != MAP_ITEMS || items->GetStats().peak != MAP_ITEMS) {
+                throw std::runtime_error("Memory.SlotMap: removed slots were not reused");
+            }
+        }
+
+        // Steady churn on the full map: a frame ages every item, removes
+        // the expired quarter in place and refills, as RemoveExpired does
+        registry.Add("Memory.SlotMap.Churn", [items, rng = std::mt19937(BENCH_SEED)]() mutable {
+            for (TimedItem& item : items->Values()) item.duration = float(rng() % 4);
+            auto values = items->Values();
+            for (uint32_t i = 0; i < items->Size();) {
+                values[i].duration -= 1.0f;
+                if (values[i].duration < 0.0f) {
+                    items->RemoveAt(i);
+                    continue;
+                }
+                ++i;
+            }
+            while (items->Emplace(TimedItem{items->Size(), 1.0f})) {}
+            Bench::DoNotOptimize(items->Size());
+        });
+    }
+
+    void RegisterShaderBenchmarks() {
+        auto& registry = Bench::Registry::Get();
+
+        // Representative include tree written once to a scratch directory
+        const auto root = std::filesystem::temp_directory_path() / "TetrisBenchShaders";
+        std::filesystem::create_directories(root / "common");
+        auto writeFile = [&](const std::filesystem::path& path, const std::string& text) {
+            std::ofstream(root / path) << text;
+        };
+
+        std::string body;
+        for (int i = 0; i < 64; i++) {
+            body += "float4 Helper" + std::to_string(i) +
+                    "(float4 v) { return v * " + std::to_string(i) + ".0f; }\n";
+        }
+        writeFile("common/Constants.hlsli", "cbuffer Frame : register(b0) { float4x4 viewProj; };\n" + body);
+        writeFile("common/Lighting.hlsli", "#include \"Constants.hlsli\"\n" + body);
+        writeFile("common/Noise.hlsli", "#pragma include \"Constants.hlsli\"\n" + body);
+        writeFile("Block.hlsl",
+                  "#include \"/common/Lighting.hlsli\"\n"
+                  "#include \"/common/Noise.hlsli\"\n" + body +
+                  "float4 main(float4 pos : SV_POSITION) : SV_TARGET { return Helper1(pos); }\n");
+
+        const auto shaderPath = root / "Block.hlsl";
+        const std::string source = *ShaderPreprocessor::LoadFile(shaderPath);
+
+        // Load-time work: reads files and builds strings, so it may allocate
+        registry.Add("Shader.Preprocess", [root, shaderPath, source]() {
+            ShaderPreprocessor::IncludeHandler includes{root, {}};
+            Bench::DoNotOptimize(ShaderPreprocessor::PreprocessShader(source, shaderPath, includes));
+        }, Bench::HeapUse::Allowed);
+    }
+}
+
+int main(int argc, char** argv) {
+    RegisterGameplayBenchmarks();
+    RegisterEffectBenchmarks();
+    RegisterRenderBenchmarks();
+    RegisterMemoryBenchmarks();
+    RegisterShaderBenchmarks();
+    return Bench::Main(argc, argv);
+}
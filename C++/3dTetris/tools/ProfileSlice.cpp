@@ -0,0 +1,157 @@
+// ProfileSlice - cuts a time window out of a continuous profiler capture.
+//
+//   ProfileSlice <capture.t3dprof> <startSeconds> <endSeconds> [options]
+//
+//   --out <file.t3dprof>   write the window as a new, smaller capture
+//   --trace <file.json>    write the window in Chrome trace event format
+//                          (chrome://tracing, Perfetto)
+//   --hitches <ms>         only print frames slower than this
+//
+// Without --out or --trace a per-frame summary is printed.
+#include "../ProfilerCapture.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+    struct SliceOptions {
+        std::filesystem::path input;
+        std::filesystem::path outCapture;
+        std::filesystem::path outTrace;
+        uint64_t startNs = 0;
+        uint64_t endNs = UINT64_MAX;
+        float hitchMs = 0.0f;
+    };
+
+    uint64_t SecondsToNs(const char* text) {
+        return static_cast<uint64_t>(std::strtod(text, nullptr) * 1e9);
+    }
+
+    bool ParseArgs(int argc, char** argv, SliceOptions& options) {
+        if (argc < 4) return false;
+
+        options.input = argv[1];
+        options.startNs = SecondsToNs(argv[2]);
+        options.endNs = SecondsToNs(argv[3]);
+
+        for (int i = 4; i + 1 < argc; i += 2) {
+            std::string flag = argv[i];
+            if (flag == "--out") options.outCapture = argv[i + 1];
+            else if (flag == "--trace") options.outTrace = argv[i + 1];
+            else if (flag == "--hitches") options.hitchMs = std::strtof(argv[i + 1], nullptr);
+            else return false;
+        }
+        return options.startNs < options.endNs;
+    }
+
+    void WriteTraceEvent(FILE* out, bool& first, const std::string& name,
+                         uint16_t threadId, uint64_t startNs, uint64_t durationNs) {
+        std::fprintf(out, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,"
+                          "\"ts\":%.3f,\"dur\":%.3f}",
+                     first ? "" : ",", name.c_str(), threadId,
+                     startNs / 1000.0, durationNs / 1000.0);
+        first = false;
+    }
+}
+
+int main(int argc, char** argv) {
+    SliceOptions options;
+    if (!ParseArgs(argc, argv, options)) {
+        std::fprintf(stderr,
+            "usage: ProfileSlice <capture.t3dprof> <startSeconds> <endSeconds>\n"
+            "                    [--out slice.t3dprof] [--trace slice.json] [--hitches ms]\n");
+        return 1;
+    }
+
+    ProfilerCapture::Reader reader;
+    if (!reader.Open(options.input)) {
+        std::fprintf(stderr, "failed to open capture %s\n", options.input.string().c_str());
+        return 1;
+    }
+
+    std::unordered_map<uint32_t, std::string> names;
+    std::vector<uint32_t> nameHashes;
+    reader.ForEachName([&](uint32_t hash, std::string_view name) {
+        names.emplace(hash, std::string(name));
+        nameHashes.push_back(hash);
+    });
+    auto resolve = [&](uint32_t hash) -> std::string {
+        auto it = names.find(hash);
+        if (it != names.end()) return it->second;
+        char fallback[16];
+        std::snprintf(fallback, sizeof(fallback), "0x%08x", hash);
+        return fallback;
+    };
+
+    ProfilerCapture::Writer writer;
+    if (!options.outCapture.empty() && !writer.Open(options.outCapture)) {
+        std::fprintf(stderr, "failed to create %s\n", options.outCapture.string().c_str());
+        return 1;
+    }
+
+    FILE* trace = nullptr;
+    bool firstEvent = true;
+    if (!options.outTrace.empty()) {
+        trace = std::fopen(options.outTrace.string().c_str(), "w");
+        if (!trace) {
+            std::fprintf(stderr, "failed to create %s\n", options.outTrace.string().c_str());
+            return 1;
+        }
+        std::fprintf(trace, "{\"traceEvents\":[");
+    }
+
+    const bool printSummary = options.outCapture.empty() && !trace;
+    uint64_t frames = 0;
+    float worstFrame = 0.0f;
+
+    ProfilerCapture::FrameRecord frame;
+    std::span<const ProfilerCapture::MarkerRecord> markers;
+    uint64_t offset = reader.FindFrameOffset(options.startNs);
+
+    while (offset != 0) {
+        uint64_t next = reader.ReadFrame(offset, frame, markers);
+        if (next == 0 || frame.startNs >= options.endNs) break;
+        offset = next;
+
+        if (frame.startNs < options.startNs) continue;
+        if (frame.frameTime * 1000.0f < options.hitchMs) continue;
+
+        frames++;
+        worstFrame = std::max(worstFrame, frame.frameTime);
+
+        if (writer.IsOpen()) {
+            writer.WriteFrame(frame, markers);
+        }
+
+        if (trace) {
+            WriteTraceEvent(trace, firstEvent, "Frame", 0,
+                            frame.startNs, static_cast<uint64_t>(frame.frameTime * 1e9));
+            for (const auto& marker : markers) {
+                WriteTraceEvent(trace, firstEvent, resolve(marker.nameHash), marker.threadId,
+                                frame.startNs + marker.startNs, marker.durationNs);
+            }
+        }
+
+        if (printSummary) {
+            std::printf("frame %llu  t=%.3fs  %.2fms  markers=%u  heap allocs=%u (%u bytes)\n",
+                        static_cast<unsigned long long>(frame.frameNumber),
+                        frame.startNs / 1e9, frame.frameTime * 1000.0f,
+                        frame.markerCount, frame.heapAllocCount, frame.heapAllocBytes);
+        }
+    }
+
+    if (writer.IsOpen()) {
+        writer.Close(nameHashes, [&](size_t i) { return names[nameHashes[i]].c_str(); });
+    }
+
+    if (trace) {
+        std::fprintf(trace, "\n]}\n");
+        std::fclose(trace);
+    }
+
+    std::fprintf(stderr, "%llu frames in window, worst %.2fms\n",
+                 static_cast<unsigned long long>(frames), worstFrame * 1000.0f);
+    return 0;
+}